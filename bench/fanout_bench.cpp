@@ -0,0 +1,382 @@
+/**
+ * @file    fanout_bench.cpp
+ * @brief   Microbenchmarks for the frame fan-out hot path
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Drives the appsink → subscriber dispatch of CameraPipeline::on_new_sample
+ * with synthetic H.264 access units (IDR with SPS/PPS, P slices) and
+ * compares three fan-out designs for 1 … 64 subscribers:
+ *
+ *   - Copy:           callbacks in a vector guarded by a mutex (the former
+ *                     cb_mutex_), each one copies the payload and packetizes
+ *                     for its own peer
+ *   - ZeroCopy:       lock-free CowRegistry snapshot, the shared FrameBuffer
+ *                     is passed by reference, each peer still packetizes
+ *   - PacketizeOnce:  one VideoPacketizer pass per frame into a BufferPool
+ *                     block as in RtpFanout, then the per-peer SSRC/sequence/
+ *                     timestamp rewrite done by RtpFanout::send_batch (minus
+ *                     track->send())
+ *
+ * One benchmark iteration is one frame, so the reported time is ns/frame.
+ * Counters: allocs/frame (global operator new), lock_ns/frame (time spent
+ * holding the dispatch mutex; zero by construction for the lock-free paths)
+ * and packets/frame. BM_RegistryChurn measures one subscribe + unsubscribe
+ * (copy-on-write publish and reader grace period) while another thread
+ * dispatches frames, i.e. what a peer joining costs the frame path.
+ * BM_PacedSendQueue feeds one peer's PeerSendQueue with 1 … 6 cameras in
+ * real time under the default pacer settings and fails if the send
+ * worker falls behind far enough to drop a frame.
+ *
+ * Build with -DBUILD_BENCHMARKS=ON and run ./build/fanout-bench.
+ */
+
+#include "camera_pipeline.h"
+#include "cow_registry.h"
+#include "frame_buffer.h"
+#include "rtp_packetizer.h"
+#include "send_queue.h"
+
+#include <benchmark/benchmark.h>
+#include <rtc/rtc.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <random>
+#include <thread>
+#include <vector>
+
+// ---- Allocation counting (whole process, relaxed) ----
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+namespace ist
+{
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+
+        constexpr size_t kIdrBytes = 60 * 1024; ///< 720p IDR at ~2 Mbps
+        constexpr size_t kPBytes = 6 * 1024;    ///< 720p P slice at ~2 Mbps
+        constexpr uint32_t kFrameTicks = 3000;  ///< 30 fps at 90 kHz
+
+        /// Annex-B access unit: [SPS, PPS,] one slice NAL with start-code-free filler
+        H264Frame make_frame(bool keyframe)
+        {
+            std::vector<std::byte> au;
+            auto nal = [&au](uint8_t header, size_t size)
+            {
+                static constexpr uint8_t kStartCode[] = {0, 0, 0, 1};
+                for (uint8_t b : kStartCode)
+                    au.push_back(std::byte{b});
+                au.push_back(std::byte{header});
+                std::mt19937 rng(header);
+                for (size_t i = 1; i < size; i++)
+                    au.push_back(std::byte{static_cast<uint8_t>(1 + rng() % 255)}); // never 00 00 01
+            };
+            if (keyframe)
+            {
+                nal(0x67, 24); // SPS
+                nal(0x68, 6);  // PPS
+                nal(0x65, kIdrBytes);
+            }
+            else
+            {
+                nal(0x41, kPBytes);
+            }
+
+            H264Frame frame;
+            frame.buffer = FrameBuffer::copy(au.data(), au.size());
+            frame.is_keyframe = keyframe;
+            frame.capture_time = frame.appsink_time = Clock::now();
+            return frame;
+        }
+
+        /// Per-peer libdatachannel packetizer (the design before RtpFanout)
+        struct Packetizer
+        {
+            std::shared_ptr<rtc::RtpPacketizationConfig> config =
+                std::make_shared<rtc::RtpPacketizationConfig>(1000, "bench", 96, rtc::H264RtpPacketizer::defaultClockRate);
+            std::shared_ptr<rtc::H264RtpPacketizer> packetizer =
+                std::make_shared<rtc::H264RtpPacketizer>(rtc::NalUnit::Separator::LongStartSequence, config);
+
+            /// Mirrors RtpFanout::packetize()
+            rtc::message_vector run(const std::byte *data, size_t size, uint32_t timestamp)
+            {
+                rtc::message_vector packets;
+                config->timestamp = timestamp;
+                packets.push_back(rtc::make_message(data, data + size));
+                packetizer->outgoing(packets, [](rtc::message_ptr) {});
+                return packets;
+            }
+        };
+
+        /// Per-peer header rewrite as in RtpFanout::send_batch()
+        size_t rewrite(const RtpPacketBatch &batch, rtc::RtpPacketizationConfig &peer, uint32_t timestamp)
+        {
+            size_t bytes = 0;
+            for (const auto &packet : batch.packets)
+            {
+                const std::byte *data = batch.data(packet);
+                rtc::binary out(data, data + packet.size);
+                auto *header = reinterpret_cast<rtc::RtpHeader *>(out.data());
+                header->setSsrc(peer.ssrc);
+                header->setSeqNumber(peer.sequenceNumber++);
+                header->setTimestamp(timestamp);
+                bytes += out.size();
+                benchmark::DoNotOptimize(out.data());
+            }
+            return bytes;
+        }
+
+        /// Shared bookkeeping of one benchmark run
+        struct Counters
+        {
+            uint64_t allocs_start = g_allocations.load(std::memory_order_relaxed);
+            int64_t lock_ns = 0;
+            uint64_t packets = 0;
+
+            void report(benchmark::State &state) const
+            {
+                const auto per_frame = benchmark::Counter::kAvgIterations;
+                state.counters["allocs/frame"] = benchmark::Counter(
+                    static_cast<double>(g_allocations.load(std::memory_order_relaxed) - allocs_start), per_frame);
+                state.counters["lock_ns/frame"] = benchmark::Counter(static_cast<double>(lock_ns), per_frame);
+                state.counters["packets/frame"] = benchmark::Counter(static_cast<double>(packets), per_frame);
+            }
+        };
+
+        // ---- Copy: mutex-guarded callback vector, payload copied per subscriber ----
+
+        void BM_DispatchCopy(benchmark::State &state)
+        {
+            const bool keyframe = state.range(0) != 0;
+            const size_t subscribers = static_cast<size_t>(state.range(1));
+            const H264Frame frame = make_frame(keyframe);
+
+            std::mutex cb_mutex;
+            std::vector<FrameCallback> callbacks;
+            std::vector<Packetizer> packetizers(subscribers);
+            uint64_t packets = 0;
+            for (size_t i = 0; i < subscribers; i++)
+            {
+                callbacks.emplace_back([&packetizer = packetizers[i], &packets](const H264Frame &f)
+                                       {
+                    auto copy = FrameBuffer::copy(f.data(), f.size());
+                    packets += packetizer.run(copy->data(), copy->size(), packetizer.config->timestamp + kFrameTicks).size(); });
+            }
+
+            Counters counters;
+            for (auto _ : state)
+            {
+                std::lock_guard<std::mutex> lock(cb_mutex);
+                auto locked = Clock::now();
+                for (const auto &cb : callbacks)
+                    cb(frame);
+                counters.lock_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - locked).count();
+            }
+            counters.packets = packets;
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame.size() * subscribers));
+            counters.report(state);
+        }
+
+        // ---- ZeroCopy: CowRegistry snapshot, shared payload, per-peer packetizer ----
+
+        void BM_DispatchZeroCopy(benchmark::State &state)
+        {
+            const bool keyframe = state.range(0) != 0;
+            const size_t subscribers = static_cast<size_t>(state.range(1));
+            const H264Frame frame = make_frame(keyframe);
+
+            CowRegistry<FrameCallback> callbacks;
+            std::vector<Packetizer> packetizers(subscribers);
+            uint64_t packets = 0;
+            for (size_t i = 0; i < subscribers; i++)
+            {
+                callbacks.add([&packetizer = packetizers[i], &packets](const H264Frame &f)
+                              { packets += packetizer.run(f.data(), f.size(), packetizer.config->timestamp + kFrameTicks).size(); });
+            }
+
+            Counters counters;
+            for (auto _ : state)
+            {
+                auto snapshot = callbacks.snapshot();
+                for (const auto &entry : *snapshot)
+                    entry.value(frame);
+            }
+            counters.packets = packets;
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame.size() * subscribers));
+            counters.report(state);
+        }
+
+        // ---- PacketizeOnce: one packetizer pass, per-peer header rewrite ----
+
+        void BM_PacketizeOnce(benchmark::State &state)
+        {
+            const bool keyframe = state.range(0) != 0;
+            const size_t subscribers = static_cast<size_t>(state.range(1));
+            const H264Frame frame = make_frame(keyframe);
+
+            VideoPacketizer canonical(1000, 96, BufferPool::create("bench", 8 << 20));
+            std::vector<std::shared_ptr<rtc::RtpPacketizationConfig>> peers;
+            for (size_t i = 0; i < subscribers; i++)
+                peers.push_back(std::make_shared<rtc::RtpPacketizationConfig>(
+                    static_cast<uint32_t>(2000 + i), "peer", 96, rtc::H264RtpPacketizer::defaultClockRate));
+
+            CowRegistry<FrameCallback> camera_callbacks;
+            uint32_t timestamp = 0;
+            uint64_t packets = 0;
+            camera_callbacks.add([&](const H264Frame &f)
+                                 {
+                timestamp += kFrameTicks;
+                auto batch = canonical.packetize(f.data(), f.size(), timestamp);
+                for (auto &peer : peers)
+                    rewrite(*batch, *peer, timestamp + peer->startTimestamp);
+                packets += batch->packets.size(); });
+
+            Counters counters;
+            for (auto _ : state)
+            {
+                auto snapshot = camera_callbacks.snapshot();
+                for (const auto &entry : *snapshot)
+                    entry.value(frame);
+            }
+            counters.packets = packets;
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * frame.size() * subscribers));
+            counters.report(state);
+        }
+
+        // ---- Subscribe/unsubscribe while frames are dispatched ----
+
+        void BM_RegistryChurn(benchmark::State &state)
+        {
+            const size_t subscribers = static_cast<size_t>(state.range(0));
+            CowRegistry<FrameCallback> callbacks;
+            for (size_t i = 0; i < subscribers; i++)
+                callbacks.add([](const H264Frame &f)
+                              { benchmark::DoNotOptimize(f.data()); });
+
+            // A streaming thread dispatching one P frame after another
+            std::atomic<bool> running{true};
+            std::thread reader([&]()
+                               {
+                const H264Frame frame = make_frame(false);
+                while (running.load(std::memory_order_relaxed))
+                {
+                    auto snapshot = callbacks.snapshot();
+                    for (const auto &entry : *snapshot)
+                        entry.value(frame);
+                } });
+
+            // One iteration = subscribe + unsubscribe, including the grace
+            // period remove() waits for the reader to leave the old snapshot
+            Counters counters;
+            for (auto _ : state)
+            {
+                auto id = callbacks.add([](const H264Frame &f)
+                                        { benchmark::DoNotOptimize(f.data()); });
+                callbacks.remove(id, true);
+            }
+            running.store(false);
+            reader.join();
+            counters.report(state);
+        }
+
+        // ---- One peer's paced send worker serving several cameras ----
+
+        void BM_PacedSendQueue(benchmark::State &state)
+        {
+            const size_t lanes = static_cast<size_t>(state.range(0));
+            constexpr int kFps = 30;
+            constexpr size_t kGop = kFps;           ///< One IDR per second
+            constexpr size_t kMtu = VideoPacketizer::kDefaultMaxPayload;
+            const auto interval = std::chrono::microseconds(1000000 / kFps);
+
+            const WebRTCConfig defaults{};
+            PeerSendQueue queue("bench", static_cast<size_t>(defaults.send_queue_depth),
+                                defaults.pacer, defaults.pacer_spread, defaults.pacer_max_kbps);
+
+            // A track->send() costs a few microseconds of SRTP and syscall
+            std::atomic<uint64_t> packets{0};
+            for (size_t i = 0; i < lanes; i++)
+                queue.add_lane("bench_" + std::to_string(i),
+                               [&packets](const std::shared_ptr<const RtpPacketBatch> &batch, size_t begin, size_t end)
+                               {
+                    auto until = Clock::now() + std::chrono::microseconds(5) * (end - begin);
+                    while (Clock::now() < until)
+                    {
+                    }
+                    packets.fetch_add(end - begin, std::memory_order_relaxed);
+                    return (end - begin) * batch->packets.front().size; },
+                               interval);
+
+            auto make_batch = [&](bool keyframe)
+            {
+                auto batch = std::make_shared<RtpPacketBatch>();
+                size_t bytes = keyframe ? kIdrBytes : kPBytes;
+                batch->packets.assign((bytes + kMtu - 1) / kMtu, RtpPacketBatch::Packet{0, static_cast<uint32_t>(kMtu)});
+                batch->bytes = bytes;
+                batch->is_keyframe = keyframe;
+                batch->capture_time = Clock::now();
+                return std::shared_ptr<const RtpPacketBatch>(std::move(batch));
+            };
+
+            // One iteration = one second of live video on every camera, with
+            // keyframes staggered across the GOP as stagger_keyframes does
+            size_t frame = 0;
+            auto next = Clock::now();
+            for (auto _ : state)
+            {
+                for (size_t f = 0; f < kGop; f++, frame++)
+                {
+                    for (size_t i = 0; i < lanes; i++)
+                        queue.push(i, make_batch((frame + i * kGop / lanes) % kGop == 0));
+                    next += interval;
+                    std::this_thread::sleep_until(next);
+                }
+            }
+            queue.stop();
+
+            state.counters["dropped"] = static_cast<double>(queue.dropped());
+            state.counters["packets/s"] = benchmark::Counter(static_cast<double>(packets.load()), benchmark::Counter::kIsRate);
+            state.counters["pacer_wait_s"] = queue.pacer().waited_seconds();
+            if (queue.dropped() > 0)
+                state.SkipWithError("send worker fell behind and dropped frames");
+        }
+
+        void fanout_args(benchmark::internal::Benchmark *b)
+        {
+            b->ArgNames({"idr", "subscribers"});
+            for (int keyframe : {0, 1})
+                for (int subscribers : {1, 4, 16, 64})
+                    b->Args({keyframe, subscribers});
+        }
+
+    } // namespace
+
+    BENCHMARK(BM_DispatchCopy)->Apply(fanout_args);
+    BENCHMARK(BM_DispatchZeroCopy)->Apply(fanout_args);
+    BENCHMARK(BM_PacketizeOnce)->Apply(fanout_args);
+    BENCHMARK(BM_RegistryChurn)->ArgName("subscribers")->Arg(4)->Arg(64)->UseRealTime();
+    BENCHMARK(BM_PacedSendQueue)->ArgName("cameras")->Arg(1)->Arg(3)->Arg(6)->Iterations(3)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+} // namespace ist
+
+BENCHMARK_MAIN();
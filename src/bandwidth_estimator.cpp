@@ -0,0 +1,78 @@
+/**
+ * @file    bandwidth_estimator.cpp
+ * @brief   Per-peer bandwidth estimate implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "bandwidth_estimator.h"
+#include <algorithm>
+
+namespace ist
+{
+
+    BandwidthEstimator::BandwidthEstimator(uint32_t initial_bps, uint32_t min_bps, uint32_t max_bps)
+        : loss_bps_(initial_bps), min_bps_(min_bps), max_bps_(std::max(min_bps, max_bps))
+    {
+        clamp_locked();
+    }
+
+    void BandwidthEstimator::on_remb(uint32_t bps)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        remb_bps_ = bps;
+        last_remb_ = std::chrono::steady_clock::now();
+        has_feedback_ = true;
+    }
+
+    void BandwidthEstimator::on_loss_report(uint8_t fraction_lost)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+
+        // Reports for every track of the connection arrive together; only
+        // step the controller once per second so it does not overreact
+        if (now - last_loss_update_ < std::chrono::seconds(1))
+            return;
+        last_loss_update_ = now;
+        has_feedback_ = true;
+
+        double loss = fraction_lost / 256.0;
+        if (loss < kLowLoss)
+        {
+            loss_bps_ = static_cast<uint32_t>(loss_bps_ * 1.08);
+        }
+        else if (loss > kHighLoss)
+        {
+            loss_bps_ = static_cast<uint32_t>(loss_bps_ * (1.0 - 0.5 * loss));
+        }
+        clamp_locked();
+    }
+
+    uint32_t BandwidthEstimator::estimate_bps() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint32_t estimate = loss_bps_;
+        bool remb_fresh = remb_bps_ > 0 &&
+                          std::chrono::steady_clock::now() - last_remb_ <
+                              std::chrono::seconds(kRembTimeoutSeconds);
+        if (remb_fresh)
+            estimate = std::min(estimate, remb_bps_);
+        return std::clamp(estimate, min_bps_, max_bps_);
+    }
+
+    bool BandwidthEstimator::has_feedback() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return has_feedback_;
+    }
+
+    void BandwidthEstimator::clamp_locked()
+    {
+        loss_bps_ = std::clamp(loss_bps_, min_bps_, max_bps_);
+    }
+
+} // namespace ist
@@ -0,0 +1,73 @@
+/**
+ * @file    bandwidth_estimator.h
+ * @brief   Per-peer available bandwidth estimate from RTCP feedback
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Combines the receiver's REMB estimate with a loss-based controller fed
+ * by RTCP receiver reports (GCC-style: grow slowly while loss is low,
+ * back off proportionally when it is high). The result drives the live
+ * encoder bitrate of the cameras the peer is watching.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace ist
+{
+
+    /**
+     * @brief Available send bandwidth estimate for one peer connection
+     *
+     * Thread Safety:
+     *   - All public methods are thread-safe
+     */
+    class BandwidthEstimator
+    {
+    public:
+        /**
+         * @param initial_bps  Starting estimate (sum of the peer's camera bitrates)
+         * @param min_bps      Lower bound for the estimate
+         * @param max_bps      Upper bound for the estimate
+         */
+        BandwidthEstimator(uint32_t initial_bps, uint32_t min_bps, uint32_t max_bps);
+
+        /** @brief Receiver Estimated Maximum Bitrate from the remote peer */
+        void on_remb(uint32_t bps);
+
+        /**
+         * @brief Loss report from an RTCP receiver report block
+         * @param fraction_lost  RFC 3550 fraction lost (0-255 = 0-100%)
+         */
+        void on_loss_report(uint8_t fraction_lost);
+
+        /** @brief Current estimate in bits per second */
+        uint32_t estimate_bps() const;
+
+        /** @brief True once any RTCP feedback has been received */
+        bool has_feedback() const;
+
+    private:
+        void clamp_locked();
+
+        mutable std::mutex mutex_;
+        uint32_t loss_bps_;       ///< Loss-based controller state
+        uint32_t remb_bps_ = 0;   ///< Latest REMB (0 = none received)
+        uint32_t min_bps_;
+        uint32_t max_bps_;
+        bool has_feedback_ = false;
+        std::chrono::steady_clock::time_point last_remb_;
+        std::chrono::steady_clock::time_point last_loss_update_;
+
+        static constexpr double kLowLoss = 0.02;  ///< Below: increase 8% per second
+        static constexpr double kHighLoss = 0.10; ///< Above: decrease by (1 - 0.5 * loss)
+        static constexpr int kRembTimeoutSeconds = 5; ///< Ignore stale REMB values
+    };
+
+} // namespace ist
@@ -0,0 +1,89 @@
+/**
+ * @file    bitrate_allocator.cpp
+ * @brief   Cross-camera split of a total video bitrate budget implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "bitrate_allocator.h"
+#include <algorithm>
+
+namespace ist
+{
+
+    bool parse_view_priority(const std::string &name, ViewPriority &out)
+    {
+        if (name == "focus")
+            out = ViewPriority::FOCUS;
+        else if (name == "normal")
+            out = ViewPriority::NORMAL;
+        else if (name == "background")
+            out = ViewPriority::BACKGROUND;
+        else
+            return false;
+        return true;
+    }
+
+    const char *view_priority_name(ViewPriority priority)
+    {
+        switch (priority)
+        {
+        case ViewPriority::FOCUS:
+            return "focus";
+        case ViewPriority::BACKGROUND:
+            return "background";
+        default:
+            return "normal";
+        }
+    }
+
+    std::vector<int> allocate_bitrates(int budget_kbps, const std::vector<BitrateDemand> &demands)
+    {
+        // Camera i gets clamp(level × weight_i, min_i, max_i); the total is
+        // monotonic in the level, so bisect for the level that spends the
+        // budget. Budget a capped camera cannot use flows to the others.
+        auto spend = [&demands](double level, std::vector<int> *out)
+        {
+            double total = 0;
+            for (size_t i = 0; i < demands.size(); i++)
+            {
+                const auto &demand = demands[i];
+                if (demand.weight <= 0)
+                    continue;
+                double kbps = std::clamp(level * demand.weight, double(demand.min_kbps),
+                                         double(std::max(demand.min_kbps, demand.max_kbps)));
+                total += kbps;
+                if (out)
+                    (*out)[i] = static_cast<int>(kbps);
+            }
+            return total;
+        };
+
+        double max_weight = 0;
+        for (const auto &demand : demands)
+            max_weight = std::max(max_weight, demand.weight);
+
+        std::vector<int> result(demands.size(), 0);
+        if (max_weight <= 0)
+            return result;
+
+        double low = 0;
+        double high = std::max(1, budget_kbps) / max_weight;
+        while (spend(high, nullptr) < budget_kbps && high < 1e12)
+            high *= 2; // mins alone may exceed the budget: low stays 0
+        for (int i = 0; i < 50; i++)
+        {
+            double mid = (low + high) / 2;
+            if (spend(mid, nullptr) <= budget_kbps)
+                low = mid;
+            else
+                high = mid;
+        }
+        spend(low, &result);
+        return result;
+    }
+
+} // namespace ist
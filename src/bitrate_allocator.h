@@ -0,0 +1,61 @@
+/**
+ * @file    bitrate_allocator.h
+ * @brief   Cross-camera split of a total video bitrate budget
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Without a budget every camera encodes at its own configured bitrate,
+ * whatever the operator is looking at. With webrtc.uplink_budget_kbps the
+ * budget is divided over the watched cameras in proportion to their
+ * configured bitrate times a viewer priority weight (focus / normal /
+ * background, reported by the client), clamped to each camera's range.
+ * Whatever a clamped camera cannot use is handed to the others.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ist
+{
+
+    /// How prominently a client is showing a camera
+    enum class ViewPriority
+    {
+        BACKGROUND, ///< Minimized or hidden behind a maximized view
+        NORMAL,     ///< Regular grid cell
+        FOCUS       ///< Maximized / the view the operator drives by
+    };
+
+    /**
+     * @brief  Parse a priority name ("focus", "normal", "background")
+     * @return false for anything else (@p out unchanged)
+     */
+    bool parse_view_priority(const std::string &name, ViewPriority &out);
+
+    /// Priority name for logging
+    const char *view_priority_name(ViewPriority priority);
+
+    /// One camera competing for the budget
+    struct BitrateDemand
+    {
+        double weight; ///< Relative share (configured bitrate × priority weight); <= 0 = not allocated
+        int min_kbps;  ///< Lowest useful bitrate (lowest simulcast layer's floor)
+        int max_kbps;  ///< Highest useful bitrate (full layer's configured bitrate)
+    };
+
+    /**
+     * @brief  Split @p budget_kbps over @p demands by weight (water filling)
+     *
+     * Every allocated camera gets at least its min_kbps, even if the mins
+     * alone exceed the budget; no camera gets more than its max_kbps.
+     *
+     * @return kbps per demand, 0 for demands with no weight
+     */
+    std::vector<int> allocate_bitrates(int budget_kbps, const std::vector<BitrateDemand> &demands);
+
+} // namespace ist
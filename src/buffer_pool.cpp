@@ -0,0 +1,162 @@
+/**
+ * @file    buffer_pool.cpp
+ * @brief   Size-class pool for frame and RTP packet buffers implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "buffer_pool.h"
+
+namespace ist
+{
+
+    // ==================== PooledBuffer ====================
+
+    PooledBuffer &PooledBuffer::operator=(PooledBuffer &&other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            pool_ = std::move(other.pool_);
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.data_ = nullptr;
+            other.size_ = other.capacity_ = 0;
+        }
+        return *this;
+    }
+
+    PooledBuffer PooledBuffer::unpooled(size_t size)
+    {
+        PooledBuffer buffer;
+        buffer.data_ = new std::byte[size ? size : 1];
+        buffer.size_ = buffer.capacity_ = size;
+        return buffer;
+    }
+
+    void PooledBuffer::reset() noexcept
+    {
+        if (!data_)
+            return;
+        if (pool_)
+            pool_->release(data_, capacity_);
+        else
+            delete[] data_;
+        pool_.reset();
+        data_ = nullptr;
+        size_ = capacity_ = 0;
+    }
+
+    // ==================== BufferPool ====================
+
+    std::shared_ptr<BufferPool> BufferPool::create(std::string name, size_t max_free_bytes)
+    {
+        return std::shared_ptr<BufferPool>(new BufferPool(std::move(name), max_free_bytes));
+    }
+
+    BufferPool::BufferPool(std::string name, size_t max_free_bytes)
+        : name_(std::move(name)), max_free_bytes_(max_free_bytes)
+    {
+    }
+
+    BufferPool::~BufferPool()
+    {
+        // Outstanding buffers hold a reference, so only free blocks remain
+        for (auto &size_class : classes_)
+            for (std::byte *block : size_class.free)
+                delete[] block;
+    }
+
+    size_t BufferPool::class_of(size_t size)
+    {
+        size_t shift = kMinBlockShift;
+        while (shift <= kMaxBlockShift && (size_t(1) << shift) < size)
+            shift++;
+        return shift - kMinBlockShift;
+    }
+
+    PooledBuffer BufferPool::acquire(size_t size)
+    {
+        acquires_.fetch_add(1, std::memory_order_relaxed);
+
+        const size_t index = class_of(size);
+        const size_t capacity = index < kClassCount ? size_t(1) << (index + kMinBlockShift) : size;
+
+        std::byte *block = nullptr;
+        if (index < kClassCount)
+        {
+            auto &size_class = classes_[index];
+            std::lock_guard<std::mutex> lock(size_class.mutex);
+            if (!size_class.free.empty())
+            {
+                block = size_class.free.back();
+                size_class.free.pop_back();
+            }
+        }
+        if (block)
+        {
+            free_bytes_.fetch_sub(capacity, std::memory_order_relaxed);
+            free_blocks_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            block = new std::byte[capacity];
+            heap_allocations_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        uint64_t in_use = in_use_bytes_.fetch_add(capacity, std::memory_order_relaxed) + capacity;
+        in_use_blocks_.fetch_add(1, std::memory_order_relaxed);
+        uint64_t high = high_water_bytes_.load(std::memory_order_relaxed);
+        while (in_use > high && !high_water_bytes_.compare_exchange_weak(high, in_use, std::memory_order_relaxed))
+        {
+        }
+
+        PooledBuffer buffer;
+        buffer.pool_ = shared_from_this();
+        buffer.data_ = block;
+        buffer.size_ = size;
+        buffer.capacity_ = capacity;
+        return buffer;
+    }
+
+    void BufferPool::release(std::byte *block, size_t capacity) noexcept
+    {
+        in_use_bytes_.fetch_sub(capacity, std::memory_order_relaxed);
+        in_use_blocks_.fetch_sub(1, std::memory_order_relaxed);
+
+        const size_t index = class_of(capacity);
+        if (index < kClassCount && free_bytes_.load(std::memory_order_relaxed) + capacity <= max_free_bytes_)
+        {
+            auto &size_class = classes_[index];
+            try
+            {
+                std::lock_guard<std::mutex> lock(size_class.mutex);
+                size_class.free.push_back(block);
+                free_bytes_.fetch_add(capacity, std::memory_order_relaxed);
+                free_blocks_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            catch (...)
+            {
+                // Free-list growth failed; fall through and free the block
+            }
+        }
+        delete[] block;
+    }
+
+    BufferPool::Stats BufferPool::stats() const
+    {
+        return {in_use_bytes_.load(std::memory_order_relaxed),
+                high_water_bytes_.load(std::memory_order_relaxed),
+                free_bytes_.load(std::memory_order_relaxed),
+                in_use_blocks_.load(std::memory_order_relaxed),
+                free_blocks_.load(std::memory_order_relaxed),
+                acquires_.load(std::memory_order_relaxed),
+                heap_allocations_.load(std::memory_order_relaxed)};
+    }
+
+} // namespace ist
@@ -0,0 +1,156 @@
+/**
+ * @file    buffer_pool.h
+ * @brief   Size-class pool for frame and RTP packet buffers
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Each camera owns one pool. Packet batches and owned frame copies take a
+ * block of the next power-of-two size class and hand it back when their
+ * last reference drops — usually on a peer's send worker, not the camera
+ * thread — so the steady state runs without malloc/free and the heap does
+ * not fragment over weeks of uptime. Free blocks beyond a configured byte
+ * budget are returned to the heap, which bounds what a burst can pin.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ist
+{
+
+    class BufferPool;
+
+    /**
+     * @brief Move-only byte buffer that returns its block to a BufferPool
+     *
+     * A default-constructed or unpooled() buffer owns plain heap memory.
+     * Holds a reference to its pool, so it may outlive the camera and be
+     * released from any thread.
+     */
+    class PooledBuffer
+    {
+    public:
+        PooledBuffer() = default;
+        ~PooledBuffer() { reset(); }
+
+        PooledBuffer(PooledBuffer &&other) noexcept { *this = std::move(other); }
+        PooledBuffer &operator=(PooledBuffer &&other) noexcept;
+
+        PooledBuffer(const PooledBuffer &) = delete;
+        PooledBuffer &operator=(const PooledBuffer &) = delete;
+
+        /** @brief Heap buffer of exactly @p size bytes, not tied to a pool */
+        static PooledBuffer unpooled(size_t size);
+
+        std::byte *data() { return data_; }
+        const std::byte *data() const { return data_; }
+        size_t size() const { return size_; }
+        size_t capacity() const { return capacity_; }
+
+        /** @brief Set the used size (clamped to capacity, contents kept) */
+        void resize(size_t size) { size_ = size < capacity_ ? size : capacity_; }
+
+        /** @brief Give the block back (to the pool, or the heap) */
+        void reset() noexcept;
+
+    private:
+        friend class BufferPool;
+
+        std::shared_ptr<BufferPool> pool_; ///< Null for unpooled memory
+        std::byte *data_ = nullptr;
+        size_t size_ = 0;
+        size_t capacity_ = 0;
+    };
+
+    /**
+     * @brief Per-camera power-of-two size-class allocator
+     *
+     * Classes run from 1 KiB to 1 MiB; larger requests fall through to the
+     * heap (counted, never retained).
+     *
+     * Thread Safety:
+     *   - acquire() and buffer release are thread-safe; each size class
+     *     has its own mutex, held only to push or pop a pointer
+     *   - stats() reads relaxed counters and may run at any time
+     */
+    class BufferPool : public std::enable_shared_from_this<BufferPool>
+    {
+    public:
+        /// Occupancy snapshot
+        struct Stats
+        {
+            uint64_t in_use_bytes;      ///< Capacity of blocks held by frames/batches
+            uint64_t high_water_bytes;  ///< Highest in_use_bytes since start
+            uint64_t free_bytes;        ///< Capacity of blocks retained for reuse
+            uint64_t in_use_blocks;
+            uint64_t free_blocks;
+            uint64_t acquires;          ///< acquire() calls
+            uint64_t heap_allocations;  ///< acquire() calls that had to allocate
+        };
+
+        static constexpr size_t kMinBlockShift = 10; ///< 1 KiB
+        static constexpr size_t kMaxBlockShift = 20; ///< 1 MiB
+        static constexpr size_t kClassCount = kMaxBlockShift - kMinBlockShift + 1;
+
+        /**
+         * @param name            Owner for logging (camera id)
+         * @param max_free_bytes  Free capacity kept for reuse; beyond it released blocks are freed
+         */
+        static std::shared_ptr<BufferPool> create(std::string name, size_t max_free_bytes);
+
+        ~BufferPool();
+
+        // Non-copyable, non-movable
+        BufferPool(const BufferPool &) = delete;
+        BufferPool &operator=(const BufferPool &) = delete;
+
+        /** @brief Block of at least @p size bytes, with size() == @p size */
+        PooledBuffer acquire(size_t size);
+
+        /** @brief Current occupancy and counters */
+        Stats stats() const;
+
+        const std::string &name() const { return name_; }
+
+    private:
+        BufferPool(std::string name, size_t max_free_bytes);
+
+        friend class PooledBuffer;
+
+        /// Return a block of @p capacity bytes (from any thread)
+        void release(std::byte *block, size_t capacity) noexcept;
+
+        /// Size class of a capacity, or kClassCount when oversize
+        static size_t class_of(size_t size);
+
+        struct SizeClass
+        {
+            std::mutex mutex;
+            std::vector<std::byte *> free;
+        };
+
+        std::string name_;
+        size_t max_free_bytes_;
+        std::array<SizeClass, kClassCount> classes_;
+
+        std::atomic<uint64_t> in_use_bytes_{0};
+        std::atomic<uint64_t> high_water_bytes_{0};
+        std::atomic<uint64_t> free_bytes_{0};
+        std::atomic<uint64_t> in_use_blocks_{0};
+        std::atomic<uint64_t> free_blocks_{0};
+        std::atomic<uint64_t> acquires_{0};
+        std::atomic<uint64_t> heap_allocations_{0};
+    };
+
+} // namespace ist
@@ -0,0 +1,117 @@
+/**
+ * @file    bus_reactor.cpp
+ * @brief   Shared GLib main loop implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "bus_reactor.h"
+#include <spdlog/spdlog.h>
+#include <future>
+
+namespace ist
+{
+
+    BusReactor::BusReactor()
+        : context_(g_main_context_new()), loop_(g_main_loop_new(context_, FALSE))
+    {
+        thread_ = std::thread([this]()
+                              {
+            spdlog::debug("Bus reactor thread started");
+            g_main_context_push_thread_default(context_);
+            g_main_loop_run(loop_);
+            g_main_context_pop_thread_default(context_);
+            spdlog::debug("Bus reactor thread exiting"); });
+    }
+
+    BusReactor::~BusReactor()
+    {
+        // Quit from inside the loop so a quit issued before run() is not lost
+        post([this]()
+             { g_main_loop_quit(loop_); });
+        if (thread_.joinable())
+            thread_.join();
+        g_main_loop_unref(loop_);
+        g_main_context_unref(context_);
+    }
+
+    unsigned BusReactor::attach(GSource *source, GSourceFunc fn, gpointer data, GDestroyNotify destroy)
+    {
+        g_source_set_priority(source, G_PRIORITY_DEFAULT);
+        g_source_set_callback(source, fn, data, destroy);
+        unsigned id = g_source_attach(source, context_);
+        g_source_unref(source);
+        return id;
+    }
+
+    void BusReactor::post(Task task)
+    {
+        attach(
+            g_idle_source_new(),
+            [](gpointer data) -> gboolean
+            {
+                (*static_cast<Task *>(data))();
+                return G_SOURCE_REMOVE;
+            },
+            new Task(std::move(task)),
+            [](gpointer data)
+            { delete static_cast<Task *>(data); });
+    }
+
+    void BusReactor::run_sync(Task task)
+    {
+        if (in_reactor_thread())
+        {
+            task();
+            return;
+        }
+
+        std::promise<void> done;
+        auto finished = done.get_future();
+        post([&task, &done]()
+             {
+            task();
+            done.set_value(); });
+        finished.wait();
+    }
+
+    unsigned BusReactor::add_timer(unsigned interval_ms, TimerFn fn)
+    {
+        return attach(
+            g_timeout_source_new(interval_ms),
+            [](gpointer data) -> gboolean
+            {
+                return (*static_cast<TimerFn *>(data))() ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+            },
+            new TimerFn(std::move(fn)),
+            [](gpointer data)
+            { delete static_cast<TimerFn *>(data); });
+    }
+
+    unsigned BusReactor::watch_bus(GstBus *bus, BusFn fn)
+    {
+        GstBusFunc dispatch = [](GstBus *, GstMessage *msg, gpointer data) -> gboolean
+        {
+            (*static_cast<BusFn *>(data))(msg);
+            return G_SOURCE_CONTINUE;
+        };
+        return attach(
+            gst_bus_create_watch(bus),
+            G_SOURCE_FUNC(dispatch),
+            new BusFn(std::move(fn)),
+            [](gpointer data)
+            { delete static_cast<BusFn *>(data); });
+    }
+
+    void BusReactor::remove(unsigned id)
+    {
+        if (id == 0)
+            return;
+        if (GSource *source = g_main_context_find_source_by_id(context_, id))
+            g_source_destroy(source);
+    }
+
+} // namespace ist
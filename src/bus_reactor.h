@@ -0,0 +1,96 @@
+/**
+ * @file    bus_reactor.h
+ * @brief   Shared GLib main loop for pipeline bus watches and timers
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * One thread runs a GMainLoop on a private GMainContext for every camera.
+ * Pipeline buses are attached as watches, so ERROR/EOS/WARNING messages
+ * are dispatched as soon as they are posted instead of being polled, and
+ * restart backoff, idle timeouts and watchdogs are one-shot or periodic
+ * timers instead of sleeping threads.
+ */
+
+#pragma once
+
+#include <gst/gst.h>
+#include <functional>
+#include <thread>
+
+namespace ist
+{
+
+    /**
+     * @brief Event loop shared by all CameraPipeline instances
+     *
+     * Thread Safety:
+     *   - post(), run_sync(), add_timer() and watch_bus() may be called
+     *     from any thread
+     *   - remove() must be called on the reactor thread (from a callback or
+     *     inside run_sync()) so a source cannot fire after it returns
+     *   - All callbacks run on the reactor thread, one at a time
+     */
+    class BusReactor
+    {
+    public:
+        /// Deferred task
+        using Task = std::function<void()>;
+
+        /// Timer callback; return true to keep the timer running
+        using TimerFn = std::function<bool()>;
+
+        /// Bus message callback (the message is owned by the watch)
+        using BusFn = std::function<void(GstMessage *msg)>;
+
+        /** @brief Start the reactor thread */
+        BusReactor();
+
+        /** @brief Quit the loop and join the reactor thread */
+        ~BusReactor();
+
+        // Non-copyable, non-movable
+        BusReactor(const BusReactor &) = delete;
+        BusReactor &operator=(const BusReactor &) = delete;
+
+        /** @brief Run @p task on the reactor thread, in posting order */
+        void post(Task task);
+
+        /**
+         * @brief Run @p task on the reactor thread and wait for it
+         *
+         * Runs inline when already on the reactor thread. Also acts as a
+         * barrier: everything posted before it has run when it returns.
+         */
+        void run_sync(Task task);
+
+        /**
+         * @brief  Call @p fn every @p interval_ms until it returns false
+         * @return Source ID for remove()
+         */
+        unsigned add_timer(unsigned interval_ms, TimerFn fn);
+
+        /**
+         * @brief  Dispatch every message posted on @p bus to @p fn
+         * @return Source ID for remove()
+         */
+        unsigned watch_bus(GstBus *bus, BusFn fn);
+
+        /** @brief Remove a timer or bus watch (no-op for 0 or an expired source) */
+        void remove(unsigned id);
+
+        /** @brief True when called from the reactor thread */
+        bool in_reactor_thread() const { return std::this_thread::get_id() == thread_.get_id(); }
+
+    private:
+        /// Attach a callback source at default priority and return its ID
+        unsigned attach(GSource *source, GSourceFunc fn, gpointer data, GDestroyNotify destroy);
+
+        GMainContext *context_;
+        GMainLoop *loop_;
+        std::thread thread_;
+    };
+
+} // namespace ist
@@ -9,203 +9,1198 @@
  *
  * Implements camera pipeline lifecycle management, GStreamer bus monitoring,
  * and automatic recovery with exponential backoff for resilient operation
- * in industrial environments.
+ * in industrial environments. Recovery replaces the source bin alone when
+ * the failure came from it, so encoders keep their state and caps.
  */
 
 #include "camera_pipeline.h"
+#include "thread_placement.h"
 #include <spdlog/spdlog.h>
-#include <cstring>
+#include <gst/video/video.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 
 namespace ist
 {
 
-    CameraPipeline::CameraPipeline(const CameraConfig &config)
-        : config_(config)
+    /**
+     * @brief Invoke fn(start, size, header) for each Annex B NAL unit
+     *
+     * `start` points at the start code, so the range can be copied verbatim
+     * into another byte-stream access unit. `header` is the first NAL header
+     * byte; the type bits differ between H.264 and H.265 (see nal_type()).
+     */
+    template <typename Fn>
+    static void for_each_nal(const std::byte *data, size_t size, Fn fn)
     {
+        auto u8 = [data](size_t i)
+        { return std::to_integer<uint8_t>(data[i]); };
+
+        size_t prev_start = size; // start code offset of the current NAL
+        size_t prev_header = 0;   // offset of its NAL header byte
+        size_t i = 0;
+        while (i + 2 < size)
+        {
+            if (u8(i) == 0 && u8(i + 1) == 0 && u8(i + 2) == 1)
+            {
+                size_t start = (i > 0 && u8(i - 1) == 0) ? i - 1 : i;
+                if (prev_start < size)
+                    fn(data + prev_start, start - prev_start, u8(prev_header));
+                prev_start = start;
+                prev_header = i + 3;
+                i += 3;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        if (prev_start < size && prev_header < size)
+            fn(data + prev_start, size - prev_start, u8(prev_header));
+    }
+
+    /// NAL unit type from the first header byte
+    static uint8_t nal_type(VideoCodec codec, uint8_t header)
+    {
+        return codec == VideoCodec::H265 ? (header >> 1) & 0x3F : header & 0x1F;
+    }
+
+    /// True for the NAL units a decoder needs before an IDR (SPS/PPS, plus VPS for H.265)
+    static bool is_parameter_set(VideoCodec codec, uint8_t type)
+    {
+        if (codec == VideoCodec::H265)
+            return type == 32 || type == 33 || type == 34; // VPS, SPS, PPS
+        return type == 7 || type == 8;                     // SPS, PPS
+    }
+
+    /// Parser normalising @p codec to what the packetizers expect (byte-stream AUs / OBU TUs)
+    static std::string parse_chain(VideoCodec codec)
+    {
+        switch (codec)
+        {
+        case VideoCodec::H265:
+            return "h265parse config-interval=-1 ! video/x-h265,stream-format=byte-stream,alignment=au";
+        case VideoCodec::AV1:
+            return "av1parse ! video/x-av1,stream-format=obu-stream,alignment=tu";
+        case VideoCodec::H264:
+            break;
+        }
+        return "h264parse config-interval=-1 ! video/x-h264,stream-format=byte-stream,alignment=au";
+    }
+
+    /// Milliseconds elapsed since @p start
+    static int64_t elapsed_ms(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
+    /// Caps string for @p media at @p mode ("video/x-raw,width=...,framerate=30/1")
+    static std::string mode_caps(const std::string &media, const VideoMode &mode)
+    {
+        return media + ",width=" + std::to_string(mode.width) +
+               ",height=" + std::to_string(mode.height) +
+               ",framerate=" + std::to_string(mode.fps) + "/1";
+    }
+
+    /// Set @p element to NULL, waiting up to 3 s so a dead RTSP socket cannot block us
+    static void set_state_null(GstElement *element, const std::string &id)
+    {
+        GstStateChangeReturn ret = gst_element_set_state(element, GST_STATE_NULL);
+        if (ret == GST_STATE_CHANGE_ASYNC)
+        {
+            GstState state;
+            ret = gst_element_get_state(element, &state, nullptr, 3 * GST_SECOND);
+            if (ret == GST_STATE_CHANGE_FAILURE || ret == GST_STATE_CHANGE_ASYNC)
+            {
+                spdlog::warn("[{}] State change of {} to NULL timed out, forcing",
+                             id, GST_ELEMENT_NAME(element));
+            }
+        }
+    }
+
+    /// Element factories per backend and codec, in order of preference
+    static std::vector<const char *> encoder_factories(EncoderType type, VideoCodec codec)
+    {
+        if (codec == VideoCodec::H265)
+        {
+            switch (type)
+            {
+            case EncoderType::VAAPI:
+                return {"vaapih265enc"};
+            case EncoderType::NVENC:
+                return {"nvh265enc", "nvv4l2h265enc"};
+            case EncoderType::V4L2:
+                return {"v4l2h265enc"};
+            case EncoderType::QSV:
+                return {"qsvh265enc"};
+            case EncoderType::SOFTWARE:
+            case EncoderType::AUTO:
+                break;
+            }
+            return {"x265enc"};
+        }
+        if (codec == VideoCodec::AV1)
+        {
+            switch (type)
+            {
+            case EncoderType::VAAPI:
+                return {"vaav1enc"}; // gstreamer-vaapi has no AV1 encoder; the va plugin does
+            case EncoderType::NVENC:
+                return {"nvav1enc", "nvv4l2av1enc"};
+            case EncoderType::V4L2:
+                return {};
+            case EncoderType::QSV:
+                return {"qsvav1enc"};
+            case EncoderType::SOFTWARE:
+            case EncoderType::AUTO:
+                break;
+            }
+            return {"svtav1enc"};
+        }
+
+        switch (type)
+        {
+        case EncoderType::VAAPI:
+            return {"vaapih264enc"};
+        case EncoderType::NVENC:
+            return {"nvh264enc", "nvv4l2h264enc"};
+        case EncoderType::V4L2:
+            return {"v4l2h264enc"};
+        case EncoderType::QSV:
+            return {"qsvh264enc"};
+        case EncoderType::SOFTWARE:
+        case EncoderType::AUTO:
+            break;
+        }
+        return {"x264enc"};
+    }
+
+    /// True if an element factory is installed
+    static bool has_factory(const char *name)
+    {
+        GstElementFactory *factory = gst_element_factory_find(name);
+        if (!factory)
+            return false;
+        gst_object_unref(factory);
+        return true;
+    }
+
+    /// First installed element of @p type for @p codec (nullptr if none)
+    static const char *installed_encoder(EncoderType type, VideoCodec codec)
+    {
+        for (const char *name : encoder_factories(type, codec))
+        {
+            if (has_factory(name))
+                return name;
+        }
+        return nullptr;
+    }
+
+    /// Element for @p codec on the probed backend; a Jetson backend stays on its nvv4l2 family
+    static std::string find_encoder(EncoderType type, VideoCodec codec, const std::string &primary)
+    {
+        const bool jetson = primary.rfind("nvv4l2", 0) == 0;
+        for (const char *name : encoder_factories(type, codec))
+        {
+            if ((std::string(name).rfind("nvv4l2", 0) == 0) == jetson && has_factory(name))
+                return name;
+        }
+        const char *name = installed_encoder(type, codec);
+        if (name)
+            return name;
+        auto names = encoder_factories(type, codec);
+        return names.empty() ? std::string() : names.front();
+    }
+
+    CameraPipeline::CameraPipeline(const CameraConfig &config, BusReactor &reactor)
+        : config_(config), reactor_(reactor), mode_{config.width, config.height, config.fps},
+          buffer_pool_(BufferPool::create(config.id, static_cast<size_t>(config.buffer_pool_kb) * 1024))
+    {
+        // Encoded sources settle the codec first: without an encoder for
+        // it the camera is served as plain H.264
+        VideoCodec codec = config_.codec;
+        bool fallback = false;
+        if (!passthrough())
+        {
+            fallback = codec != VideoCodec::H264 && config_.h264_fallback;
+            if (codec != VideoCodec::H264 && !probe_encoder(codec, fallback))
+            {
+                spdlog::warn("[{}] No {} encoder available, using H.264", config_.id, video_codec_name(codec));
+                codec = VideoCodec::H264;
+                fallback = false;
+            }
+            if (codec == VideoCodec::H264)
+                probe_encoder(codec, false);
+        }
+
+        // Layer 0 is the camera itself; simulcast layers are scaled copies
+        auto add_layer = [this](std::string name, int width, int height, int bitrate, int min_bitrate,
+                                VideoCodec layer_codec)
+        {
+            auto layer = std::make_unique<Layer>();
+            layer->owner = this;
+            layer->index = layers_.size();
+            layer->info = {std::move(name), width, height, bitrate, layer_codec};
+            layer->min_bitrate = std::max(1, std::min(min_bitrate, bitrate));
+            layer->bitrate_kbps.store(std::min(config_.bitrate, bitrate));
+            layers_.push_back(std::move(layer));
+        };
+
+        int max_bitrate = config_.max_bitrate > 0 ? config_.max_bitrate : config_.bitrate;
+        int min_bitrate = config_.min_bitrate > 0 ? config_.min_bitrate : config_.bitrate / 4;
+        add_layer("full", config_.width, config_.height, max_bitrate, min_bitrate, codec);
+
+        for (const auto &lc : config_.simulcast)
+        {
+            int scale = std::max(1, lc.scale);
+            // Encoders want even dimensions
+            add_layer(lc.name, (config_.width / scale) & ~1, (config_.height / scale) & ~1,
+                      lc.bitrate, lc.bitrate / 4, codec);
+        }
+
+        // Full-size H.264 for browsers that cannot decode the camera codec;
+        // selected by codec negotiation only, never by bandwidth
+        if (fallback)
+            add_layer("h264", config_.width, config_.height, max_bitrate, min_bitrate, VideoCodec::H264);
+
+        for (auto &layer : layers_)
+        {
+            if (!passthrough())
+                layer->encoder_factory = find_encoder(encoder_, layer->info.codec, encoder_factory_);
+        }
+    }
+
+    bool CameraPipeline::probe_encoder(VideoCodec codec, bool fallback)
+    {
+        std::vector<EncoderType> candidates;
+        if (config_.encoder == EncoderType::AUTO)
+            candidates = {EncoderType::NVENC, EncoderType::QSV, EncoderType::VAAPI, EncoderType::V4L2};
+        else if (config_.encoder != EncoderType::SOFTWARE)
+            candidates = {config_.encoder};
+        candidates.push_back(EncoderType::SOFTWARE);
+
+        for (EncoderType type : candidates)
+        {
+            const char *name = installed_encoder(type, codec);
+            if (!name || (fallback && !installed_encoder(type, VideoCodec::H264)))
+                continue;
+
+            encoder_ = type;
+            encoder_factory_ = name;
+            if (type == EncoderType::SOFTWARE && config_.encoder != EncoderType::SOFTWARE &&
+                config_.encoder != EncoderType::AUTO)
+            {
+                spdlog::warn("[{}] Encoder '{}' not available, falling back to {}",
+                             config_.id, encoder_type_name(config_.encoder), name);
+            }
+            spdlog::info("[{}] Using encoder {} ({})", config_.id, name, encoder_type_name(type));
+            return true;
+        }
+
+        if (codec != VideoCodec::H264)
+            return false;
+
+        // Nothing installed — keep x264enc so the launch error names it
+        encoder_ = EncoderType::SOFTWARE;
+        encoder_factory_ = "x264enc";
+        spdlog::error("[{}] No H.264 encoder element found (install gst-plugins-ugly for x264enc)",
+                      config_.id);
+        return true;
+    }
+
+    bool CameraPipeline::jetson() const
+    {
+        return encoder_factory_.rfind("nvv4l2", 0) == 0;
+    }
+
+    size_t CameraPipeline::first_layer(VideoCodec codec) const
+    {
+        for (size_t i = 0; i < layers_.size(); i++)
+        {
+            if (layers_[i]->info.codec == codec)
+                return i;
+        }
+        return layers_.size();
+    }
+
+    size_t CameraPipeline::last_layer(VideoCodec codec) const
+    {
+        for (size_t i = layers_.size(); i-- > 0;)
+        {
+            if (layers_[i]->info.codec == codec)
+                return i;
+        }
+        return layers_.size();
+    }
+
+    void CameraPipeline::apply_bitrate(const Layer &layer, GstElement *encoder, int kbps) const
+    {
+        const std::string &factory = layer.encoder_factory;
+        if (factory.rfind("nvv4l2", 0) == 0)
+        {
+            // Jetson encoders take bits per second
+            g_object_set(G_OBJECT(encoder), "bitrate", static_cast<guint>(kbps) * 1000u, nullptr);
+        }
+        else if (factory == "svtav1enc")
+        {
+            g_object_set(G_OBJECT(encoder), "target-bitrate", static_cast<guint>(kbps), nullptr);
+        }
+        else if (factory.rfind("v4l2", 0) == 0)
+        {
+            // V4L2 controls are applied to the open device immediately
+            std::string controls = "controls,video_bitrate=" + std::to_string(kbps * 1000);
+            if (GstStructure *s = gst_structure_from_string(controls.c_str(), nullptr))
+            {
+                g_object_set(G_OBJECT(encoder), "extra-controls", s, nullptr);
+                gst_structure_free(s);
+            }
+        }
+        else
+        {
+            // x264enc, x265enc and the VA-API, NVENC and QSV encoders take kbps in PLAYING
+            g_object_set(G_OBJECT(encoder), "bitrate", static_cast<guint>(kbps), nullptr);
+        }
     }
 
     CameraPipeline::~CameraPipeline()
     {
         stop();
+
+        // Drain tasks posted before shutdown (they see shutdown_ and return)
+        reactor_.run_sync([] {});
     }
 
-    std::string CameraPipeline::build_pipeline_description() const
+    int CameraPipeline::gop_length() const
     {
-        std::string desc;
+        return config_.keyframe_interval > 0 ? config_.keyframe_interval : config_.fps * 2;
+    }
+
+    bool CameraPipeline::passthrough() const
+    {
+        return config_.type == CameraType::RTSP || config_.type == CameraType::RELAY;
+    }
+
+    bool CameraPipeline::can_force_keyframe() const
+    {
+        // RTSP is passthrough: there is no encoder in our pipeline to ask.
+        // A relay asks the origin, which owns the encoder.
+        if (config_.type == CameraType::RELAY)
+        {
+            std::lock_guard<std::mutex> lock(forwarder_mutex_);
+            return static_cast<bool>(keyframe_forwarder_);
+        }
+        return !passthrough();
+    }
+
+    void CameraPipeline::set_keyframe_forwarder(std::function<bool()> fn)
+    {
+        std::lock_guard<std::mutex> lock(forwarder_mutex_);
+        keyframe_forwarder_ = std::move(fn);
+    }
+
+    bool CameraPipeline::request_keyframe(size_t layer_idx)
+    {
+        if (!can_force_keyframe())
+            return false;
+        if (layer_idx >= layers_.size())
+            return true;
+        auto &layer = *layers_[layer_idx];
+
+        // Rate limit: many peers sending PLI for the same loss burst must
+        // not turn into a keyframe storm
+        auto now = std::chrono::steady_clock::now().time_since_epoch();
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+        int64_t last_ms = layer.last_keyframe_request_ms.load();
+        if (now_ms - last_ms < kMinKeyframeRequestIntervalMs)
+            return true;
+        if (!layer.last_keyframe_request_ms.compare_exchange_strong(last_ms, now_ms))
+            return true; // another thread just sent one
+
+        if (config_.type == CameraType::RELAY)
+        {
+            std::function<bool()> forward;
+            {
+                std::lock_guard<std::mutex> lock(forwarder_mutex_);
+                forward = keyframe_forwarder_;
+            }
+            if (!forward || !forward())
+                return false; // origin track gone: callers fall back to the cache
+            keyframe_requests_.fetch_add(1);
+            spdlog::debug("[{}] Keyframe requested from the origin (PLI/FIR)", config_.id);
+            return true;
+        }
 
-        switch (config_.type)
+        // Take a reference so a concurrent restart cannot free the sink
+        GstElement *sink = nullptr;
         {
-        case CameraType::RTSP:
-            // RTSP cameras: depay H264 and pass through
+            std::lock_guard<std::mutex> lock(element_mutex_);
+            if (layer.appsink)
+                sink = GST_ELEMENT(gst_object_ref(layer.appsink));
+        }
+        if (!sink)
+            return true;
+
+        // Upstream event from the sink travels back to this layer's encoder
+        // (the tee does not forward it into the other branches' encoders)
+        GstEvent *event = gst_video_event_new_upstream_force_key_unit(
+            GST_CLOCK_TIME_NONE, TRUE, 0);
+        bool handled = gst_element_send_event(sink, event);
+        gst_object_unref(sink);
+        if (!handled)
+        {
+            spdlog::warn("[{}] Force-keyframe event was not handled", config_.id);
+            return true;
+        }
+
+        keyframe_requests_.fetch_add(1);
+        spdlog::debug("[{}] Forced keyframe on layer '{}' (PLI/FIR)", config_.id, layer.info.name);
+        return true;
+    }
+
+    bool CameraPipeline::set_bitrate(int kbps, size_t layer_idx)
+    {
+        if (passthrough())
+            return false; // no encoder to adjust
+        if (layer_idx >= layers_.size())
+            return false;
+        auto &layer = *layers_[layer_idx];
+
+        kbps = std::clamp(kbps, layer.min_bitrate, std::max(layer.min_bitrate, layer.info.bitrate));
+        int current = layer.bitrate_kbps.load();
+
+        // Ignore jitter in the estimate: small steps cost more than they gain
+        if (std::abs(kbps - current) * 100 < current * kMinBitrateChangePercent)
+            return true;
+
+        layer.bitrate_kbps.store(kbps);
+
+        GstElement *encoder = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(element_mutex_);
+            if (layer.encoder)
+                encoder = GST_ELEMENT(gst_object_ref(layer.encoder));
+        }
+        if (!encoder)
+            return true; // applied on next (re)start via encoder_description
+
+        apply_bitrate(layer, encoder, kbps);
+        gst_object_unref(encoder);
+
+        spdlog::info("[{}] Encoder bitrate ({}) {} → {} kbps", config_.id, layer.info.name, current, kbps);
+        return true;
+    }
+
+    bool CameraPipeline::push_frame(const std::byte *data, size_t size)
+    {
+        GstElement *appsrc = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(element_mutex_);
+            if (appsrc_)
+                appsrc = GST_ELEMENT(gst_object_ref(appsrc_));
+        }
+        if (!appsrc || size == 0)
+        {
+            if (appsrc)
+                gst_object_unref(appsrc);
+            return false;
+        }
+
+        GstBuffer *buffer = gst_buffer_new_allocate(nullptr, size, nullptr);
+        gst_buffer_fill(buffer, 0, data, size);
+        GstFlowReturn ret = gst_app_src_push_buffer(GST_APP_SRC(appsrc), buffer); // takes the buffer
+        gst_object_unref(appsrc);
+        return ret == GST_FLOW_OK;
+    }
+
+    std::string CameraPipeline::element_name(const char *base, size_t layer)
+    {
+        return layer == 0 ? std::string(base) : base + std::to_string(layer);
+    }
+
+    VideoMode CameraPipeline::video_mode() const
+    {
+        std::lock_guard<std::mutex> lock(mode_mutex_);
+        return mode_;
+    }
+
+    std::string CameraPipeline::mode_filter(const std::string &media) const
+    {
+        return "capsfilter name=mode caps=\"" + mode_caps(media, video_mode()) + "\"";
+    }
+
+    std::string CameraPipeline::source_description() const
+    {
+        if (config_.type == CameraType::RTSP)
+        {
+            // RTSP cameras: receive and depay, H.264/H.265 is passed through
             // tcp-timeout: 5s for faster disconnect detection
-            desc = "rtspsrc location=" + config_.uri +
+            return "rtspsrc location=" + config_.uri +
                    " latency=0 protocols=tcp"
                    " tcp-timeout=5000000"
                    " retry=3"
-                   " ! rtph264depay"
-                   " ! h264parse config-interval=-1"
-                   " ! video/x-h264,stream-format=byte-stream,alignment=au"
-                   " ! appsink name=sink emit-signals=true sync=false"
-                   " max-buffers=2 drop=true";
-            break;
+                   " ! " + (codec() == VideoCodec::H265 ? "rtph265depay" : "rtph264depay");
+        }
 
-        case CameraType::USB:
+        if (config_.type == CameraType::RELAY)
         {
-            // USB camera with software or hardware encoding
-            if (config_.encoder == EncoderType::VAAPI)
-            {
-                // Intel Quick Sync via VA-API (outputs AVC, h264parse converts to byte-stream)
-                desc = "v4l2src device=" + config_.uri +
-                       " ! video/x-raw,width=" + std::to_string(config_.width) +
-                       ",height=" + std::to_string(config_.height) +
-                       ",framerate=" + std::to_string(config_.fps) + "/1" +
-                       " ! videoconvert" +
-                       " ! vaapih264enc rate-control=cbr bitrate=" + std::to_string(config_.bitrate) +
-                       " keyframe-period=" + std::to_string(config_.fps * 2) +
-                       " ! h264parse config-interval=-1" +
-                       " ! video/x-h264,stream-format=byte-stream,alignment=au" +
-                       " ! appsink name=sink emit-signals=true sync=false" +
-                       " max-buffers=2 drop=true";
-            }
-            else
+            // Access units pushed by RelayClient, stamped with running time
+            // on arrival; the byte limit only guards against a stuck graph
+            return "appsrc name=relaysrc is-live=true format=time do-timestamp=true"
+                   " max-bytes=4000000"
+                   " caps=\"video/x-h264,stream-format=byte-stream,alignment=au\"";
+        }
+
+        if (config_.type == CameraType::USB)
+        {
+            // Device could not be probed yet — conservative default
+            const CapturePlan plan = capture_planned_ ? capture_ : raw_capture();
+            return plan.source + " ! " + mode_filter(plan.media) + plan.convert;
+        }
+
+        // Test pattern straight in NV12, which every encoder backend accepts
+        return "videotestsrc is-live=true pattern=smpte ! " + mode_filter("video/x-raw,format=NV12") +
+               " ! clockoverlay font-desc=\"Sans 36\" time-format=\"%H:%M:%S\"";
+    }
+
+    CameraPipeline::DeviceModes CameraPipeline::probe_device() const
+    {
+        DeviceModes modes;
+        GstElement *src = gst_element_factory_make("v4l2src", nullptr);
+        if (!src)
+            return modes;
+
+        g_object_set(G_OBJECT(src), "device", config_.uri.c_str(), nullptr);
+        if (gst_element_set_state(src, GST_STATE_READY) != GST_STATE_CHANGE_FAILURE)
+        {
+            GstPad *pad = gst_element_get_static_pad(src, "src");
+            GstCaps *device_caps = pad ? gst_pad_query_caps(pad, nullptr) : nullptr;
+            if (device_caps)
             {
-                // Software x264 encoding
-                desc = "v4l2src device=" + config_.uri +
-                       " ! video/x-raw,width=" + std::to_string(config_.width) +
-                       ",height=" + std::to_string(config_.height) +
-                       ",framerate=" + std::to_string(config_.fps) + "/1" +
-                       " ! videoconvert" +
-                       " ! x264enc tune=zerolatency bitrate=" + std::to_string(config_.bitrate) +
-                       " speed-preset=ultrafast" +
-                       " key-int-max=" + std::to_string(config_.fps * 2) +
-                       " bframes=0 b-adapt=false" +
-                       " sliced-threads=true threads=" + std::to_string(std::max(1u, std::thread::hardware_concurrency() / 4)) +
-                       " ! video/x-h264,stream-format=byte-stream,alignment=au,profile=baseline" +
-                       " ! h264parse config-interval=-1" +
-                       " ! appsink name=sink emit-signals=true sync=false" +
-                       " max-buffers=2 drop=true";
+                modes.opened = true;
+                const VideoMode mode = video_mode();
+                auto offers = [device_caps, &mode](const std::string &media)
+                {
+                    GstCaps *wanted = gst_caps_from_string(mode_caps(media, mode).c_str());
+                    bool ok = wanted && gst_caps_can_intersect(device_caps, wanted);
+                    if (wanted)
+                        gst_caps_unref(wanted);
+                    return ok;
+                };
+                modes.nv12 = offers("video/x-raw,format=NV12");
+                modes.i420 = offers("video/x-raw,format=I420");
+                modes.yuy2 = offers("video/x-raw,format=YUY2");
+                modes.mjpeg = offers("image/jpeg");
+                gst_caps_unref(device_caps);
             }
-            break;
+            if (pad)
+                gst_object_unref(pad);
+        }
+        gst_element_set_state(src, GST_STATE_NULL);
+        gst_object_unref(src);
+        return modes;
+    }
+
+    CameraPipeline::CapturePlan CameraPipeline::raw_capture() const
+    {
+        CapturePlan plan;
+        plan.source = "v4l2src device=" + config_.uri;
+        plan.media = "video/x-raw";
+        if (!jetson())
+            plan.convert = " ! videoconvert"; // nvvidconv converts on Jetson
+        return plan;
+    }
+
+    void CameraPipeline::plan_capture()
+    {
+        const VideoMode mode = video_mode();
+        DeviceModes modes = probe_device();
+        if (!modes.opened)
+        {
+            spdlog::warn("[{}] Cannot query {} capture formats, using raw + videoconvert",
+                         config_.id, config_.uri);
+            return; // retried on the next launch
         }
 
-        case CameraType::TEST:
+        const std::string src = "v4l2src device=" + config_.uri;
+        const bool jetson = this->jetson();
+        const bool want_raw = config_.capture_format != CaptureFormat::MJPEG;
+        const bool want_mjpeg = config_.capture_format != CaptureFormat::RAW;
+
+        CapturePlan plan;
+
+        // Raw formats the encoder (or its own front end) takes without conversion
+        const char *native = nullptr;
+        if (want_raw)
         {
-            // Test pattern with software or hardware encoding
-            if (config_.encoder == EncoderType::VAAPI)
+            if (modes.nv12)
+                native = "NV12";
+            else if (modes.i420 && encoder_ != EncoderType::VAAPI && encoder_ != EncoderType::QSV)
+                native = "I420";
+            else if (modes.yuy2 && (jetson || encoder_ == EncoderType::V4L2))
+                native = "YUY2"; // nvvidconv / the M2M encoder convert in hardware
+        }
+
+        if (native)
+        {
+            // VA-API imports the capture buffers directly
+            plan.source = src + (encoder_ == EncoderType::VAAPI ? " io-mode=dmabuf" : "");
+            plan.media = std::string("video/x-raw,format=") + native;
+        }
+        else if (want_raw && modes.yuy2 && encoder_ == EncoderType::VAAPI)
+        {
+            // DMABUF into the GPU for YUY2 → NV12, no CPU copy
+            plan.source = src + " io-mode=dmabuf";
+            plan.media = "video/x-raw,format=YUY2";
+            plan.convert = " ! vaapipostproc";
+            plan.memory = FrameMemory::VA;
+        }
+        else if (want_mjpeg && (modes.mjpeg || config_.capture_format == CaptureFormat::MJPEG))
+        {
+            plan.source = src;
+            plan.media = "image/jpeg";
+            plan.convert = " ! jpegparse";
+            if (encoder_ == EncoderType::VAAPI && has_factory("vaapijpegdec"))
             {
-                // Intel Quick Sync via VA-API (outputs AVC, h264parse converts to byte-stream)
-                desc = "videotestsrc is-live=true pattern=smpte"
-                       " ! video/x-raw,width=" +
-                       std::to_string(config_.width) +
-                       ",height=" + std::to_string(config_.height) +
-                       ",framerate=" + std::to_string(config_.fps) + "/1"
-                                                                     " ! videoconvert"
-                                                                     " ! clockoverlay font-desc=\"Sans 36\" time-format=\"%H:%M:%S\""
-                                                                     " ! vaapih264enc rate-control=cbr bitrate=" +
-                       std::to_string(config_.bitrate) +
-                       " keyframe-period=" + std::to_string(config_.fps * 2) +
-                       " ! h264parse config-interval=-1"
-                       " ! video/x-h264,stream-format=byte-stream,alignment=au"
-                       " ! appsink name=sink emit-signals=true sync=false"
-                       " max-buffers=2 drop=true";
+                plan.convert += " ! vaapijpegdec";
+                plan.memory = FrameMemory::VA;
+            }
+            else if (jetson && has_factory("nvv4l2decoder"))
+            {
+                plan.convert += " ! nvv4l2decoder mjpeg=1";
+                plan.memory = FrameMemory::NVMM;
+            }
+            else if (encoder_ == EncoderType::V4L2 && has_factory("v4l2jpegdec"))
+            {
+                plan.convert += " ! v4l2jpegdec";
             }
             else
             {
-                // Software x264 encoding
-                desc = "videotestsrc is-live=true pattern=smpte"
-                       " ! video/x-raw,width=" +
-                       std::to_string(config_.width) +
-                       ",height=" + std::to_string(config_.height) +
-                       ",framerate=" + std::to_string(config_.fps) + "/1"
-                                                                     " ! videoconvert"
-                                                                     " ! clockoverlay font-desc=\"Sans 36\" time-format=\"%H:%M:%S\""
-                                                                     " ! x264enc tune=zerolatency bitrate=" +
-                       std::to_string(config_.bitrate) +
-                       " speed-preset=ultrafast key-int-max=" + std::to_string(config_.fps * 2) +
-                       " bframes=0 b-adapt=false" +
-                       " ! video/x-h264,stream-format=byte-stream,alignment=au,profile=baseline" +
-                       " ! h264parse config-interval=-1" +
-                       " ! appsink name=sink emit-signals=true sync=false" +
-                       " max-buffers=2 drop=true";
+                // Software decode emits planar 4:2:0/4:2:2; convert only if needed
+                plan.convert += " ! jpegdec";
+                if (!jetson)
+                    plan.convert += " ! videoconvert";
             }
+        }
+        else
+        {
+            plan = raw_capture();
+        }
+
+        capture_ = plan;
+        planned_mode_ = mode;
+        capture_planned_ = true;
+        capture_fallback_ = false;
+        spdlog::info("[{}] Capture formats at {}x{}@{}: nv12={} i420={} yuy2={} mjpeg={} → {} ! {}{}",
+                     config_.id, mode.width, mode.height, mode.fps,
+                     modes.nv12, modes.i420, modes.yuy2, modes.mjpeg,
+                     plan.source, plan.media, plan.convert);
+    }
+
+    std::string CameraPipeline::scaler_description(const Layer &layer) const
+    {
+        const std::string size = "width=" + std::to_string(layer.info.width) +
+                                 ",height=" + std::to_string(layer.info.height);
+        switch (config_.type == CameraType::USB ? capture_.memory : FrameMemory::SYSTEM)
+        {
+        case FrameMemory::VA:
+            return "vaapipostproc width=" + std::to_string(layer.info.width) +
+                   " height=" + std::to_string(layer.info.height);
+        case FrameMemory::NVMM:
+            return "nvvidconv ! video/x-raw(memory:NVMM)," + size;
+        case FrameMemory::SYSTEM:
             break;
         }
+        return "videoscale ! video/x-raw," + size;
+    }
+
+    std::string CameraPipeline::encoder_description(const Layer &layer) const
+    {
+        std::string desc;
+        std::string enc = element_name("enc", layer.index);
+        std::string sink = element_name("sink", layer.index);
+        int bitrate = layer.bitrate_kbps.load();
+
+        const std::string gop = std::to_string(gop_length());
+        const std::string &factory = layer.encoder_factory;
+        const std::string byte_stream = " ! " + parse_chain(VideoCodec::H264);
+
+        // Every backend: CBR, no B-frames, fastest preset — the hardware
+        // equivalents of x264 tune=zerolatency
+        if (layer.info.codec != VideoCodec::H264)
+        {
+            desc = hevc_av1_encoder(layer);
+        }
+        else if (encoder_ == EncoderType::VAAPI)
+        {
+            // Intel Quick Sync via VA-API (outputs AVC, h264parse converts to byte-stream)
+            desc = "vaapih264enc name=" + enc + " rate-control=cbr bitrate=" + std::to_string(bitrate) +
+                   " keyframe-period=" + gop + " max-bframes=0" + byte_stream;
+        }
+        else if (factory == "nvh264enc")
+        {
+            // NVIDIA dGPU NVENC
+            desc = "nvh264enc name=" + enc + " preset=low-latency-hq rc-mode=cbr zerolatency=true"
+                   " bframes=0 bitrate=" + std::to_string(bitrate) +
+                   " gop-size=" + gop + byte_stream;
+        }
+        else if (factory == "nvv4l2h264enc")
+        {
+            // Jetson: encoder wants NVMM buffers; bitrate in bps
+            desc = "nvvidconv ! video/x-raw(memory:NVMM),format=NV12"
+                   " ! nvv4l2h264enc name=" + enc + " control-rate=1 preset-level=1 maxperf-enable=true"
+                   " num-B-Frames=0 insert-sps-pps=true poc-type=2"
+                   " bitrate=" + std::to_string(bitrate * 1000) +
+                   " iframeinterval=" + gop + " idrinterval=" + gop + byte_stream;
+        }
+        else if (encoder_ == EncoderType::V4L2)
+        {
+            // V4L2 mem2mem (Raspberry Pi); B-frames are never produced
+            desc = "v4l2h264enc name=" + enc +
+                   " extra-controls=\"controls,video_bitrate_mode=1,video_bitrate=" +
+                   std::to_string(bitrate * 1000) + ",h264_i_frame_period=" + gop +
+                   ",repeat_sequence_header=1\""
+                   " ! video/x-h264,level=(string)4,profile=constrained-baseline" +
+                   byte_stream;
+        }
+        else if (encoder_ == EncoderType::QSV)
+        {
+            // Intel Quick Sync via oneVPL; target-usage 7 = fastest
+            desc = "qsvh264enc name=" + enc + " target-usage=7 rate-control=cbr b-frames=0 ref-frames=1"
+                   " bitrate=" + std::to_string(bitrate) +
+                   " gop-size=" + gop + byte_stream;
+        }
+        else
+        {
+            // Software x264 encoding; threads are split across layers
+            unsigned threads = x264_threads();
+            desc = "x264enc name=" + enc + " tune=zerolatency bitrate=" + std::to_string(bitrate) +
+                   " speed-preset=ultrafast" +
+                   " key-int-max=" + gop +
+                   " bframes=0 b-adapt=false";
+            if (config_.type == CameraType::USB)
+            {
+                desc += " sliced-threads=true threads=" + std::to_string(threads);
+            }
+            desc += " ! video/x-h264,stream-format=byte-stream,alignment=au,profile=baseline"
+                    " ! h264parse config-interval=-1";
+        }
+
+        return desc + " ! appsink name=" + sink + " emit-signals=true sync=false max-buffers=2 drop=true";
+    }
+
+    std::string CameraPipeline::hevc_av1_encoder(const Layer &layer) const
+    {
+        const std::string enc = element_name("enc", layer.index);
+        const std::string &factory = layer.encoder_factory;
+        const std::string bitrate = std::to_string(layer.bitrate_kbps.load());
+        const std::string gop = std::to_string(gop_length());
+        const std::string parse = " ! " + parse_chain(layer.info.codec);
+        std::string desc;
+
+        // Same low-latency settings as the H.264 backends
+        if (factory == "vaapih265enc")
+        {
+            desc = "vaapih265enc name=" + enc + " rate-control=cbr bitrate=" + bitrate +
+                   " keyframe-period=" + gop + " max-bframes=0";
+        }
+        else if (factory == "vaav1enc")
+        {
+            desc = "vaav1enc name=" + enc + " rate-control=cbr bitrate=" + bitrate + " key-int-max=" + gop;
+        }
+        else if (factory == "nvh265enc")
+        {
+            desc = "nvh265enc name=" + enc + " preset=low-latency-hq rc-mode=cbr zerolatency=true"
+                   " bframes=0 bitrate=" + bitrate + " gop-size=" + gop;
+        }
+        else if (factory == "nvav1enc")
+        {
+            desc = "nvav1enc name=" + enc + " preset=p1 tune=ultra-low-latency rc-mode=cbr"
+                   " bitrate=" + bitrate + " gop-size=" + gop;
+        }
+        else if (factory == "nvv4l2h265enc" || factory == "nvv4l2av1enc")
+        {
+            // Jetson: NVMM input, bitrate in bps
+            desc = "nvvidconv ! video/x-raw(memory:NVMM),format=NV12 ! " + factory + " name=" + enc +
+                   " control-rate=1 preset-level=1 maxperf-enable=true"
+                   " bitrate=" + std::to_string(layer.bitrate_kbps.load() * 1000) +
+                   " iframeinterval=" + gop + " idrinterval=" + gop;
+            if (layer.info.codec == VideoCodec::H265)
+                desc += " num-B-Frames=0 insert-sps-pps=true";
+        }
+        else if (factory == "v4l2h265enc")
+        {
+            desc = "v4l2h265enc name=" + enc +
+                   " extra-controls=\"controls,video_bitrate_mode=1,video_bitrate=" +
+                   std::to_string(layer.bitrate_kbps.load() * 1000) + ",video_gop_size=" + gop +
+                   ",repeat_sequence_header=1\"";
+        }
+        else if (factory == "qsvh265enc" || factory == "qsvav1enc")
+        {
+            desc = factory + " name=" + enc + " target-usage=7 rate-control=cbr"
+                   " bitrate=" + bitrate + " gop-size=" + gop;
+            if (layer.info.codec == VideoCodec::H265)
+                desc += " b-frames=0 ref-frames=1";
+        }
+        else if (layer.info.codec == VideoCodec::H265)
+        {
+            // Software x265 takes planar 4:2:0 only; pools split the CPUs like x264 threads
+            desc = "videoconvert ! video/x-raw,format=I420 ! x265enc name=" + enc +
+                   " tune=zerolatency speed-preset=ultrafast bitrate=" + bitrate +
+                   " key-int-max=" + gop +
+                   " option-string=\"bframes=0:repeat-headers=1:pools=" + std::to_string(x264_threads()) + "\"";
+        }
+        else
+        {
+            // Software SVT-AV1 in its fastest real-time preset
+            desc = "videoconvert ! video/x-raw,format=I420 ! svtav1enc name=" + enc +
+                   " preset=12 target-bitrate=" + bitrate + " intra-period-length=" + gop;
+        }
+        return desc + parse;
+    }
+
+    unsigned CameraPipeline::x264_threads() const
+    {
+        // Pinned cameras own their CPUs; otherwise leave room for the
+        // other cameras and the send path
+        unsigned cpus = thread_policy_cpu_count(config_.threads);
+        unsigned share = config_.threads.cpus.empty() ? cpus / 4 : cpus;
+        return std::max(1u, share / static_cast<unsigned>(layers_.size()));
+    }
+
+    std::string CameraPipeline::branches_description() const
+    {
+        if (passthrough())
+        {
+            // Passthrough: only normalise to byte-stream access units
+            return parse_chain(codec()) +
+                   " ! appsink name=sink emit-signals=true sync=false"
+                   " max-buffers=2 drop=true";
+        }
+
+        // USB camera or test pattern with software or hardware encoding
+        if (layers_.size() == 1)
+        {
+            return encoder_description(*layers_[0]);
         }
 
+        // Simulcast: capture and convert once, then one scaled encoder per
+        // layer. Leaky queues keep a slow layer from stalling the others.
+        std::string desc = "tee name=t";
+        for (const auto &layer : layers_)
+        {
+            desc += " t. ! queue max-size-buffers=2 max-size-bytes=0 max-size-time=0 leaky=downstream";
+            if (layer->index > 0)
+                desc += " ! " + scaler_description(*layer);
+            desc += " ! " + encoder_description(*layer);
+        }
         return desc;
     }
 
-    bool CameraPipeline::launch_pipeline()
+    GstElement *CameraPipeline::make_bin(const std::string &desc, const char *name) const
     {
-        std::string desc = build_pipeline_description();
-        spdlog::info("[{}] Launching pipeline: {}", config_.id, desc);
-
         GError *error = nullptr;
-        pipeline_ = gst_parse_launch(desc.c_str(), &error);
-        if (!pipeline_ || error)
+        GstElement *bin = gst_parse_bin_from_description(desc.c_str(), TRUE, &error);
+        if (!bin || error)
         {
-            spdlog::error("[{}] Failed to create pipeline: {}",
-                          config_.id, error ? error->message : "unknown error");
+            spdlog::error("[{}] Failed to create {} bin: {}",
+                          config_.id, name, error ? error->message : "unknown error");
             if (error)
                 g_error_free(error);
+            if (bin)
+                gst_object_unref(bin);
+            return nullptr;
+        }
+        gst_object_set_name(GST_OBJECT(bin), name);
+        return bin;
+    }
+
+    bool CameraPipeline::launch_pipeline()
+    {
+        auto launch_t0 = std::chrono::steady_clock::now();
+        if (config_.type == CameraType::USB && (!capture_planned_ || planned_mode_ != video_mode()))
+            plan_capture();
+
+        std::string source_desc = source_description();
+        std::string branches_desc = branches_description();
+        spdlog::info("[{}] Launching pipeline: {} ! {}", config_.id, source_desc, branches_desc);
+
+        // Two bins joined by ghost pads, so the source can be swapped alone
+        GstElement *source = make_bin(source_desc, "source");
+        GstElement *branches = source ? make_bin(branches_desc, "branches") : nullptr;
+        if (!branches)
+        {
+            if (source)
+                gst_object_unref(source);
             return false;
         }
 
-        // Get appsink element
-        appsink_ = gst_bin_get_by_name(GST_BIN(pipeline_), "sink");
-        if (!appsink_)
+        pipeline_ = gst_pipeline_new(config_.id.c_str());
+        gst_bin_add_many(GST_BIN(pipeline_), source, branches, nullptr);
+        if (!gst_element_link(source, branches))
         {
-            spdlog::error("[{}] Failed to get appsink element", config_.id);
+            spdlog::error("[{}] Failed to link source to encoder branches", config_.id);
             gst_object_unref(pipeline_);
             pipeline_ = nullptr;
             return false;
         }
+        source_ = source;
 
-        // Configure appsink callbacks
-        GstAppSinkCallbacks callbacks = {};
-        callbacks.new_sample = &CameraPipeline::on_new_sample;
-        gst_app_sink_set_callbacks(GST_APP_SINK(appsink_), &callbacks, this, nullptr);
+        // Streaming threads (and the encoder pools they spawn) place
+        // themselves when they start; STREAM_STATUS is posted synchronously
+        // from the new thread
+        if (thread_placement_active())
+        {
+            GstBus *sync_bus = gst_element_get_bus(pipeline_);
+            gst_bus_set_sync_handler(sync_bus, &CameraPipeline::on_sync_message, this, nullptr);
+            gst_object_unref(sync_bus);
+        }
+
+        // Get one appsink per layer
+        std::vector<GstElement *> sinks;
+        for (const auto &layer : layers_)
+        {
+            std::string name = element_name("sink", layer->index);
+            GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline_), name.c_str());
+            if (!sink)
+            {
+                spdlog::error("[{}] Failed to get appsink element '{}'", config_.id, name);
+                for (GstElement *s : sinks)
+                    gst_object_unref(s);
+                gst_object_unref(pipeline_);
+                pipeline_ = nullptr;
+                source_ = nullptr;
+                return false;
+            }
+
+            // Configure appsink callbacks
+            GstAppSinkCallbacks callbacks = {};
+            callbacks.new_sample = &CameraPipeline::on_new_sample;
+            gst_app_sink_set_callbacks(GST_APP_SINK(sink), &callbacks, layer.get(), nullptr);
+            sinks.push_back(sink);
+        }
 
-        // Start pipeline
-        GstStateChangeReturn ret = gst_element_set_state(pipeline_, GST_STATE_PLAYING);
+        // Start pipeline — a parked on-demand camera only goes to READY, which
+        // builds the graph and opens the device so resuming is cheap
+        GstState target = idle_.load() ? GST_STATE_READY : GST_STATE_PLAYING;
+        auto t0 = std::chrono::steady_clock::now();
+        GstStateChangeReturn ret = gst_element_set_state(pipeline_, target);
         if (ret == GST_STATE_CHANGE_FAILURE)
         {
-            spdlog::error("[{}] Failed to set pipeline to PLAYING", config_.id);
-            gst_object_unref(appsink_);
+            spdlog::error("[{}] Failed to set pipeline to {}",
+                          config_.id, gst_element_state_get_name(target));
+            for (GstElement *sink : sinks)
+                gst_object_unref(sink);
             gst_object_unref(pipeline_);
-            appsink_ = nullptr;
             pipeline_ = nullptr;
+            source_ = nullptr;
             return false;
         }
 
-        spdlog::info("[{}] Pipeline launched successfully", config_.id);
+        {
+            std::lock_guard<std::mutex> lock(element_mutex_);
+            for (auto &layer : layers_)
+            {
+                std::string enc = element_name("enc", layer->index);
+                layer->appsink = sinks[layer->index];
+                layer->encoder = gst_bin_get_by_name(GST_BIN(pipeline_), enc.c_str()); // null for RTSP
+            }
+            appsrc_ = gst_bin_get_by_name(GST_BIN(source_), "relaysrc"); // null unless RELAY
+        }
+
+        last_start_ms_.store(elapsed_ms(t0));
+        if (target == GST_STATE_PLAYING)
+        {
+            warmup_start_.store(t0);
+            awaiting_first_frame_.store(true);
+        }
+
+        // Messages are dispatched on the shared reactor as they are posted
+        GstBus *bus = gst_element_get_bus(pipeline_);
+        bus_watch_id_ = reactor_.watch_bus(bus, [this](GstMessage *msg)
+                                           { handle_bus_message(msg); });
+        gst_object_unref(bus);
+
+        last_launch_ms_.store(elapsed_ms(launch_t0));
+        spdlog::info("[{}] Pipeline launched successfully ({}, state change {} ms, total {} ms)",
+                     config_.id, gst_element_state_get_name(target), last_start_ms_.load(),
+                     last_launch_ms_.load());
         return true;
     }
 
     void CameraPipeline::destroy_pipeline()
     {
+        reactor_.remove(bus_watch_id_);
+        bus_watch_id_ = 0;
+
         if (pipeline_)
         {
+            auto t0 = std::chrono::steady_clock::now();
+
             // Use async state change with timeout to avoid blocking on RTSP
-            GstStateChangeReturn ret = gst_element_set_state(pipeline_, GST_STATE_NULL);
-            if (ret == GST_STATE_CHANGE_ASYNC)
+            set_state_null(pipeline_, config_.id);
+            std::vector<GstElement *> elements;
             {
-                // Wait up to 3 seconds for state change
-                GstState state;
-                ret = gst_element_get_state(pipeline_, &state, nullptr, 3 * GST_SECOND);
-                if (ret == GST_STATE_CHANGE_FAILURE || ret == GST_STATE_CHANGE_ASYNC)
+                std::lock_guard<std::mutex> lock(element_mutex_);
+                for (auto &layer : layers_)
                 {
-                    spdlog::warn("[{}] Pipeline state change to NULL timed out, forcing", config_.id);
+                    for (GstElement **element : {&layer->appsink, &layer->encoder})
+                    {
+                        if (*element)
+                            elements.push_back(*element);
+                        *element = nullptr;
+                    }
                 }
+                if (appsrc_)
+                    elements.push_back(appsrc_);
+                appsrc_ = nullptr;
             }
-            if (appsink_)
+            for (GstElement *element : elements)
             {
-                gst_object_unref(appsink_);
-                appsink_ = nullptr;
+                gst_object_unref(element);
             }
             gst_object_unref(pipeline_);
             pipeline_ = nullptr;
+            source_ = nullptr;
+            last_stop_ms_.store(elapsed_ms(t0));
+        }
+        awaiting_first_frame_.store(false);
+
+        // A restarted stream may come back with different parameter sets
+        clear_gop_caches();
+    }
+
+    void CameraPipeline::detach_source()
+    {
+        if (source_)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+
+            GstElement *appsrc = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(element_mutex_);
+                std::swap(appsrc, appsrc_);
+            }
+            if (appsrc)
+                gst_object_unref(appsrc);
+
+            // Locked so the pipeline's own state changes leave it alone
+            gst_element_set_locked_state(source_, TRUE);
+            set_state_null(source_, config_.id);
+
+            // Unlinks the ghost pad and drops the last reference
+            gst_bin_remove(GST_BIN(pipeline_), source_);
+            source_ = nullptr;
+            last_stop_ms_.store(elapsed_ms(t0));
+        }
+        awaiting_first_frame_.store(false);
+        clear_gop_caches();
+    }
+
+    bool CameraPipeline::restart_source()
+    {
+        // The device is closed now, so a capture chain for a new mode can be probed
+        if (config_.type == CameraType::USB && (!capture_planned_ || planned_mode_ != video_mode()))
+            plan_capture();
+
+        std::string desc = source_description();
+        spdlog::info("[{}] Replacing source: {}", config_.id, desc);
+
+        GstElement *source = make_bin(desc, "source");
+        if (!source)
+            return false;
+
+        GstElement *branches = gst_bin_get_by_name(GST_BIN(pipeline_), "branches");
+        if (!branches)
+        {
+            gst_object_unref(source);
+            return false;
+        }
+
+        // An EOS from the old source is latched in every downstream pad;
+        // a non-resetting flush clears it without touching the running time
+        GstPad *sink_pad = gst_element_get_static_pad(branches, "sink");
+        if (sink_pad && GST_PAD_IS_EOS(sink_pad))
+        {
+            gst_pad_send_event(sink_pad, gst_event_new_flush_start());
+            gst_pad_send_event(sink_pad, gst_event_new_flush_stop(FALSE));
+        }
+        if (sink_pad)
+            gst_object_unref(sink_pad);
+
+        auto t0 = std::chrono::steady_clock::now();
+        gst_bin_add(GST_BIN(pipeline_), source);
+        bool ok = gst_element_link(source, branches) && gst_element_sync_state_with_parent(source);
+        gst_object_unref(branches);
+        if (!ok)
+        {
+            spdlog::error("[{}] Failed to start the replacement source", config_.id);
+            gst_element_set_state(source, GST_STATE_NULL);
+            gst_bin_remove(GST_BIN(pipeline_), source);
+            return false;
+        }
+        source_ = source;
+        {
+            std::lock_guard<std::mutex> lock(element_mutex_);
+            appsrc_ = gst_bin_get_by_name(GST_BIN(source_), "relaysrc"); // null unless RELAY
+        }
+
+        last_start_ms_.store(elapsed_ms(t0));
+        if (!idle_.load())
+        {
+            warmup_start_.store(t0);
+            awaiting_first_frame_.store(true);
+        }
+        return true;
+    }
+
+    bool CameraPipeline::reconfigure(const VideoMode &mode)
+    {
+        if (passthrough())
+            return false; // the camera (or origin) encodes, its mode is not ours to change
+        if (mode.width <= 0 || mode.height <= 0 || mode.fps <= 0)
+            return false;
+
+        reactor_.post([this, mode]()
+                      {
+            if (!shutdown_.load())
+                apply_video_mode(mode); });
+        return true;
+    }
+
+    void CameraPipeline::apply_video_mode(const VideoMode &mode)
+    {
+        VideoMode old;
+        {
+            std::lock_guard<std::mutex> lock(mode_mutex_);
+            old = mode_;
+            if (old == mode)
+                return;
+            mode_ = mode;
         }
+        spdlog::info("[{}] Video mode {}x{}@{} → {}x{}@{}", config_.id,
+                     old.width, old.height, old.fps, mode.width, mode.height, mode.fps);
+
+        if (!source_ || restart_timer_id_ != 0)
+            return; // the pending (re)start builds the source for the new mode
+
+        GstElement *filter = gst_bin_get_by_name(GST_BIN(source_), "mode");
+        if (!filter)
+            return;
+
+        // New caps on the filter send a reconfigure upstream: the source
+        // renegotiates in place and the encoders pick up the new size
+        const std::string media = config_.type == CameraType::USB
+                                      ? (capture_planned_ ? capture_.media : raw_capture().media)
+                                      : "video/x-raw,format=NV12";
+        if (GstCaps *caps = gst_caps_from_string(mode_caps(media, mode).c_str()))
+        {
+            g_object_set(G_OBJECT(filter), "caps", caps, nullptr);
+            gst_caps_unref(caps);
+        }
+        gst_object_unref(filter);
     }
 
     bool CameraPipeline::start()
@@ -219,204 +1214,496 @@ namespace ist
         shutdown_.store(false);
         backoff_seconds_ = 1;
 
+        // On-demand with nobody subscribed yet: build the graph, stay parked
+        idle_.store(config_.on_demand && !has_callbacks());
+
+        // Set before launching: the bus watch may report an error right away
+        running_.store(true);
         if (!launch_pipeline())
         {
+            running_.store(false);
             return false;
         }
 
-        running_.store(true);
-
-        // Start bus monitoring thread
-        bus_thread_ = std::thread(&CameraPipeline::bus_monitor_thread, this);
+        watchdog_timer_id_ = reactor_.add_timer(kWatchdogIntervalMs, [this]()
+                                                {
+            watchdog_tick();
+            return true; });
 
-        spdlog::info("[{}] Pipeline started successfully", config_.id);
+        spdlog::info("[{}] Pipeline started successfully in {} ms{}", config_.id, last_launch_ms_.load(),
+                     idle_.load() ? " (on-demand, parked until first viewer)" : "");
         return true;
     }
 
     void CameraPipeline::stop()
     {
-        if (!running_.load() && !bus_thread_.joinable())
+        if (shutdown_.exchange(true))
             return;
 
         spdlog::info("[{}] Stopping pipeline...", config_.id);
-        shutdown_.store(true);
         running_.store(false);
 
+        // On the reactor, so no watch or timer of ours can fire afterwards
+        reactor_.run_sync([this]()
+                          {
+            reactor_.remove(restart_timer_id_);
+            reactor_.remove(idle_timer_id_);
+            reactor_.remove(watchdog_timer_id_);
+            reactor_.remove(bus_watch_id_);
+            restart_timer_id_ = 0;
+            idle_timer_id_ = 0;
+            watchdog_timer_id_ = 0;
+            bus_watch_id_ = 0; });
+
+        // Nothing on the reactor touches the pipeline any more, so the slow
+        // NULL transition runs on the caller's thread: cameras stopped in
+        // parallel do not queue behind each other on the reactor
+        auto t0 = std::chrono::steady_clock::now();
         destroy_pipeline();
 
-        // Wait for bus monitor thread to exit
-        if (bus_thread_.joinable())
-        {
-            bus_thread_.join();
-        }
+        spdlog::info("[{}] Pipeline stopped in {} ms (total frames: {}, restarts: {})",
+                     config_.id, elapsed_ms(t0), frame_count_.load(), restart_count_.load());
+    }
+
+    GstBusSyncReply CameraPipeline::on_sync_message(GstBus *, GstMessage *msg, gpointer user_data)
+    {
+        if (GST_MESSAGE_TYPE(msg) != GST_MESSAGE_STREAM_STATUS)
+            return GST_BUS_PASS;
 
-        spdlog::info("[{}] Pipeline stopped (total frames: {}, restarts: {})",
-                     config_.id, frame_count_.load(), restart_count_.load());
+        GstStreamStatusType type;
+        GstElement *owner = nullptr;
+        gst_message_parse_stream_status(msg, &type, &owner);
+        if (type != GST_STREAM_STATUS_TYPE_ENTER || !owner)
+            return GST_BUS_PASS;
+
+        // Auto-numbered names grow on every rebuild; label by element type
+        auto *self = static_cast<CameraPipeline *>(user_data);
+        std::string name = GST_ELEMENT_NAME(owner);
+        while (name.size() > 1 && std::isdigit(static_cast<unsigned char>(name.back())))
+            name.pop_back();
+        apply_thread_policy(self->config_.threads, self->config_.id + "/" + name);
+        return GST_BUS_PASS;
     }
 
-    void CameraPipeline::bus_monitor_thread()
+    void CameraPipeline::handle_bus_message(GstMessage *msg)
     {
-        spdlog::debug("[{}] Bus monitor thread started", config_.id);
+        if (shutdown_.load())
+            return;
 
-        while (!shutdown_.load())
+        switch (GST_MESSAGE_TYPE(msg))
         {
-            if (!pipeline_)
-            {
-                // Pipeline was destroyed, wait for restart or shutdown
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
-            }
+        case GST_MESSAGE_ERROR:
+        {
+            GError *err = nullptr;
+            gchar *debug = nullptr;
+            gst_message_parse_error(msg, &err, &debug);
+            spdlog::error("[{}] Pipeline ERROR: {} (debug: {})",
+                          config_.id,
+                          err ? err->message : "unknown",
+                          debug ? debug : "none");
+            if (err)
+                g_error_free(err);
+            if (debug)
+                g_free(debug);
 
-            GstBus *bus = gst_element_get_bus(pipeline_);
-            if (!bus)
+            // Errors inside the source bin (device gone, RTSP disconnect)
+            // leave the encoders intact; anything else rebuilds everything
+            RestartScope scope = from_source(msg) ? RestartScope::SOURCE : RestartScope::FULL;
+
+            // A negotiated capture chain that failed before its first
+            // frame is not retried; fall back to raw + videoconvert
+            if (config_.type == CameraType::USB && capture_planned_ && !capture_fallback_ &&
+                awaiting_first_frame_.load())
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
+                // Scalers were built for GPU memory, so the branches go too
+                if (capture_.memory != FrameMemory::SYSTEM)
+                    scope = RestartScope::FULL;
+                capture_ = raw_capture();
+                capture_fallback_ = true;
+                spdlog::warn("[{}] Capture chain failed before the first frame, falling back to raw capture",
+                             config_.id);
             }
 
-            // Poll bus with 500ms timeout so we can check shutdown_ regularly
-            GstMessage *msg = gst_bus_timed_pop(bus, 500 * GST_MSECOND);
-            gst_object_unref(bus);
+            schedule_restart(scope);
+            break;
+        }
 
-            if (!msg)
-                continue;
+        case GST_MESSAGE_WARNING:
+        {
+            GError *err = nullptr;
+            gchar *debug = nullptr;
+            gst_message_parse_warning(msg, &err, &debug);
+            spdlog::warn("[{}] Pipeline WARNING: {} (debug: {})",
+                         config_.id,
+                         err ? err->message : "unknown",
+                         debug ? debug : "none");
+            if (err)
+                g_error_free(err);
+            if (debug)
+                g_free(debug);
+            break;
+        }
 
-            switch (GST_MESSAGE_TYPE(msg))
-            {
-            case GST_MESSAGE_ERROR:
+        case GST_MESSAGE_EOS:
+            // Only sources end a live stream (RTSP server closed the session)
+            spdlog::warn("[{}] Pipeline received EOS", config_.id);
+            schedule_restart(RestartScope::SOURCE);
+            break;
+
+        case GST_MESSAGE_LATENCY:
+            // A replaced live source may report a different latency
+            if (pipeline_)
+                gst_bin_recalculate_latency(GST_BIN(pipeline_));
+            break;
+
+        case GST_MESSAGE_STATE_CHANGED:
+            // Only log state changes for the pipeline itself
+            if (pipeline_ && GST_MESSAGE_SRC(msg) == GST_OBJECT(pipeline_))
             {
-                GError *err = nullptr;
-                gchar *debug = nullptr;
-                gst_message_parse_error(msg, &err, &debug);
-                spdlog::error("[{}] Pipeline ERROR: {} (debug: {})",
+                GstState old_state, new_state;
+                gst_message_parse_state_changed(msg, &old_state, &new_state, nullptr);
+                spdlog::debug("[{}] Pipeline state: {} → {}",
                               config_.id,
-                              err ? err->message : "unknown",
-                              debug ? debug : "none");
-                if (err)
-                    g_error_free(err);
-                if (debug)
-                    g_free(debug);
-
-                // Schedule restart
-                gst_message_unref(msg);
-                schedule_restart();
-                continue; // skip the unref at bottom
+                              gst_element_state_get_name(old_state),
+                              gst_element_state_get_name(new_state));
             }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    bool CameraPipeline::from_source(GstMessage *msg) const
+    {
+        return source_ && GST_MESSAGE_SRC(msg) &&
+               gst_object_has_as_ancestor(GST_MESSAGE_SRC(msg), GST_OBJECT(source_));
+    }
+
+    void CameraPipeline::schedule_restart(RestartScope scope)
+    {
+        if (shutdown_.load() || restart_timer_id_ != 0)
+            return; // stopping, or a restart is already pending
+
+        // A fresh source that failed again before its first frame points at
+        // the rest of the graph
+        if (scope == RestartScope::SOURCE &&
+            (!source_ || (source_restarted_ && awaiting_first_frame_.load())))
+        {
+            scope = RestartScope::FULL;
+        }
+
+        running_.store(false);
+        if (scope == RestartScope::SOURCE)
+            detach_source();
+        else
+            destroy_pipeline();
+        restart_scope_ = scope;
+
+        // Time-to-recover runs from the first failure until frames flow again
+        if (!recovering_.exchange(true))
+            failure_time_.store(std::chrono::steady_clock::now());
+
+        // A parked camera loses its idle countdown with the pipeline
+        reactor_.remove(idle_timer_id_);
+        idle_timer_id_ = 0;
+
+        restart_attempt_ = restart_count_.fetch_add(1) + 1;
+        spdlog::warn("[{}] Scheduling {} restart (attempt {}, backoff {}s)",
+                     config_.id, scope == RestartScope::SOURCE ? "source" : "full",
+                     restart_attempt_, backoff_seconds_);
 
-            case GST_MESSAGE_WARNING:
+        restart_timer_id_ = reactor_.add_timer(static_cast<unsigned>(backoff_seconds_) * 1000,
+                                               [this]()
+                                               {
+                                                   restart_timer_id_ = 0;
+                                                   attempt_restart();
+                                                   return false;
+                                               });
+    }
+
+    void CameraPipeline::attempt_restart()
+    {
+        if (shutdown_.load())
+            return;
+
+        if (restart_scope_ == RestartScope::SOURCE && pipeline_)
+        {
+            // Encoders and appsinks kept their state; only the source is new
+            if (restart_source())
             {
-                GError *err = nullptr;
-                gchar *debug = nullptr;
-                gst_message_parse_warning(msg, &err, &debug);
-                spdlog::warn("[{}] Pipeline WARNING: {} (debug: {})",
-                             config_.id,
-                             err ? err->message : "unknown",
-                             debug ? debug : "none");
-                if (err)
-                    g_error_free(err);
-                if (debug)
-                    g_free(debug);
-                break;
+                source_restarted_ = true;
+                source_restart_count_.fetch_add(1);
+                running_.store(true);
+                spdlog::info("[{}] Source restarted successfully (attempt {}, {} ms)",
+                             config_.id, restart_attempt_, last_start_ms_.load());
+                if (config_.on_demand)
+                    update_demand();
+                return;
             }
+            spdlog::warn("[{}] Source restart failed, rebuilding the pipeline", config_.id);
+            destroy_pipeline();
+        }
 
-            case GST_MESSAGE_EOS:
-                spdlog::warn("[{}] Pipeline received EOS", config_.id);
-                gst_message_unref(msg);
-                schedule_restart();
-                continue;
+        // Viewers may have come or gone while the pipeline was down
+        idle_.store(config_.on_demand && !has_callbacks());
 
-            case GST_MESSAGE_STATE_CHANGED:
-                // Only log state changes for the pipeline itself
-                if (GST_MESSAGE_SRC(msg) == GST_OBJECT(pipeline_))
-                {
-                    GstState old_state, new_state;
-                    gst_message_parse_state_changed(msg, &old_state, &new_state, nullptr);
-                    spdlog::debug("[{}] Pipeline state: {} → {}",
-                                  config_.id,
-                                  gst_element_state_get_name(old_state),
-                                  gst_element_state_get_name(new_state));
-                }
-                break;
+        if (launch_pipeline())
+        {
+            // Backoff is reset by the watchdog once frames flow again, so a
+            // pipeline that launches but keeps stalling still backs off
+            source_restarted_ = false;
+            running_.store(true);
+            spdlog::info("[{}] Pipeline restarted successfully (attempt {})", config_.id, restart_attempt_);
+            if (config_.on_demand)
+                update_demand();
+            return;
+        }
 
-            default:
-                break;
+        // Exponential backoff: 1 → 2 → 4 → 8 → 16 → 30 (cap), as a new timer
+        backoff_seconds_ = std::min(backoff_seconds_ * 2, kMaxBackoffSeconds);
+        spdlog::error("[{}] Restart failed, next attempt in {}s", config_.id, backoff_seconds_);
+        schedule_restart(RestartScope::FULL);
+    }
+
+    std::chrono::milliseconds CameraPipeline::stall_threshold() const
+    {
+        if (config_.stall_timeout_ms > 0)
+            return std::chrono::milliseconds(config_.stall_timeout_ms);
+        int interval_ms = 1000 / std::max(1, video_mode().fps);
+        return std::chrono::milliseconds(std::max(kMinStallTimeoutMs, kStallFrames * interval_ms));
+    }
+
+    void CameraPipeline::watchdog_tick()
+    {
+        // Nothing is expected while stopping, restarting or parked
+        if (shutdown_.load() || !pipeline_ || restart_timer_id_ != 0 || idle_.load())
+            return;
+
+        auto now = std::chrono::steady_clock::now();
+        if (awaiting_first_frame_.load())
+        {
+            if (now - warmup_start_.load() > std::chrono::seconds(kFirstFrameTimeoutSeconds))
+            {
+                stall_count_.fetch_add(1);
+                spdlog::warn("[{}] STALLED — no first frame {}s after start, restarting",
+                             config_.id, kFirstFrameTimeoutSeconds);
+                schedule_restart(RestartScope::SOURCE);
             }
+            return;
+        }
 
-            gst_message_unref(msg);
+        auto gap = now - last_frame_time_.load();
+        if (gap > stall_threshold())
+        {
+            stall_count_.fetch_add(1);
+            spdlog::warn("[{}] STALLED — no frames for {} ms (threshold {} ms), restarting",
+                         config_.id,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(gap).count(),
+                         stall_threshold().count());
+            schedule_restart(RestartScope::SOURCE);
+            return;
         }
 
-        spdlog::debug("[{}] Bus monitor thread exiting", config_.id);
+        // Streaming normally — the next failure starts from the shortest backoff
+        backoff_seconds_ = 1;
     }
 
-    void CameraPipeline::schedule_restart()
+    void CameraPipeline::request_demand_update()
     {
-        if (shutdown_.load())
+        if (!config_.on_demand || shutdown_.load())
             return;
+        reactor_.post([this]()
+                      {
+            if (!shutdown_.load())
+                update_demand(); });
+    }
 
-        running_.store(false);
-        destroy_pipeline();
+    void CameraPipeline::update_demand()
+    {
+        if (!pipeline_ || restart_timer_id_ != 0)
+            return; // restarting — attempt_restart() re-evaluates
 
-        int attempt = restart_count_.fetch_add(1) + 1;
-        spdlog::warn("[{}] Scheduling restart (attempt {}, backoff {}s)",
-                     config_.id, attempt, backoff_seconds_);
+        bool wanted = has_callbacks();
 
-        // Wait with backoff (check shutdown_ periodically)
-        for (int i = 0; i < backoff_seconds_ * 10 && !shutdown_.load(); i++)
+        if (idle_.load())
         {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            if (wanted)
+                resume_pipeline();
+            return;
         }
 
-        if (shutdown_.load())
+        if (wanted)
+        {
+            // Viewer came back before the idle timeout
+            reactor_.remove(idle_timer_id_);
+            idle_timer_id_ = 0;
             return;
+        }
 
-        // Try to restart
-        if (launch_pipeline())
+        if (idle_timer_id_ == 0)
         {
-            running_.store(true);
-            backoff_seconds_ = 1; // Reset backoff on success
-            spdlog::info("[{}] Pipeline restarted successfully (attempt {})", config_.id, attempt);
+            idle_timer_id_ = reactor_.add_timer(static_cast<unsigned>(config_.idle_timeout) * 1000,
+                                                [this]()
+                                                {
+                                                    idle_timer_id_ = 0;
+                                                    if (pipeline_ && !idle_.load() && !has_callbacks())
+                                                        park_pipeline();
+                                                    return false;
+                                                });
         }
-        else
-        {
-            // Exponential backoff: 1 → 2 → 4 → 8 → 16 → 30 (cap)
-            backoff_seconds_ = std::min(backoff_seconds_ * 2, kMaxBackoffSeconds);
-            spdlog::error("[{}] Restart failed, next attempt in {}s", config_.id, backoff_seconds_);
+    }
+
+    void CameraPipeline::resume_pipeline()
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        idle_.store(false);
 
-            // Try again (recursive via loop in bus_monitor_thread)
-            schedule_restart();
+        if (gst_element_set_state(pipeline_, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            spdlog::error("[{}] Failed to resume pipeline", config_.id);
+            schedule_restart(RestartScope::FULL);
+            return;
         }
+
+        last_start_ms_.store(elapsed_ms(t0));
+        warmup_start_.store(t0);
+        awaiting_first_frame_.store(true);
+        spdlog::info("[{}] Viewer joined — resuming pipeline ({} ms)", config_.id, last_start_ms_.load());
+    }
+
+    void CameraPipeline::park_pipeline()
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        idle_.store(true);
+        awaiting_first_frame_.store(false);
+
+        // READY stops streaming and the encoder but keeps the element graph
+        // (and the capture device for v4l2src) for a fast resume
+        gst_element_set_state(pipeline_, GST_STATE_READY);
+        GstState state;
+        gst_element_get_state(pipeline_, &state, nullptr, 3 * GST_SECOND);
+
+        // Cached frames would be stale by the time anyone resumes
+        clear_gop_caches();
+
+        last_stop_ms_.store(elapsed_ms(t0));
+        spdlog::info("[{}] No viewers for {}s — pipeline parked in READY ({} ms)",
+                     config_.id, config_.idle_timeout, last_stop_ms_.load());
     }
 
-    CallbackId CameraPipeline::on_frame(FrameCallback callback)
+    CallbackId CameraPipeline::on_frame(FrameCallback callback, size_t layer)
     {
-        std::lock_guard<std::mutex> lock(cb_mutex_);
-        CallbackId id = next_cb_id_.fetch_add(1);
-        callbacks_.push_back({id, std::move(callback)});
-        spdlog::debug("[{}] Registered frame callback id={} (total: {})",
-                      config_.id, id, callbacks_.size());
+        auto &registry = layers_[std::min(layer, layers_.size() - 1)]->callbacks;
+        CallbackId id = registry.add(std::move(callback));
+        spdlog::debug("[{}] Registered frame callback id={} on layer {} (total: {})",
+                      config_.id, id, layer, registry.size());
+        request_demand_update();
         return id;
     }
 
-    void CameraPipeline::remove_callback(CallbackId id)
+    void CameraPipeline::remove_callback(CallbackId id, size_t layer)
     {
-        std::lock_guard<std::mutex> lock(cb_mutex_);
-        auto it = std::remove_if(callbacks_.begin(), callbacks_.end(),
-                                 [id](const CallbackEntry &e)
-                                 { return e.id == id; });
-        if (it != callbacks_.end())
+        auto &registry = layers_[std::min(layer, layers_.size() - 1)]->callbacks;
+        if (registry.remove(id, /*sync=*/true))
         {
-            callbacks_.erase(it, callbacks_.end());
-            spdlog::debug("[{}] Removed frame callback id={} (remaining: {})",
-                          config_.id, id, callbacks_.size());
+            spdlog::debug("[{}] Removed frame callback id={} from layer {} (remaining: {})",
+                          config_.id, id, layer, registry.size());
+            request_demand_update();
         }
     }
 
     void CameraPipeline::clear_callbacks()
     {
-        std::lock_guard<std::mutex> lock(cb_mutex_);
-        size_t count = callbacks_.size();
-        callbacks_.clear();
+        size_t count = 0;
+        for (auto &layer : layers_)
+            count += layer->callbacks.clear(/*sync=*/true);
         spdlog::debug("[{}] Cleared {} frame callbacks", config_.id, count);
+        request_demand_update();
+    }
+
+    bool CameraPipeline::has_callbacks() const
+    {
+        return std::any_of(layers_.begin(), layers_.end(),
+                           [](const auto &layer)
+                           { return layer->callbacks.size() > 0; });
+    }
+
+    void CameraPipeline::clear_gop_caches()
+    {
+        for (auto &layer : layers_)
+        {
+            std::lock_guard<std::mutex> lock(layer->gop_mutex);
+            layer->gop_cache.clear();
+        }
+    }
+
+    void CameraPipeline::update_gop_cache(Layer &layer, const H264Frame &frame)
+    {
+        if (config_.gop_cache == GopCacheMode::OFF)
+            return;
+
+        if (frame.is_keyframe)
+        {
+            // Remember the parameter sets so a cached IDR is always decodable,
+            // even if an upstream element did not repeat them in-band
+            // (AV1 repeats its sequence header in every keyframe temporal unit)
+            std::vector<std::byte> params;
+            const VideoCodec codec = layer.info.codec;
+            if (codec != VideoCodec::AV1)
+            {
+                for_each_nal(frame.data(), frame.size(),
+                             [&params, codec](const std::byte *nal, size_t len, uint8_t header)
+                             {
+                                 if (is_parameter_set(codec, nal_type(codec, header)))
+                                     params.insert(params.end(), nal, nal + len);
+                             });
+            }
+
+            H264Frame idr = frame;
+            std::lock_guard<std::mutex> lock(layer.gop_mutex);
+            if (!params.empty())
+            {
+                layer.parameter_sets = std::move(params);
+            }
+            else if (!layer.parameter_sets.empty())
+            {
+                // Prepend the last known parameter sets (copy path, keyframes only)
+                idr.buffer = FrameBuffer::copy(layer.parameter_sets.data(), layer.parameter_sets.size(),
+                                               frame.data(), frame.size(), buffer_pool_);
+            }
+
+            layer.gop_cache.clear();
+            layer.gop_cache.push_back(std::move(idr));
+            return;
+        }
+
+        if (config_.gop_cache != GopCacheMode::GOP)
+            return;
+
+        std::lock_guard<std::mutex> lock(layer.gop_mutex);
+        if (!layer.gop_cache.empty() && layer.gop_cache.size() < kMaxGopCacheFrames)
+        {
+            layer.gop_cache.push_back(frame);
+        }
+    }
+
+    std::vector<H264Frame> CameraPipeline::cached_frames(size_t layer_idx) const
+    {
+        if (layer_idx >= layers_.size())
+            return {};
+        const auto &layer = *layers_[layer_idx];
+        std::lock_guard<std::mutex> lock(layer.gop_mutex);
+        return layer.gop_cache;
+    }
+
+    CameraPipeline::LayerCounters CameraPipeline::layer_counters(size_t layer_idx) const
+    {
+        const auto &layer = *layers_[layer_idx];
+        return {layer.frames.load(std::memory_order_relaxed),
+                layer.bytes.load(std::memory_order_relaxed),
+                layer.keyframes.load(std::memory_order_relaxed),
+                static_cast<double>(layer.keyframe_interval_us.load(std::memory_order_relaxed)) / 1e6};
     }
 
     double CameraPipeline::seconds_since_last_frame() const
@@ -428,7 +1715,8 @@ namespace ist
 
     GstFlowReturn CameraPipeline::on_new_sample(GstAppSink *sink, gpointer user_data)
     {
-        auto *self = static_cast<CameraPipeline *>(user_data);
+        auto *layer = static_cast<Layer *>(user_data);
+        auto *self = layer->owner;
 
         GstSample *sample = gst_app_sink_pull_sample(sink);
         if (!sample)
@@ -441,39 +1729,92 @@ namespace ist
             return GST_FLOW_OK;
         }
 
-        // Map buffer to read data
-        GstMapInfo map;
-        if (!gst_buffer_map(buffer, &map, GST_MAP_READ))
+        // Wrap buffer without copying — subscribers share the mapped payload
+        H264Frame frame;
+        frame.buffer = FrameBuffer::wrap(buffer);
+        frame.timestamp = GST_BUFFER_PTS(buffer);
+        frame.is_keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        frame.appsink_time = std::chrono::steady_clock::now();
+        frame.capture_time = frame.appsink_time;
+
+        // Live sources stamp buffers with the running time at capture; the
+        // gap to the current running time is what capture + encode took
+        if (GST_CLOCK_TIME_IS_VALID(frame.timestamp))
         {
-            gst_sample_unref(sample);
+            GstClock *clock = gst_element_get_clock(GST_ELEMENT(sink));
+            GstSegment *segment = gst_sample_get_segment(sample);
+            if (clock && segment)
+            {
+                GstClockTime now = gst_clock_get_time(clock);
+                GstClockTime base = gst_element_get_base_time(GST_ELEMENT(sink));
+                guint64 running = gst_segment_to_running_time(segment, GST_FORMAT_TIME, frame.timestamp);
+                if (GST_CLOCK_TIME_IS_VALID(running) && now >= base && now - base >= running)
+                {
+                    auto age = std::chrono::nanoseconds(now - base - running);
+                    frame.capture_time -= std::chrono::duration_cast<std::chrono::steady_clock::duration>(age);
+                    self->capture_latency_.record(
+                        std::chrono::duration_cast<std::chrono::microseconds>(age).count());
+                }
+            }
+            if (clock)
+                gst_object_unref(clock);
+        }
+
+        // FrameBuffer holds its own buffer reference, the sample can go now
+        gst_sample_unref(sample);
+
+        if (!frame.buffer)
             return GST_FLOW_OK;
+
+        // Per-layer traffic counters
+        auto now = std::chrono::steady_clock::now();
+        layer->frames.fetch_add(1, std::memory_order_relaxed);
+        layer->bytes.fetch_add(frame.size(), std::memory_order_relaxed);
+        if (frame.is_keyframe)
+        {
+            int64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                 now.time_since_epoch())
+                                 .count();
+            int64_t last_us = layer->last_keyframe_us.exchange(now_us, std::memory_order_relaxed);
+            if (last_us != 0)
+                layer->keyframe_interval_us.store(now_us - last_us, std::memory_order_relaxed);
+            layer->keyframes.fetch_add(1, std::memory_order_relaxed);
         }
 
-        // Check for keyframe
-        bool is_keyframe = !GST_BUFFER_FLAG_IS_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+        // Update health metrics (tracked on the full-quality layer)
+        if (layer->index == 0)
+        {
+            self->frame_count_.fetch_add(1);
+            self->last_frame_time_.store(now);
+        }
 
-        // Create H264Frame
-        H264Frame frame;
-        frame.data.resize(map.size);
-        std::memcpy(frame.data.data(), map.data, map.size);
-        frame.timestamp = GST_BUFFER_PTS(buffer);
-        frame.is_keyframe = is_keyframe;
+        if (layer->index == 0 && self->awaiting_first_frame_.exchange(false))
+        {
+            self->last_warmup_ms_.store(elapsed_ms(self->warmup_start_.load()));
+            spdlog::info("[{}] First frame {} ms after start", self->config_.id,
+                         self->last_warmup_ms_.load());
 
-        gst_buffer_unmap(buffer, &map);
-        gst_sample_unref(sample);
+            if (self->recovering_.exchange(false))
+            {
+                auto failed_at = self->failure_time_.load();
+                self->recovery_time_.record_since(failed_at);
+                self->last_recovery_ms_.store(elapsed_ms(failed_at));
+                spdlog::info("[{}] Recovered {} ms after failure", self->config_.id,
+                             self->last_recovery_ms_.load());
+            }
+        }
 
-        // Update health metrics
-        self->frame_count_.fetch_add(1);
-        self->last_frame_time_.store(std::chrono::steady_clock::now());
+        // Cache before dispatch so joining subscribers see this frame too
+        self->update_gop_cache(*layer, frame);
 
-        // Distribute to all registered callbacks
+        // Distribute to all registered callbacks (lock-free snapshot)
         {
-            std::lock_guard<std::mutex> lock(self->cb_mutex_);
-            for (const auto &entry : self->callbacks_)
+            auto callbacks = layer->callbacks.snapshot();
+            for (const auto &entry : *callbacks)
             {
                 try
                 {
-                    entry.fn(frame);
+                    entry.value(frame);
                 }
                 catch (const std::exception &e)
                 {
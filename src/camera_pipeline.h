@@ -7,17 +7,38 @@
  * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
  *            All rights reserved. Internal use only.
  *
- * Manages a GStreamer pipeline for capturing H.264 video from RTSP, USB,
- * or test sources. Features automatic pipeline recovery with exponential
- * backoff, GStreamer bus monitoring, and frame health metrics for
- * industrial 24/7 operation.
+ * Manages a GStreamer pipeline for capturing H.264, H.265 or AV1 video
+ * from RTSP, USB, or test sources. Features automatic pipeline recovery with exponential
+ * backoff, GStreamer bus monitoring, a keyframe/GOP cache for instant
+ * first frame on join, and frame health metrics for industrial 24/7
+ * operation. On-demand cameras park their pipeline in READY while nobody
+ * is watching and resume it when the first callback is registered.
+ * Encoded sources may add simulcast layers: one capture and colour
+ * conversion tee'd into scaled encoder branches, each with its own
+ * appsink, callbacks, cache and bitrate. USB capture negotiates the
+ * cheapest path into the encoder (encoder-native raw, DMABUF into VA-API,
+ * or MJPEG with hardware decode) and converts colour only when required.
+ * Encoded H.265/AV1 cameras append a full-size H.264 layer by default, so
+ * viewers whose browser lacks the codec can still be served.
+ * The pipeline is two bins, source (capture or RTSP receive) and branches
+ * (encoders and appsinks), so a failed source is replaced on its own and
+ * resolution or frame rate changes renegotiate the running graph.
+ * Relay cameras have an appsrc as source, fed with the access units of an
+ * origin server's track (see relay_client.h), and are passed through like
+ * RTSP; their keyframe requests are forwarded to the origin.
  */
 
 #pragma once
 
 #include "config.h"
+#include "frame_buffer.h"
+#include "cow_registry.h"
+#include "latency_histogram.h"
+#include "bus_reactor.h"
+#include "buffer_pool.h"
 #include <gst/gst.h>
 #include <gst/app/gstappsink.h>
+#include <gst/app/gstappsrc.h>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -31,31 +52,77 @@ namespace ist
 {
 
     /**
-     * @brief H.264 encoded frame data passed from GStreamer to WebRTC layer
+     * @brief Encoded frame data passed from GStreamer to WebRTC layer
+     *
+     * An H.264/H.265 access unit (Annex B) or an AV1 temporal unit (OBUs),
+     * depending on the codec of the layer it belongs to.
+     *
+     * Cheap to copy: the payload is a shared, immutable view over the
+     * original GstBuffer, released when the last copy is destroyed.
      */
     struct H264Frame
     {
-        std::vector<std::byte> data; ///< NAL unit data (byte-stream format)
-        uint64_t timestamp;          ///< Presentation timestamp in nanoseconds
-        bool is_keyframe;            ///< True if this is an IDR frame
+        std::shared_ptr<const FrameBuffer> buffer; ///< NAL unit data (byte-stream format)
+        uint64_t timestamp = 0;                    ///< Presentation timestamp in nanoseconds
+        bool is_keyframe = false;                  ///< True if this is an IDR frame
+        std::chrono::steady_clock::time_point capture_time; ///< Estimated capture instant (from running time)
+        std::chrono::steady_clock::time_point appsink_time; ///< When the appsink delivered the frame
+
+        const std::byte *data() const { return buffer ? buffer->data() : nullptr; }
+        size_t size() const { return buffer ? buffer->size() : 0; }
     };
 
-    /// Callback signature for receiving encoded H.264 frames
+    /// Callback signature for receiving encoded frames
     using FrameCallback = std::function<void(const H264Frame &)>;
 
     /// Unique identifier for a registered frame callback
     using CallbackId = uint64_t;
 
+    /**
+     * @brief Static description of one encoded output of a camera
+     */
+    struct LayerInfo
+    {
+        std::string name; ///< "full" for layer 0, else the configured name
+        int width;
+        int height;
+        int bitrate;      ///< Nominal (maximum) bitrate in kbps
+        VideoCodec codec = VideoCodec::H264;
+    };
+
+    /**
+     * @brief Capture resolution and frame rate
+     */
+    struct VideoMode
+    {
+        int width;
+        int height;
+        int fps;
+
+        bool operator==(const VideoMode &other) const
+        {
+            return width == other.width && height == other.height && fps == other.fps;
+        }
+        bool operator!=(const VideoMode &other) const { return !(*this == other); }
+    };
+
     /**
      * @brief GStreamer camera capture pipeline with automatic recovery
      *
      * Encapsulates the lifecycle of a GStreamer pipeline for a single camera
-     * source. Monitors the GStreamer bus for errors and automatically restarts
-     * the pipeline with exponential backoff on failure.
+     * source. Watches the GStreamer bus on the shared BusReactor and restarts
+     * the pipeline with exponential backoff (as reactor timers) on failure.
+     * Source errors, EOS and stalls replace only the source bin, keeping the
+     * encoders and their negotiated caps; a replaced source that fails again
+     * before its first frame escalates to a full rebuild.
      *
      * Thread Safety:
      *   - on_frame(), remove_callback(), clear_callbacks() are thread-safe
-     *   - start() and stop() must be called from the same thread
+     *   - Frame dispatch reads a copy-on-write callback snapshot without
+     *     locking, so registration never contends with the streaming thread
+     *   - start() and stop() of one camera must not overlap; different
+     *     cameras may be started or stopped concurrently. After start() the
+     *     pipeline is only rebuilt, parked or resumed on the reactor thread
      *
      * @note For RTSP sources, the pipeline uses TCP transport with a 5-second
      *       timeout for faster disconnect detection.
@@ -63,7 +130,11 @@ namespace ist
     class CameraPipeline
     {
     public:
-        explicit CameraPipeline(const CameraConfig &config);
+        /**
+         * @param config   Camera settings
+         * @param reactor  Shared loop for bus watches and timers (must outlive the pipeline)
+         */
+        CameraPipeline(const CameraConfig &config, BusReactor &reactor);
         ~CameraPipeline();
 
         // Non-copyable, non-movable
@@ -71,7 +142,7 @@ namespace ist
         CameraPipeline &operator=(const CameraPipeline &) = delete;
 
         /**
-         * @brief  Start the GStreamer pipeline and bus monitor thread
+         * @brief  Start the GStreamer pipeline and attach its bus watch
          * @return true on success, false if pipeline creation failed
          */
         bool start();
@@ -79,37 +150,61 @@ namespace ist
         /**
          * @brief Stop the pipeline and release all GStreamer resources
          *
-         * Sets the shutdown flag to prevent auto-recovery, then waits for
-         * the bus monitor thread to exit. Uses a 3-second timeout for the
-         * GStreamer state transition to avoid hangs on RTSP disconnects.
+         * Sets the shutdown flag to prevent auto-recovery and removes the bus
+         * watch and pending restart/idle timers on the reactor thread, then
+         * tears the pipeline down on the calling thread. Uses a 3-second
+         * timeout for the GStreamer state transition to avoid hangs on RTSP
+         * disconnects.
          */
         void stop();
 
         /**
-         * @brief  Register a callback to receive H.264 frames
+         * @brief  Register a callback to receive encoded frames
          * @param  callback  Function to invoke on each new frame
+         * @param  layer     Simulcast layer index (0 = full quality)
          * @return Unique ID for this callback (used with remove_callback)
          */
-        CallbackId on_frame(FrameCallback callback);
+        CallbackId on_frame(FrameCallback callback, size_t layer = 0);
 
         /**
          * @brief  Unregister a previously registered callback
-         * @param  id  Callback ID returned by on_frame()
+         *
+         * Returns once the streaming thread can no longer be invoking the
+         * callback, so captured state may be destroyed afterwards. Must not
+         * be called from inside a frame callback.
+         *
+         * @param  id     Callback ID returned by on_frame()
+         * @param  layer  Layer the callback was registered on
          */
-        void remove_callback(CallbackId id);
+        void remove_callback(CallbackId id, size_t layer = 0);
 
         /**
-         * @brief Remove all registered frame callbacks
+         * @brief Remove all registered frame callbacks on every layer
          */
         void clear_callbacks();
 
+        /** @brief Number of encoded layers (1 without simulcast) */
+        size_t layer_count() const { return layers_.size(); }
+
+        /** @brief Resolution, nominal bitrate and codec of one layer */
+        const LayerInfo &layer_info(size_t layer) const { return layers_[layer]->info; }
+
+        /** @brief Codec of layer 0 and the simulcast layers (H.264 if the configured one has no encoder) */
+        VideoCodec codec() const { return layers_[0]->info.codec; }
+
+        /** @brief Lowest-quality layer in @p codec (layer_count() if none) */
+        size_t last_layer(VideoCodec codec) const;
+
+        /** @brief Highest-quality layer in @p codec (layer_count() if none) */
+        size_t first_layer(VideoCodec codec) const;
+
         // ── Status & Health ─────────────────────────────────────────────
 
         bool is_running() const { return running_.load(); }
         const CameraConfig &config() const { return config_; }
         const std::string &id() const { return config_.id; }
 
-        /** @brief Total frames captured since pipeline creation */
+        /** @brief Total frames captured since pipeline creation (layer 0) */
         uint64_t frame_count() const { return frame_count_.load(); }
 
         /** @brief Seconds elapsed since the last frame was received */
@@ -118,12 +213,287 @@ namespace ist
         /** @brief Number of times the pipeline has been auto-restarted */
         int restart_count() const { return restart_count_.load(); }
 
+        /** @brief Restarts that replaced only the source bin (subset of restart_count()) */
+        int source_restart_count() const { return source_restart_count_.load(); }
+
+        /** @brief True while an on-demand pipeline is parked (no viewers) */
+        bool is_idle() const { return idle_.load(); }
+
+        /** @brief Duration of the last launch/resume state change in ms (-1 = none yet) */
+        int64_t last_start_ms() const { return last_start_ms_.load(); }
+
+        /** @brief Duration of the last full launch (probe, build, state change) in ms (-1 = none yet) */
+        int64_t last_launch_ms() const { return last_launch_ms_.load(); }
+
+        /** @brief Duration of the last park/teardown in ms (-1 = none yet) */
+        int64_t last_stop_ms() const { return last_stop_ms_.load(); }
+
+        /** @brief Time from the last launch/resume to its first frame in ms (-1 = none yet) */
+        int64_t last_warmup_ms() const { return last_warmup_ms_.load(); }
+
+        /** @brief Capture → appsink latency (source, convert and encode), all layers */
+        LatencyHistogram &capture_latency() { return capture_latency_; }
+
+        /** @brief Stalls detected by the frame watchdog (each triggers a restart) */
+        uint64_t stall_count() const { return stall_count_.load(); }
+
+        /** @brief Failure (error, EOS or stall) → first frame of the recovered pipeline */
+        LatencyHistogram &recovery_time() { return recovery_time_; }
+
+        /** @brief Duration of the last recovery in ms (-1 = none yet) */
+        int64_t last_recovery_ms() const { return last_recovery_ms_.load(); }
+
+        /** @brief Pool for this camera's RTP packet batches and owned frame copies */
+        const std::shared_ptr<BufferPool> &buffer_pool() const { return buffer_pool_; }
+
+        /** @brief Frame gap the watchdog treats as a stall */
+        std::chrono::milliseconds stall_threshold() const;
+
+        /// Frame-path counters of one layer (relaxed atomics, read for metrics)
+        struct LayerCounters
+        {
+            uint64_t frames;            ///< Encoded frames delivered by the appsink
+            uint64_t bytes;             ///< Encoded bytes delivered by the appsink
+            uint64_t keyframes;         ///< IDR frames among them
+            double keyframe_interval_s; ///< Time between the last two IDRs (0 = unknown)
+        };
+
+        /** @brief Snapshot of one layer's frame-path counters */
+        LayerCounters layer_counters(size_t layer) const;
+
+        // ── Join priming ────────────────────────────────────────────────
+
+        /**
+         * @brief  Frames cached for priming a newly opened track
+         *
+         * Starts with the latest IDR (SPS/PPS included) and, in GOP mode,
+         * continues with every frame received since. The cache is updated
+         * before callbacks run, so when called from a frame callback the
+         * frame being dispatched is already the last element.
+         *
+         * @param  layer  Simulcast layer index
+         * @return Cached frames in decode order (empty if none or disabled)
+         */
+        std::vector<H264Frame> cached_frames(size_t layer = 0) const;
+
+        // ── Keyframe control ────────────────────────────────────────────
+
+        /** @brief True if frames arrive encoded (RTSP, RELAY): no encoder, bitrate or mode control */
+        bool passthrough() const;
+
+        /** @brief True if IDRs can be forced: own encoder (USB/TEST) or relay with an origin track */
+        bool can_force_keyframe() const;
+
+        /**
+         * @brief Set how a RELAY camera asks its origin for an IDR
+         *
+         * @p fn is called (rate limited) from request_keyframe() on any
+         * thread and returns false if the request could not be sent; pass
+         * nullptr while no origin track is connected.
+         */
+        void set_keyframe_forwarder(std::function<bool()> fn);
+
+        // ── Relay input ─────────────────────────────────────────────────
+
+        /**
+         * @brief  Feed one H.264 access unit (Annex B) into a RELAY camera
+         *
+         * Copies the data into the appsrc, timestamped on arrival. Thread-safe.
+         *
+         * @return false if the pipeline is not running (parked, restarting or
+         *         not a relay camera)
+         */
+        bool push_frame(const std::byte *data, size_t size);
+
+        /**
+         * @brief  Ask the encoder for an IDR as soon as possible (PLI/FIR)
+         *
+         * Sends a GstForceKeyUnit event upstream from the appsink. Requests
+         * are rate limited per layer, so callers may forward every PLI.
+         *
+         * @param  layer  Simulcast layer whose encoder should emit the IDR
+         * @return false if the source cannot be forced (RTSP passthrough);
+         *         callers should fall back to the keyframe cache
+         */
+        bool request_keyframe(size_t layer = 0);
+
+        /** @brief Number of force-keyframe events sent to the encoders */
+        uint64_t keyframe_requests() const { return keyframe_requests_.load(); }
+
+        // ── Adaptive bitrate ────────────────────────────────────────────
+
+        /**
+         * @brief  Change the encoder bitrate live, without restarting
+         *
+         * Clamped to [min_bitrate_kbps(), max_bitrate_kbps()]; changes below
+         * a small threshold are ignored. The value also survives restarts.
+         *
+         * @param  kbps   Requested target bitrate
+         * @param  layer  Simulcast layer whose encoder to adjust
+         * @return false if the source has no encoder (RTSP passthrough)
+         */
+        bool set_bitrate(int kbps, size_t layer = 0);
+
+        /** @brief Current encoder target bitrate in kbps */
+        int bitrate_kbps(size_t layer = 0) const { return layers_[layer]->bitrate_kbps.load(); }
+
+        int min_bitrate_kbps(size_t layer = 0) const { return layers_[layer]->min_bitrate; }
+        int max_bitrate_kbps(size_t layer = 0) const { return layers_[layer]->info.bitrate; }
+
+        // ── Live reconfiguration ────────────────────────────────────────
+
+        /**
+         * @brief  Change the capture resolution and frame rate in place
+         *
+         * Applied on the reactor by updating the source's caps filter, so
+         * the source renegotiates and layer 0's encoder reconfigures without
+         * a teardown (simulcast layers keep their configured sizes). If the
+         * source cannot deliver the new mode, the resulting error replaces
+         * the source with a capture chain planned for it. The mode also
+         * survives restarts.
+         *
+         * @return false for RTSP (the camera owns its mode) or an invalid mode
+         */
+        bool reconfigure(const VideoMode &mode);
+
+        /** @brief Capture mode currently requested (config values until reconfigure()) */
+        VideoMode video_mode() const;
+
+        /** @brief Layer 0 encoder element after probing ("x264enc", "nvh265enc", ...; empty for RTSP) */
+        const std::string &encoder_factory() const { return encoder_factory_; }
+
     private:
-        /// GStreamer appsink callback — invoked on each new encoded sample
+        /// One encoded output: its own appsink, encoder, callbacks and cache
+        struct Layer
+        {
+            CameraPipeline *owner; ///< Back-pointer for the appsink callback
+            size_t index;
+            LayerInfo info;
+            int min_bitrate;
+
+            GstElement *appsink = nullptr; ///< Guarded by owner->element_mutex_
+            GstElement *encoder = nullptr; ///< Named encoder, null for RTSP (element_mutex_)
+            std::string encoder_factory;   ///< Element of encoder_ for this layer's codec (empty for RTSP)
+
+            CowRegistry<FrameCallback> callbacks; ///< Copy-on-write, lock-free reads
+
+            mutable std::mutex gop_mutex;
+            std::vector<H264Frame> gop_cache;      ///< IDR first, then deltas (GOP mode)
+            std::vector<std::byte> parameter_sets; ///< Latest VPS/SPS/PPS NAL units (Annex B, not AV1)
+
+            std::atomic<int> bitrate_kbps{0};
+            std::atomic<int64_t> last_keyframe_request_ms{0};
+
+            // Metrics (streaming thread writes, relaxed)
+            std::atomic<uint64_t> frames{0};
+            std::atomic<uint64_t> bytes{0};
+            std::atomic<uint64_t> keyframes{0};
+            std::atomic<int64_t> last_keyframe_us{0};     ///< steady_clock, 0 = none yet
+            std::atomic<int64_t> keyframe_interval_us{0};
+        };
+
+        /// GStreamer appsink callback — user_data is the Layer
         static GstFlowReturn on_new_sample(GstAppSink *sink, gpointer user_data);
 
-        /// Construct the GStreamer pipeline description string
-        std::string build_pipeline_description() const;
+        /// Bus sync handler — places streaming threads as they start (runs on the new thread)
+        static GstBusSyncReply on_sync_message(GstBus *bus, GstMessage *msg, gpointer user_data);
+
+        /// x264 worker threads per layer, from the CPUs the camera's threads may use
+        unsigned x264_threads() const;
+
+        /// Encoder GOP length in frames (keyframe_interval or 2 * fps)
+        int gop_length() const;
+
+        /// Which part of the graph a pending restart rebuilds
+        enum class RestartScope
+        {
+            SOURCE, ///< Replace the source bin, keep encoders and appsinks
+            FULL    ///< Tear down and relaunch the whole pipeline
+        };
+
+        /// Source bin: capture + conversion shared by all layers, or RTSP receive + depay
+        std::string source_description() const;
+
+        /// Branches bin: encoder (or parser) → appsink per layer, tee'd for simulcast
+        std::string branches_description() const;
+
+        /// Mode caps filter the source bin renegotiates through ("capsfilter name=mode ...")
+        std::string mode_filter(const std::string &media) const;
+
+        /// Parse one bin with ghost pads for its unlinked ends; null on error
+        GstElement *make_bin(const std::string &desc, const char *name) const;
+
+        /// Where captured frames live; selects the simulcast scaler
+        enum class FrameMemory
+        {
+            SYSTEM, ///< Plain buffers (videoscale)
+            VA,     ///< VA-API surfaces (vaapipostproc)
+            NVMM    ///< Jetson NVMM buffers (nvvidconv)
+        };
+
+        /// Raw/MJPEG modes a V4L2 device offers at the configured size and rate
+        struct DeviceModes
+        {
+            bool opened = false; ///< Device could be queried
+            bool nv12 = false;
+            bool i420 = false;
+            bool yuy2 = false;
+            bool mjpeg = false;
+        };
+
+        /// Open the V4L2 device in READY and intersect its caps with the configured mode
+        DeviceModes probe_device() const;
+
+        /// USB capture chain: source ! capsfilter(media + mode) convert
+        struct CapturePlan
+        {
+            std::string source;  ///< v4l2src with its properties
+            std::string media;   ///< Caps without the mode ("image/jpeg", ...)
+            std::string convert; ///< Elements after the caps filter (may be empty)
+            FrameMemory memory = FrameMemory::SYSTEM;
+        };
+
+        /// Raw capture + videoconvert (unless the encoder converts itself)
+        CapturePlan raw_capture() const;
+
+        /**
+         * @brief Choose the USB capture chain once the device can be queried
+         *
+         * Called before each launch or source restart until the probe
+         * succeeds for the current mode; sets capture_.
+         */
+        void plan_capture();
+
+        /// Scale one simulcast branch to the layer size in the capture memory
+        std::string scaler_description(const Layer &layer) const;
+
+        /// Encoder → appsink branch for one layer (USB/TEST)
+        std::string encoder_description(const Layer &layer) const;
+
+        /// H.265/AV1 encoder and parser of one layer (without the appsink)
+        std::string hevc_av1_encoder(const Layer &layer) const;
+
+        /// Element name with the layer suffix ("sink", "sink1", ...)
+        static std::string element_name(const char *base, size_t layer);
+
+        /**
+         * @brief  Pick the encoder backend whose element factories are installed
+         *
+         * Tries the configured backend (or every hardware backend for AUTO)
+         * and falls back to software. A backend qualifies only if it can
+         * encode @p codec and, with @p fallback, H.264 as well, so every
+         * layer reads the same capture memory. Sets encoder_ and
+         * encoder_factory_.
+         *
+         * @return false if no backend encodes @p codec
+         */
+        bool probe_encoder(VideoCodec codec, bool fallback);
+
+        /// Set the target bitrate on a live encoder element of @p layer in its own units
+        void apply_bitrate(const Layer &layer, GstElement *encoder, int kbps) const;
+
+        /// True if the backend is the Jetson V4L2 encoder family (NVMM buffers, nvvidconv)
+        bool jetson() const;
 
         /// Create and start the GStreamer pipeline (internal)
         bool launch_pipeline();
@@ -131,40 +501,149 @@ namespace ist
         /// Tear down the GStreamer pipeline with timeout (internal)
         void destroy_pipeline();
 
-        /// Bus monitoring thread entry point — handles ERROR/WARNING/EOS
-        void bus_monitor_thread();
+        /// Stop the source bin and remove it from the running pipeline (reactor thread)
+        void detach_source();
+
+        /// Build a new source bin and link it to the running branches (reactor thread)
+        bool restart_source();
+
+        /// Store a new mode and push it into the running source (reactor thread)
+        void apply_video_mode(const VideoMode &mode);
+
+        /// Bus watch callback — handles ERROR/WARNING/EOS (reactor thread)
+        void handle_bus_message(GstMessage *msg);
+
+        /// True if @p msg was posted by an element inside the source bin
+        bool from_source(GstMessage *msg) const;
+
+        /**
+         * @brief Tear down @p scope and arm the restart timer with the current backoff (reactor thread)
+         *
+         * A SOURCE restart becomes FULL when there is no source bin or the
+         * previous source restart has not produced a frame yet.
+         */
+        void schedule_restart(RestartScope scope);
+
+        /// Restart timer callback; re-arms itself with a longer backoff on failure (reactor thread)
+        void attempt_restart();
+
+        /**
+         * @brief Periodic frame watchdog (reactor thread)
+         *
+         * Restarts a streaming pipeline whose last frame is older than
+         * stall_threshold(), or one that produced no first frame within
+         * kFirstFrameTimeoutSeconds. Resets the restart backoff once frames
+         * flow again, so repeated stalls still back off.
+         */
+        void watchdog_tick();
+
+        /// Re-evaluate on-demand state on the reactor after callbacks changed
+        void request_demand_update();
+
+        /// Park or resume an on-demand pipeline from the callback count (reactor thread)
+        void update_demand();
 
-        /// Schedule a pipeline restart with exponential backoff
-        void schedule_restart();
+        /// READY → PLAYING for an on-demand pipeline (reactor thread)
+        void resume_pipeline();
+
+        /// PLAYING → READY once the idle timeout expires (reactor thread)
+        void park_pipeline();
+
+        /// Update a layer's join priming cache with a new frame (streaming thread)
+        void update_gop_cache(Layer &layer, const H264Frame &frame);
+
+        /// True if any layer has a registered callback
+        bool has_callbacks() const;
+
+        /// Drop every layer's cached frames
+        void clear_gop_caches();
 
         // ── Members ─────────────────────────────────────────────────────
 
         CameraConfig config_;
+        BusReactor &reactor_;
         GstElement *pipeline_ = nullptr;
-        GstElement *appsink_ = nullptr;
+        GstElement *source_ = nullptr;    ///< Source bin, owned by pipeline_ (reactor thread)
+        std::mutex element_mutex_;        ///< Guards the layers' appsink/encoder pointers and appsrc_
+        GstElement *appsrc_ = nullptr;    ///< RELAY input, ref held (element_mutex_)
         std::atomic<bool> running_{false};
         std::atomic<bool> shutdown_{false}; ///< Permanent stop — inhibits recovery
 
-        // Frame callback registry
-        mutable std::mutex cb_mutex_;
-        struct CallbackEntry
-        {
-            CallbackId id;
-            FrameCallback fn;
-        };
-        std::vector<CallbackEntry> callbacks_;
-        std::atomic<CallbackId> next_cb_id_{1};
+        // Encoded outputs, layer 0 = full quality (fixed after construction)
+        std::vector<std::unique_ptr<Layer>> layers_;
+
+        // Encoder backend resolved by probe_encoder() (fixed after construction)
+        EncoderType encoder_ = EncoderType::SOFTWARE;
+        std::string encoder_factory_;
+
+        // Capture mode (written on the reactor under mode_mutex_)
+        mutable std::mutex mode_mutex_;
+        VideoMode mode_;
+
+        // USB capture chain chosen by plan_capture() (pipeline threads only)
+        CapturePlan capture_;
+        VideoMode planned_mode_{0, 0, 0}; ///< Mode capture_ was probed for
+        bool capture_planned_ = false;
+        bool capture_fallback_ = false; ///< Planned chain failed; plain raw capture in use
 
         // Health metrics
         std::atomic<uint64_t> frame_count_{0};
         std::atomic<std::chrono::steady_clock::time_point> last_frame_time_{
             std::chrono::steady_clock::now()};
 
-        // Auto-recovery state
+        // Join priming cache
+        static constexpr size_t kMaxGopCacheFrames = 300; ///< Cap for long RTSP GOPs
+
+        // Keyframe requests (PLI/FIR)
+        std::atomic<uint64_t> keyframe_requests_{0};
+        mutable std::mutex forwarder_mutex_;
+        std::function<bool()> keyframe_forwarder_; ///< RELAY: PLI to the origin (forwarder_mutex_)
+        static constexpr int64_t kMinKeyframeRequestIntervalMs = 500; ///< Rate limit per layer
+
+        // Adaptive bitrate
+        static constexpr int kMinBitrateChangePercent = 5; ///< Hysteresis for set_bitrate()
+
+        // Latency instrumentation
+        LatencyHistogram capture_latency_;
+
+        std::shared_ptr<BufferPool> buffer_pool_; ///< Shared with in-flight batches (any thread releases)
+
+        // On-demand lifecycle (timer ID is reactor-thread only)
+        std::atomic<bool> idle_{false};
+        unsigned idle_timer_id_ = 0; ///< No viewers, idle timeout running
+
+        // Start/stop/warmup metrics
+        std::atomic<int64_t> last_start_ms_{-1};
+        std::atomic<int64_t> last_launch_ms_{-1};
+        std::atomic<int64_t> last_stop_ms_{-1};
+        std::atomic<int64_t> last_warmup_ms_{-1};
+        std::atomic<bool> awaiting_first_frame_{false};
+        std::atomic<std::chrono::steady_clock::time_point> warmup_start_{
+            std::chrono::steady_clock::now()};
+
+        // Auto-recovery state (IDs and backoff are reactor-thread only)
         std::atomic<int> restart_count_{0};
-        std::thread bus_thread_;
+        std::atomic<int> source_restart_count_{0};
+        unsigned bus_watch_id_ = 0;
+        unsigned restart_timer_id_ = 0;
+        unsigned watchdog_timer_id_ = 0;
+        int restart_attempt_ = 0; ///< Attempt number of the pending restart
+        RestartScope restart_scope_ = RestartScope::FULL; ///< Scope of the pending restart
+        bool source_restarted_ = false; ///< Last restart replaced only the source
         int backoff_seconds_ = 1;
         static constexpr int kMaxBackoffSeconds = 30; ///< Backoff ceiling
+
+        // Stall watchdog and recovery metrics
+        std::atomic<uint64_t> stall_count_{0};
+        std::atomic<bool> recovering_{false}; ///< Failure seen, waiting for the first frame
+        std::atomic<std::chrono::steady_clock::time_point> failure_time_{
+            std::chrono::steady_clock::now()};
+        std::atomic<int64_t> last_recovery_ms_{-1};
+        LatencyHistogram recovery_time_;
+        static constexpr unsigned kWatchdogIntervalMs = 250;
+        static constexpr int kStallFrames = 15;             ///< Missing frame intervals before a stall
+        static constexpr int kMinStallTimeoutMs = 500;      ///< Floor for high frame rates
+        static constexpr int kFirstFrameTimeoutSeconds = 10; ///< Covers RTSP connect + first IDR
     };
 
 } // namespace ist
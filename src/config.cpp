@@ -30,6 +30,8 @@ namespace ist
             return CameraType::USB;
         if (lower == "test")
             return CameraType::TEST;
+        if (lower == "relay")
+            return CameraType::RELAY;
         throw std::runtime_error("Unknown camera type: " + type_str);
     }
 
@@ -41,9 +43,202 @@ namespace ist
             return EncoderType::SOFTWARE;
         if (lower == "vaapi")
             return EncoderType::VAAPI;
+        if (lower == "nvenc")
+            return EncoderType::NVENC;
+        if (lower == "v4l2")
+            return EncoderType::V4L2;
+        if (lower == "qsv")
+            return EncoderType::QSV;
+        if (lower == "auto")
+            return EncoderType::AUTO;
         throw std::runtime_error("Unknown encoder type: " + encoder_str);
     }
 
+    const char *encoder_type_name(EncoderType type)
+    {
+        switch (type)
+        {
+        case EncoderType::SOFTWARE:
+            return "software";
+        case EncoderType::VAAPI:
+            return "vaapi";
+        case EncoderType::NVENC:
+            return "nvenc";
+        case EncoderType::V4L2:
+            return "v4l2";
+        case EncoderType::QSV:
+            return "qsv";
+        case EncoderType::AUTO:
+            return "auto";
+        }
+        return "unknown";
+    }
+
+    static VideoCodec parse_video_codec(const std::string &codec_str)
+    {
+        std::string lower = codec_str;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "h264" || lower == "avc")
+            return VideoCodec::H264;
+        if (lower == "h265" || lower == "hevc")
+            return VideoCodec::H265;
+        if (lower == "av1")
+            return VideoCodec::AV1;
+        throw std::runtime_error("Unknown codec: " + codec_str);
+    }
+
+    const char *video_codec_name(VideoCodec codec)
+    {
+        switch (codec)
+        {
+        case VideoCodec::H264:
+            return "h264";
+        case VideoCodec::H265:
+            return "h265";
+        case VideoCodec::AV1:
+            return "av1";
+        }
+        return "unknown";
+    }
+
+    static GopCacheMode parse_gop_cache_mode(const std::string &mode_str)
+    {
+        std::string lower = mode_str;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "off")
+            return GopCacheMode::OFF;
+        if (lower == "keyframe")
+            return GopCacheMode::KEYFRAME;
+        if (lower == "gop")
+            return GopCacheMode::GOP;
+        throw std::runtime_error("Unknown gop_cache mode: " + mode_str);
+    }
+
+    static FecMode parse_fec_mode(const std::string &mode_str)
+    {
+        std::string lower = mode_str;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "off")
+            return FecMode::OFF;
+        if (lower == "ulpfec")
+            return FecMode::ULPFEC;
+        throw std::runtime_error("Unknown fec mode: " + mode_str + " (flexfec is not supported)");
+    }
+
+    static RecordContainer parse_record_container(const std::string &container_str)
+    {
+        std::string lower = container_str;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "ts" || lower == "mpegts")
+            return RecordContainer::MPEGTS;
+        if (lower == "fmp4" || lower == "mp4")
+            return RecordContainer::FMP4;
+        throw std::runtime_error("Unknown recording container: " + container_str);
+    }
+
+    static SchedPolicy parse_sched_policy(const std::string &policy_str)
+    {
+        std::string lower = policy_str;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "inherit")
+            return SchedPolicy::INHERIT;
+        if (lower == "other" || lower == "normal")
+            return SchedPolicy::OTHER;
+        if (lower == "fifo")
+            return SchedPolicy::FIFO;
+        if (lower == "rr")
+            return SchedPolicy::RR;
+        throw std::runtime_error("Unknown sched_policy: " + policy_str);
+    }
+
+    const char *sched_policy_name(SchedPolicy policy)
+    {
+        switch (policy)
+        {
+        case SchedPolicy::INHERIT:
+            return "inherit";
+        case SchedPolicy::OTHER:
+            return "other";
+        case SchedPolicy::FIFO:
+            return "fifo";
+        case SchedPolicy::RR:
+            return "rr";
+        }
+        return "unknown";
+    }
+
+    /// CPU list as a YAML sequence ([2, 3]) or a taskset-style string ("2-3,6")
+    static std::vector<int> parse_cpu_list(const YAML::Node &node)
+    {
+        std::vector<int> cpus;
+        auto add = [&cpus](int cpu)
+        {
+            if (cpu < 0 || cpu >= 1024)
+                throw std::runtime_error("CPU index out of range in cpu_affinity: " + std::to_string(cpu));
+            if (std::find(cpus.begin(), cpus.end(), cpu) == cpus.end())
+                cpus.push_back(cpu);
+        };
+
+        if (node.IsSequence())
+        {
+            for (const auto &cpu : node)
+                add(cpu.as<int>());
+        }
+        else
+        {
+            std::string list = node.as<std::string>();
+            size_t pos = 0;
+            while (pos < list.size())
+            {
+                size_t end = list.find(',', pos);
+                std::string item = list.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+                pos = end == std::string::npos ? list.size() : end + 1;
+                if (item.empty())
+                    continue;
+                try
+                {
+                    size_t dash = item.find('-');
+                    int first = std::stoi(item.substr(0, dash));
+                    int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+                    for (int cpu = first; cpu <= last; cpu++)
+                        add(cpu);
+                }
+                catch (const std::logic_error &)
+                {
+                    throw std::runtime_error("Invalid cpu_affinity: " + list);
+                }
+            }
+        }
+        std::sort(cpus.begin(), cpus.end());
+        return cpus;
+    }
+
+    /// cpu_affinity / sched_policy / sched_priority keys of @p node
+    static void parse_thread_policy(const YAML::Node &node, ThreadPolicy &policy)
+    {
+        if (node["cpu_affinity"])
+            policy.cpus = parse_cpu_list(node["cpu_affinity"]);
+        if (node["sched_policy"])
+            policy.policy = parse_sched_policy(node["sched_policy"].as<std::string>());
+        if (node["sched_priority"])
+            policy.priority = std::clamp(node["sched_priority"].as<int>(), 1, 99);
+        if ((policy.policy == SchedPolicy::FIFO || policy.policy == SchedPolicy::RR) && policy.priority == 0)
+            policy.priority = 10;
+    }
+
+    static CaptureFormat parse_capture_format(const std::string &format_str)
+    {
+        std::string lower = format_str;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        if (lower == "auto")
+            return CaptureFormat::AUTO;
+        if (lower == "raw")
+            return CaptureFormat::RAW;
+        if (lower == "mjpeg")
+            return CaptureFormat::MJPEG;
+        throw std::runtime_error("Unknown capture_format: " + format_str);
+    }
+
     AppConfig load_config(const std::string &path)
     {
         spdlog::info("Loading configuration from: {}", path);
@@ -70,6 +265,8 @@ namespace ist
                 config.server.port = server["port"].as<uint16_t>();
             if (server["bind"])
                 config.server.bind = server["bind"].as<std::string>();
+            if (server["metrics_port"])
+                config.server.metrics_port = server["metrics_port"].as<uint16_t>();
         }
 
         // Cameras
@@ -82,6 +279,10 @@ namespace ist
                 cc.name = cam["name"].as<std::string>();
                 cc.type = parse_camera_type(cam["type"].as<std::string>());
                 cc.uri = cam["uri"].as<std::string>();
+                if (cam["relay_camera"])
+                    cc.relay_camera = cam["relay_camera"].as<std::string>();
+                if (cc.relay_camera.empty())
+                    cc.relay_camera = cc.id;
                 if (cam["width"])
                     cc.width = cam["width"].as<int>();
                 if (cam["height"])
@@ -98,6 +299,70 @@ namespace ist
                     cc.encoder = parse_encoder_type(cam["encoder"].as<std::string>());
                 }
 
+                // Codec (default: H264); passthrough sources carry what the camera sends
+                if (cam["codec"])
+                    cc.codec = parse_video_codec(cam["codec"].as<std::string>());
+                if (cam["h264_fallback"])
+                    cc.h264_fallback = cam["h264_fallback"].as<bool>();
+                if (cc.type == CameraType::RELAY && cc.codec != VideoCodec::H264)
+                    throw std::runtime_error("Camera '" + cc.id + "': relay cameras are H.264 only");
+                if (cc.type == CameraType::RTSP && cc.codec == VideoCodec::AV1)
+                    throw std::runtime_error("Camera '" + cc.id + "': RTSP passthrough supports h264 and h265");
+                if (cc.type == CameraType::RTSP && cc.codec != VideoCodec::H264 && cc.h264_fallback &&
+                    cam["h264_fallback"])
+                    spdlog::warn("Camera '{}': h264_fallback needs transcoding and is ignored for RTSP "
+                                 "(add the camera's H.264 substream as a separate camera)", cc.id);
+
+                if (cam["keyframe_interval"])
+                    cc.keyframe_interval = cam["keyframe_interval"].as<int>();
+                if (cam["min_bitrate"])
+                    cc.min_bitrate = cam["min_bitrate"].as<int>();
+                if (cam["max_bitrate"])
+                    cc.max_bitrate = cam["max_bitrate"].as<int>();
+                if (cam["on_demand"])
+                    cc.on_demand = cam["on_demand"].as<bool>();
+                if (cam["idle_timeout"])
+                    cc.idle_timeout = std::max(0, cam["idle_timeout"].as<int>());
+                if (cam["stall_timeout_ms"])
+                    cc.stall_timeout_ms = std::max(0, cam["stall_timeout_ms"].as<int>());
+                if (cam["buffer_pool_kb"])
+                    cc.buffer_pool_kb = std::max(0, cam["buffer_pool_kb"].as<int>());
+                parse_thread_policy(cam, cc.threads);
+
+                // Simulcast layers (encoded sources only)
+                if (auto layers = cam["simulcast"])
+                {
+                    for (const auto &layer : layers)
+                    {
+                        LayerConfig lc;
+                        lc.name = layer["name"].as<std::string>();
+                        if (layer["scale"])
+                            lc.scale = std::max(1, layer["scale"].as<int>());
+                        if (layer["bitrate"])
+                            lc.bitrate = layer["bitrate"].as<int>();
+                        if (lc.bitrate <= 0)
+                            lc.bitrate = std::max(1, cc.bitrate / (lc.scale * lc.scale));
+                        cc.simulcast.push_back(std::move(lc));
+                    }
+                    if ((cc.type == CameraType::RTSP || cc.type == CameraType::RELAY) && !cc.simulcast.empty())
+                    {
+                        spdlog::warn("Camera '{}': simulcast ignored for passthrough", cc.id);
+                        cc.simulcast.clear();
+                    }
+                }
+
+                // V4L2 capture format (default: AUTO)
+                if (cam["capture_format"])
+                {
+                    cc.capture_format = parse_capture_format(cam["capture_format"].as<std::string>());
+                }
+
+                // Join priming cache (default: KEYFRAME)
+                if (cam["gop_cache"])
+                {
+                    cc.gop_cache = parse_gop_cache_mode(cam["gop_cache"].as<std::string>());
+                }
+
                 config.cameras.push_back(std::move(cc));
             }
         }
@@ -106,6 +371,11 @@ namespace ist
         {
             throw std::runtime_error("No cameras configured");
         }
+        if (config.cameras.size() > kMaxCameras)
+        {
+            throw std::runtime_error("Too many cameras: " + std::to_string(config.cameras.size()) +
+                                     " (RTP payload types allow at most " + std::to_string(kMaxCameras) + ")");
+        }
 
         // WebRTC config
         if (auto webrtc = root["webrtc"])
@@ -116,6 +386,83 @@ namespace ist
                 config.webrtc.max_clients = webrtc["max_clients"].as<int>();
             if (webrtc["mtu"])
                 config.webrtc.mtu = webrtc["mtu"].as<int>();
+            if (webrtc["send_queue_depth"])
+                config.webrtc.send_queue_depth = webrtc["send_queue_depth"].as<int>();
+            if (webrtc["adaptive_bitrate"])
+                config.webrtc.adaptive_bitrate = webrtc["adaptive_bitrate"].as<bool>();
+            if (webrtc["abr_percentile"])
+                config.webrtc.abr_percentile = std::clamp(webrtc["abr_percentile"].as<int>(), 0, 100);
+            if (webrtc["signaling_workers"])
+                config.webrtc.signaling_workers = std::max(1, webrtc["signaling_workers"].as<int>());
+            if (webrtc["fast_connect"])
+                config.webrtc.fast_connect = webrtc["fast_connect"].as<bool>();
+            if (webrtc["candidate_batch_ms"])
+                config.webrtc.candidate_batch_ms = std::max(0, webrtc["candidate_batch_ms"].as<int>());
+            if (webrtc["nack_buffer_kb"])
+                config.webrtc.nack_buffer_kb = std::max(0, webrtc["nack_buffer_kb"].as<int>());
+            if (webrtc["fec"])
+                config.webrtc.fec = parse_fec_mode(webrtc["fec"].as<std::string>());
+            if (webrtc["fec_group"])
+                config.webrtc.fec_group = std::clamp(webrtc["fec_group"].as<int>(), 1, 16);
+            if (webrtc["pacer"])
+                config.webrtc.pacer = webrtc["pacer"].as<bool>();
+            if (webrtc["pacer_spread"])
+                config.webrtc.pacer_spread = std::clamp(webrtc["pacer_spread"].as<double>(), 0.0, 1.0);
+            if (webrtc["pacer_max_kbps"])
+                config.webrtc.pacer_max_kbps = std::max(0, webrtc["pacer_max_kbps"].as<int>());
+            if (webrtc["stagger_keyframes"])
+                config.webrtc.stagger_keyframes = webrtc["stagger_keyframes"].as<bool>();
+            if (webrtc["uplink_budget_kbps"])
+                config.webrtc.uplink_budget_kbps = std::max(0, webrtc["uplink_budget_kbps"].as<int>());
+            if (webrtc["focus_weight"])
+                config.webrtc.focus_weight = std::max(0.01, webrtc["focus_weight"].as<double>());
+            if (webrtc["background_weight"])
+                config.webrtc.background_weight = std::max(0.01, webrtc["background_weight"].as<double>());
+            if (webrtc["background_fps"])
+                config.webrtc.background_fps = std::max(0, webrtc["background_fps"].as<int>());
+        }
+
+        // Recording config
+        if (auto recording = root["recording"])
+        {
+            if (recording["enabled"])
+                config.recording.enabled = recording["enabled"].as<bool>();
+            if (recording["path"])
+                config.recording.path = recording["path"].as<std::string>();
+            if (recording["container"])
+                config.recording.container = parse_record_container(recording["container"].as<std::string>());
+            if (recording["segment_seconds"])
+                config.recording.segment_seconds = std::max(1, recording["segment_seconds"].as<int>());
+            if (recording["max_segments"])
+                config.recording.max_segments = std::max(0, recording["max_segments"].as<int>());
+            if (recording["fragment_ms"])
+                config.recording.fragment_ms = std::max(100, recording["fragment_ms"].as<int>());
+            if (recording["queue_kb"])
+                config.recording.queue_kb = std::max(256, recording["queue_kb"].as<int>());
+            if (recording["write_buffer_kb"])
+                config.recording.write_buffer_kb = std::max(4, recording["write_buffer_kb"].as<int>());
+            if (auto ids = recording["cameras"])
+            {
+                for (const auto &id : ids)
+                    config.recording.cameras.push_back(id.as<std::string>());
+            }
+            for (const auto &id : config.recording.cameras)
+            {
+                bool known = std::any_of(config.cameras.begin(), config.cameras.end(),
+                                         [&id](const CameraConfig &cam)
+                                         { return cam.id == id; });
+                if (!known)
+                    throw std::runtime_error("Unknown camera in recording.cameras: " + id);
+            }
+        }
+
+        // Thread placement
+        if (auto threads = root["threads"])
+        {
+            if (threads["control"])
+                parse_thread_policy(threads["control"], config.threads.control);
+            if (threads["send"])
+                parse_thread_policy(threads["send"], config.threads.send);
         }
 
         spdlog::info("Configuration loaded: {} cameras, port {}, max {} clients",
@@ -123,11 +470,12 @@ namespace ist
 
         for (const auto &cam : config.cameras)
         {
-            std::string type_str = (cam.type == CameraType::RTSP) ? "RTSP" : (cam.type == CameraType::USB) ? "USB"
-                                                                                                           : "TEST";
-            std::string encoder_str = (cam.encoder == EncoderType::SOFTWARE) ? "software" : "vaapi";
+            std::string type_str = (cam.type == CameraType::RTSP)    ? "RTSP"
+                                   : (cam.type == CameraType::USB)   ? "USB"
+                                   : (cam.type == CameraType::RELAY) ? "RELAY"
+                                                                     : "TEST";
             spdlog::info("  Camera [{}] '{}' type={} encoder={} uri={} {}x{}@{}fps",
-                         cam.id, cam.name, type_str, encoder_str, cam.uri,
+                         cam.id, cam.name, type_str, encoder_type_name(cam.encoder), cam.uri,
                          cam.width, cam.height, cam.fps);
         }
 
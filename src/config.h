@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -25,18 +26,119 @@ namespace ist
      */
     enum class CameraType
     {
-        RTSP, ///< IP camera via RTSP protocol (H.264 passthrough)
+        RTSP, ///< IP camera via RTSP protocol (H.264/H.265 passthrough)
         USB,  ///< USB/V4L2 camera (requires software encoding)
-        TEST  ///< GStreamer test pattern (development/diagnostics)
+        TEST, ///< GStreamer test pattern (development/diagnostics)
+        RELAY ///< Camera of an origin server received over WebRTC (H.264 passthrough)
     };
 
+    /**
+     * @brief Video codec of a camera's stream
+     */
+    enum class VideoCodec
+    {
+        H264, ///< H.264/AVC (every browser)
+        H265, ///< H.265/HEVC (Safari, Chrome/Edge with hardware decode)
+        AV1   ///< AV1 (Chrome, Firefox, Edge; encoded sources only)
+    };
+
+    /** @brief Lower-case config name of a codec ("h264", "h265", "av1") */
+    const char *video_codec_name(VideoCodec codec);
+
     /**
      * @brief Video encoder backend selection
      */
     enum class EncoderType
     {
         SOFTWARE, ///< x264enc (CPU-based, slower but compatible)
-        VAAPI     ///< vaapih264enc (Intel Quick Sync via VA-API, requires hardware support)
+        VAAPI,    ///< vaapih264enc (Intel Quick Sync via VA-API, requires hardware support)
+        NVENC,    ///< nvh264enc (NVIDIA dGPU) or nvv4l2h264enc (Jetson)
+        V4L2,     ///< v4l2h264enc (V4L2 mem2mem, e.g. Raspberry Pi)
+        QSV,      ///< qsvh264enc (Intel Quick Sync via oneVPL)
+        AUTO      ///< First available of NVENC, QSV, VAAPI, V4L2, then SOFTWARE
+    };
+
+    /** @brief Lower-case config name of an encoder backend ("software", "nvenc", ...) */
+    const char *encoder_type_name(EncoderType type);
+
+    /**
+     * @brief Per-camera cache used to prime newly opened tracks
+     */
+    enum class GopCacheMode
+    {
+        OFF,      ///< No cache — new viewers wait for the next IDR
+        KEYFRAME, ///< Latest IDR (with SPS/PPS) only
+        GOP       ///< Latest IDR plus every frame since (artifact-free join)
+    };
+
+    /**
+     * @brief Forward error correction for outgoing video
+     */
+    enum class FecMode
+    {
+        OFF,   ///< NACK retransmission only
+        ULPFEC ///< RED + ULPFEC (RFC 2198 / RFC 5109) for peers that negotiate it
+    };
+
+    /**
+     * @brief Container of recorded segments
+     */
+    enum class RecordContainer
+    {
+        MPEGTS, ///< MPEG-TS: every segment playable up to the last written packet
+        FMP4    ///< Fragmented MP4: fragments flushed every fragment_ms
+    };
+
+    /**
+     * @brief V4L2 capture format negotiation (USB only)
+     */
+    enum class CaptureFormat
+    {
+        AUTO,  ///< Probe the device: encoder-native raw, then MJPEG, then raw + videoconvert
+        RAW,   ///< Uncompressed capture (converted only if the encoder cannot take it)
+        MJPEG  ///< MJPEG capture, decoded in hardware when a decoder is available
+    };
+
+    /**
+     * @brief Linux scheduling class for pinned threads
+     */
+    enum class SchedPolicy
+    {
+        INHERIT, ///< Leave the scheduling class unchanged
+        OTHER,   ///< SCHED_OTHER (normal time sharing)
+        FIFO,    ///< SCHED_FIFO real-time (needs CAP_SYS_NICE or an rtprio limit)
+        RR       ///< SCHED_RR real-time (needs CAP_SYS_NICE or an rtprio limit)
+    };
+
+    /**
+     * @brief CPU placement and scheduling class for a group of threads
+     *
+     * An empty CPU list means every CPU the process may use (as started,
+     * e.g. under taskset or a cgroup cpuset).
+     */
+    struct ThreadPolicy
+    {
+        std::vector<int> cpus;                       ///< Allowed CPUs (empty = process default)
+        SchedPolicy policy = SchedPolicy::INHERIT;   ///< Scheduling class
+        int priority = 0;                            ///< Real-time priority 1-99 (FIFO/RR only)
+
+        bool configured() const { return !cpus.empty() || policy != SchedPolicy::INHERIT; }
+    };
+
+    /** @brief Config name of a scheduling class ("inherit", "other", "fifo", "rr") */
+    const char *sched_policy_name(SchedPolicy policy);
+
+    /**
+     * @brief Additional lower-quality simulcast layer (USB/TEST only)
+     *
+     * Layers share the camera's capture and colour conversion; each adds a
+     * scaled encoder branch. The camera's own resolution is always layer 0.
+     */
+    struct LayerConfig
+    {
+        std::string name; ///< Layer name advertised in camera_list (e.g., "half")
+        int scale = 2;    ///< Resolution divisor relative to the camera (2 = half)
+        int bitrate = 0;  ///< Target bitrate in kbps (0 = camera bitrate / scale^2, resolved on load)
     };
 
     /**
@@ -47,12 +149,26 @@ namespace ist
         std::string id;      ///< Unique camera identifier (e.g., "cam_front")
         std::string name;    ///< Human-readable display name
         CameraType type;     ///< Source type (RTSP, USB, or TEST)
-        std::string uri;     ///< RTSP URI or V4L2 device path
+        std::string uri;     ///< RTSP URI, V4L2 device path, or origin signaling URL (RELAY)
+        std::string relay_camera; ///< Camera id on the origin (RELAY only, empty = same id)
         int width;           ///< Capture width in pixels
         int height;          ///< Capture height in pixels
         int fps;             ///< Target frame rate
         int bitrate;         ///< Target bitrate in kbps (USB/TEST encoding only)
-        EncoderType encoder; ///< Encoder backend (SOFTWARE or VAAPI, USB/TEST only)
+        EncoderType encoder; ///< Requested encoder backend (USB/TEST only); probed at startup
+        VideoCodec codec = VideoCodec::H264; ///< Encoded codec (USB/TEST) or the camera's codec (RTSP)
+        bool h264_fallback = true; ///< Extra full-size H.264 layer for viewers without codec (USB/TEST, codec != h264)
+        CaptureFormat capture_format = CaptureFormat::AUTO; ///< V4L2 capture format (USB only)
+        GopCacheMode gop_cache = GopCacheMode::KEYFRAME; ///< Join priming cache
+        int keyframe_interval = 0; ///< Encoder GOP length in frames (0 = 2 * fps, USB/TEST only)
+        int min_bitrate = 0;       ///< Adaptive bitrate floor in kbps (0 = bitrate / 4)
+        int max_bitrate = 0;       ///< Adaptive bitrate ceiling in kbps (0 = bitrate)
+        bool on_demand = false;    ///< Run the pipeline only while someone is watching
+        int idle_timeout = 30;     ///< Seconds without viewers before an on-demand pipeline parks
+        int stall_timeout_ms = 0;  ///< Frame gap that counts as a stall (0 = 15 frame intervals, min 500 ms)
+        int buffer_pool_kb = 8192; ///< Free packet/frame buffer memory kept for reuse
+        ThreadPolicy threads;      ///< Streaming and encoder threads (cpu_affinity, sched_policy, sched_priority)
+        std::vector<LayerConfig> simulcast; ///< Extra scaled layers, highest quality first
     };
 
     /**
@@ -62,6 +178,7 @@ namespace ist
     {
         int port;         ///< WebSocket signaling port
         std::string bind; ///< Bind address (e.g., "0.0.0.0")
+        int metrics_port = 9100; ///< Prometheus /metrics HTTP port on the same address (0 = disabled)
     };
 
     /**
@@ -72,8 +189,57 @@ namespace ist
         std::string stun_server; ///< STUN server URI (empty = local network only)
         int max_clients;         ///< Maximum concurrent WebRTC clients
         int mtu = 0;            ///< RTP MTU size (0 = use libdatachannel default 1200)
+        int send_queue_depth = 8; ///< Max queued frames per track before dropping to next keyframe
+        bool adaptive_bitrate = true; ///< Drive encoder bitrate from REMB / RTCP loss feedback
+        int abr_percentile = 0;       ///< Viewer percentile to follow (0 = weakest viewer)
+        int signaling_workers = 4;    ///< Threads for SDP/ICE handling (parallel across clients)
+        bool fast_connect = true;     ///< Offer on WebSocket open, shared ICE UDP port, batched candidates
+        int candidate_batch_ms = 20;  ///< Local candidates gathered within this window share one message
+        int nack_buffer_kb = 2048;    ///< Packets kept per camera layer for NACK retransmission (0 = off)
+        FecMode fec = FecMode::OFF;   ///< Optional FEC for lossy links
+        int fec_group = 8;            ///< Media packets protected by one FEC packet (1-16)
+        bool pacer = true;            ///< Spread each frame's packets instead of sending them back to back
+        double pacer_spread = 0.5;    ///< Fraction of the frame interval a frame is spread over (0-1)
+        int pacer_max_kbps = 0;       ///< Per-peer send-rate cap (0 = none)
+        bool stagger_keyframes = true; ///< Offset camera keyframes at startup so IDRs do not coincide
+        int uplink_budget_kbps = 0;    ///< Total video bitrate per viewer split across cameras (0 = per-camera bitrate)
+        double focus_weight = 4.0;     ///< Budget weight of a camera a client focuses
+        double background_weight = 0.25; ///< Budget weight of a camera shown only in the background
+        int background_fps = 0;        ///< Frame rate for cameras every viewer has in the background (0 = unchanged)
+    };
+
+    /**
+     * @brief Continuous recording of the encoded streams to disk
+     *
+     * Each recorded camera writes keyframe-aligned segments named
+     * `<path>/<camera id>_<index>.<ts|mp4>`; once max_segments exist the
+     * oldest segment is overwritten, so disk use stays bounded.
+     */
+    struct RecordingConfig
+    {
+        bool enabled = false;               ///< Record cameras (off by default)
+        std::string path = "recordings";    ///< Directory for the segments (created if missing)
+        RecordContainer container = RecordContainer::MPEGTS; ///< Segment container
+        int segment_seconds = 60;           ///< Target segment length (cut on the next keyframe)
+        int max_segments = 60;              ///< Segments kept per camera (ring); 0 = unbounded
+        int fragment_ms = 1000;             ///< fMP4 fragment duration (FMP4 only)
+        int queue_kb = 8192;                ///< Frames waiting for the disk before dropping to the next keyframe
+        int write_buffer_kb = 1024;         ///< Writes are batched into chunks of this size
+        std::vector<std::string> cameras;   ///< Camera ids to record (empty = all)
     };
 
+    /**
+     * @brief Placement of the threads not owned by a camera
+     */
+    struct ThreadsConfig
+    {
+        ThreadPolicy control; ///< Main thread and everything it spawns: reactor, signaling, metrics, transport
+        ThreadPolicy send;    ///< Per-peer RTP send workers
+    };
+
+    /// Cameras that fit the dynamic RTP payload type range (see RtpFanout::payload_type_for)
+    constexpr size_t kMaxCameras = 28;
+
     /**
      * @brief Top-level application configuration
      */
@@ -83,6 +249,8 @@ namespace ist
         ServerConfig server;               ///< Server networking settings
         std::vector<CameraConfig> cameras; ///< Camera source definitions
         WebRTCConfig webrtc;               ///< WebRTC parameters
+        RecordingConfig recording;         ///< Disk recording
+        ThreadsConfig threads;             ///< CPU affinity / scheduling of shared threads
     };
 
     /**
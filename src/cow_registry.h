@@ -0,0 +1,142 @@
+/**
+ * @file    cow_registry.h
+ * @brief   Copy-on-write registry with lock-free snapshot reads
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * RCU-style container for callback and subscriber lists that are read on
+ * every frame but modified only when peers join or leave. Readers load an
+ * immutable snapshot without taking the writer mutex; writers build a new
+ * vector and publish it atomically.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Copy-on-write list of (id, value) entries
+     *
+     * Thread Safety:
+     *   - snapshot() never blocks on writers (std::atomic_load of shared_ptr)
+     *   - add(), remove(), clear() are serialized by an internal writer mutex
+     *
+     * @tparam T  Entry payload (callback, subscriber record, ...)
+     */
+    template <typename T>
+    class CowRegistry
+    {
+    public:
+        using Id = uint64_t;
+
+        struct Entry
+        {
+            Id id;
+            T value;
+        };
+
+        using Snapshot = std::shared_ptr<const std::vector<Entry>>;
+
+        CowRegistry() : entries_(std::make_shared<const std::vector<Entry>>()) {}
+
+        // Non-copyable, non-movable
+        CowRegistry(const CowRegistry &) = delete;
+        CowRegistry &operator=(const CowRegistry &) = delete;
+
+        /** @brief Current immutable snapshot (valid for as long as it is held) */
+        Snapshot snapshot() const { return std::atomic_load(&entries_); }
+
+        /** @brief Number of entries in the current snapshot */
+        size_t size() const { return snapshot()->size(); }
+
+        /**
+         * @brief  Append an entry and publish a new snapshot
+         * @return Unique ID for this entry
+         */
+        Id add(T value)
+        {
+            std::lock_guard<std::mutex> lock(write_mutex_);
+            Id id = next_id_++;
+            auto next = std::make_shared<std::vector<Entry>>(*snapshot());
+            next->push_back({id, std::move(value)});
+            std::atomic_store(&entries_, Snapshot(std::move(next)));
+            return id;
+        }
+
+        /**
+         * @brief  Remove an entry and publish a new snapshot
+         * @param  id    Entry ID returned by add()
+         * @param  sync  Wait until no reader still holds the previous snapshot,
+         *               so the removed value is no longer in use on return.
+         *               Must not be set when called from inside a reader.
+         * @return true if the entry existed
+         */
+        bool remove(Id id, bool sync = false)
+        {
+            Snapshot previous;
+            {
+                std::lock_guard<std::mutex> lock(write_mutex_);
+                auto current = snapshot();
+                auto next = std::make_shared<std::vector<Entry>>();
+                next->reserve(current->size());
+                for (const auto &e : *current)
+                {
+                    if (e.id != id)
+                        next->push_back(e);
+                }
+                if (next->size() == current->size())
+                    return false;
+
+                previous = std::atomic_exchange(&entries_, Snapshot(std::move(next)));
+            }
+            if (sync)
+                wait_for_readers(std::move(previous));
+            return true;
+        }
+
+        /**
+         * @brief  Remove all entries
+         * @param  sync  Same semantics as remove()
+         * @return Number of entries removed
+         */
+        size_t clear(bool sync = false)
+        {
+            Snapshot previous;
+            {
+                std::lock_guard<std::mutex> lock(write_mutex_);
+                previous = std::atomic_exchange(
+                    &entries_, Snapshot(std::make_shared<const std::vector<Entry>>()));
+            }
+            size_t count = previous->size();
+            if (sync)
+                wait_for_readers(std::move(previous));
+            return count;
+        }
+
+    private:
+        /// Grace period: readers hold a snapshot copy only while dispatching
+        static void wait_for_readers(Snapshot previous)
+        {
+            // The writer's own reference accounts for one; `current` copies
+            // taken inside remove() have already been released
+            while (previous.use_count() > 1)
+                std::this_thread::yield();
+        }
+
+        Snapshot entries_;          ///< Accessed only via std::atomic_* functions
+        std::mutex write_mutex_;    ///< Serializes writers
+        Id next_id_ = 1;
+    };
+
+} // namespace ist
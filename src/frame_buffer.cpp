@@ -0,0 +1,68 @@
+/**
+ * @file    frame_buffer.cpp
+ * @brief   Refcounted encoded frame payload implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "frame_buffer.h"
+#include <cstring>
+
+namespace ist
+{
+
+    std::shared_ptr<const FrameBuffer> FrameBuffer::wrap(GstBuffer *buffer)
+    {
+        if (!buffer)
+            return nullptr;
+
+        std::shared_ptr<FrameBuffer> fb(new FrameBuffer());
+        fb->buffer_ = gst_buffer_ref(buffer);
+        if (!gst_buffer_map(fb->buffer_, &fb->map_, GST_MAP_READ))
+        {
+            // Destructor must not unmap a buffer that was never mapped
+            gst_buffer_unref(fb->buffer_);
+            fb->buffer_ = nullptr;
+            return nullptr;
+        }
+
+        fb->data_ = reinterpret_cast<const std::byte *>(fb->map_.data);
+        fb->size_ = fb->map_.size;
+        return fb;
+    }
+
+    std::shared_ptr<const FrameBuffer> FrameBuffer::copy(const std::byte *data, size_t size,
+                                                         const std::shared_ptr<BufferPool> &pool)
+    {
+        return copy(nullptr, 0, data, size, pool);
+    }
+
+    std::shared_ptr<const FrameBuffer> FrameBuffer::copy(const std::byte *prefix, size_t prefix_size,
+                                                         const std::byte *data, size_t size,
+                                                         const std::shared_ptr<BufferPool> &pool)
+    {
+        std::shared_ptr<FrameBuffer> fb(new FrameBuffer());
+        const size_t total = prefix_size + size;
+        fb->owned_ = pool ? pool->acquire(total) : PooledBuffer::unpooled(total);
+        if (prefix_size > 0)
+            std::memcpy(fb->owned_.data(), prefix, prefix_size);
+        if (size > 0)
+            std::memcpy(fb->owned_.data() + prefix_size, data, size);
+        fb->data_ = fb->owned_.data();
+        fb->size_ = total;
+        return fb;
+    }
+
+    FrameBuffer::~FrameBuffer()
+    {
+        if (buffer_)
+        {
+            gst_buffer_unmap(buffer_, &map_);
+            gst_buffer_unref(buffer_);
+        }
+    }
+
+} // namespace ist
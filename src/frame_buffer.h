@@ -0,0 +1,87 @@
+/**
+ * @file    frame_buffer.h
+ * @brief   Refcounted, immutable view over an encoded access unit
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Wraps the GstBuffer pulled from the appsink so that H.264 frames can be
+ * fanned out to every subscriber without copying the payload. The buffer
+ * stays mapped for as long as any FrameBuffer reference is alive and is
+ * released back to GStreamer when the last consumer drops it.
+ */
+
+#pragma once
+
+#include "buffer_pool.h"
+#include <gst/gst.h>
+#include <cstddef>
+#include <memory>
+
+namespace ist
+{
+
+    /**
+     * @brief Immutable encoded frame payload shared between consumers
+     *
+     * Either backed by a mapped GstBuffer (zero-copy path from the appsink)
+     * or by owned storage (frames produced outside GStreamer), taken from
+     * the camera's BufferPool when one is given.
+     * Instances are always handled through std::shared_ptr<const FrameBuffer>.
+     *
+     * Thread Safety:
+     *   - Read-only after construction; safe to share across threads
+     */
+    class FrameBuffer
+    {
+    public:
+        /**
+         * @brief  Wrap a GstBuffer without copying its contents
+         * @param  buffer  Source buffer (a new reference is taken)
+         * @return Shared view, or nullptr if the buffer cannot be mapped
+         */
+        static std::shared_ptr<const FrameBuffer> wrap(GstBuffer *buffer);
+
+        /**
+         * @brief  Create a frame buffer owning a copy of the given bytes
+         * @param  data  Payload start
+         * @param  size  Payload size in bytes
+         * @param  pool  Pool for the storage (nullptr = plain heap)
+         */
+        static std::shared_ptr<const FrameBuffer> copy(const std::byte *data, size_t size,
+                                                       const std::shared_ptr<BufferPool> &pool = nullptr);
+
+        /**
+         * @brief  Create a frame buffer owning @p prefix followed by @p data
+         *
+         * Used to prepend parameter sets to an access unit in one copy.
+         */
+        static std::shared_ptr<const FrameBuffer> copy(const std::byte *prefix, size_t prefix_size,
+                                                       const std::byte *data, size_t size,
+                                                       const std::shared_ptr<BufferPool> &pool = nullptr);
+
+        ~FrameBuffer();
+
+        // Non-copyable, non-movable (always shared by pointer)
+        FrameBuffer(const FrameBuffer &) = delete;
+        FrameBuffer &operator=(const FrameBuffer &) = delete;
+
+        const std::byte *data() const { return data_; }
+        size_t size() const { return size_; }
+
+        /** @brief Underlying GstBuffer, or nullptr for owned payloads */
+        GstBuffer *gst_buffer() const { return buffer_; }
+
+    private:
+        FrameBuffer() = default;
+
+        GstBuffer *buffer_ = nullptr; ///< Referenced source buffer (zero-copy path)
+        GstMapInfo map_{};            ///< Read mapping held for the buffer lifetime
+        PooledBuffer owned_;          ///< Owned storage (copy path)
+        const std::byte *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+} // namespace ist
@@ -0,0 +1,105 @@
+/**
+ * @file    latency_histogram.cpp
+ * @brief   Lock-free latency histogram implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "latency_histogram.h"
+
+namespace ist
+{
+
+    size_t LatencyHistogram::bucket_index(int64_t us)
+    {
+        if (us < 0)
+            us = 0;
+        auto v = static_cast<uint64_t>(us);
+        if (v < kLinearBuckets * 16)
+            return static_cast<size_t>(v >> 4);
+
+        int exponent = 63 - __builtin_clzll(v); // >= 10 here
+        size_t octave = static_cast<size_t>(exponent - 10);
+        if (octave >= kOctaves)
+            return kBucketCount - 1;
+
+        size_t sub = static_cast<size_t>(v >> (exponent - 4)) & (kSubBuckets - 1);
+        return kLinearBuckets + octave * kSubBuckets + sub;
+    }
+
+    int64_t LatencyHistogram::bucket_upper_us(size_t index)
+    {
+        if (index < kLinearBuckets)
+            return static_cast<int64_t>(index + 1) * 16;
+
+        size_t octave = (index - kLinearBuckets) / kSubBuckets;
+        size_t sub = (index - kLinearBuckets) % kSubBuckets;
+        return static_cast<int64_t>(kSubBuckets + sub + 1) << (octave + 10 - 4);
+    }
+
+    void LatencyHistogram::record(int64_t us)
+    {
+        buckets_[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+        sum_us_.fetch_add(static_cast<uint64_t>(us < 0 ? 0 : us), std::memory_order_relaxed);
+    }
+
+    LatencyHistogram::Counts LatencyHistogram::load_counts() const
+    {
+        Counts counts;
+        for (size_t i = 0; i < kBucketCount; i++)
+            counts[i] = buckets_[i].load(std::memory_order_relaxed);
+        return counts;
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::summarize(const Counts &counts)
+    {
+        Summary summary;
+        for (uint64_t c : counts)
+            summary.count += c;
+        if (summary.count == 0)
+            return summary;
+
+        // Nearest-rank percentiles, reported at the bucket's upper bound
+        auto rank = [&summary](double p)
+        { return static_cast<uint64_t>(p * static_cast<double>(summary.count - 1)) + 1; };
+        const uint64_t r50 = rank(0.50), r95 = rank(0.95), r99 = rank(0.99);
+
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; i++)
+        {
+            if (counts[i] == 0)
+                continue;
+            uint64_t before = seen;
+            seen += counts[i];
+            double upper_ms = static_cast<double>(bucket_upper_us(i)) / 1000.0;
+            if (before < r50 && seen >= r50)
+                summary.p50_ms = upper_ms;
+            if (before < r95 && seen >= r95)
+                summary.p95_ms = upper_ms;
+            if (before < r99 && seen >= r99)
+                summary.p99_ms = upper_ms;
+            summary.max_ms = upper_ms;
+        }
+        return summary;
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::summary() const
+    {
+        return summarize(load_counts());
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::interval()
+    {
+        std::lock_guard<std::mutex> lock(interval_mutex_);
+        Counts now = load_counts();
+        Counts delta;
+        for (size_t i = 0; i < kBucketCount; i++)
+            delta[i] = now[i] - last_interval_[i];
+        last_interval_ = now;
+        return summarize(delta);
+    }
+
+} // namespace ist
@@ -0,0 +1,94 @@
+/**
+ * @file    latency_histogram.h
+ * @brief   Lock-free latency histogram with percentile summaries
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Records per-stage latencies (capture → appsink → dispatch → packetized
+ * → sent) on the hot path with a single relaxed atomic increment. Buckets
+ * are log-linear: 16 µs resolution below ~1 ms, then 16 sub-buckets per
+ * power of two up to ~16 s, so percentiles stay within ~6% of the true
+ * value across the whole range.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace ist
+{
+
+    /**
+     * @brief Cumulative latency histogram
+     *
+     * Thread Safety:
+     *   - record() is lock-free and may be called from any thread
+     *   - summary() and interval() may run concurrently with record();
+     *     interval() calls are serialized by an internal mutex
+     */
+    class LatencyHistogram
+    {
+    public:
+        /// Percentiles over a set of samples, in milliseconds
+        struct Summary
+        {
+            uint64_t count = 0;
+            double p50_ms = 0;
+            double p95_ms = 0;
+            double p99_ms = 0;
+            double max_ms = 0; ///< Upper bound of the highest non-empty bucket
+        };
+
+        static constexpr size_t kLinearBuckets = 64;    ///< 0 … 1024 µs in 16 µs steps
+        static constexpr size_t kSubBuckets = 16;       ///< Per power of two above that
+        static constexpr size_t kOctaves = 14;          ///< 2^10 … 2^24 µs (~16.7 s)
+        static constexpr size_t kBucketCount = kLinearBuckets + kOctaves * kSubBuckets;
+
+        /** @brief Record one sample in microseconds (negative values count as 0) */
+        void record(int64_t us);
+
+        /** @brief Record the time elapsed since @p start */
+        void record_since(std::chrono::steady_clock::time_point start)
+        {
+            record(std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+        }
+
+        /** @brief Percentiles over every sample recorded so far */
+        Summary summary() const;
+
+        /** @brief Percentiles over the samples recorded since the previous interval() call */
+        Summary interval();
+
+        /** @brief Upper bound of bucket @p index in microseconds */
+        static int64_t bucket_upper_us(size_t index);
+
+        /** @brief Cumulative count of bucket @p index */
+        uint64_t bucket_count(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+
+        /** @brief Sum of all samples in microseconds */
+        uint64_t sum_us() const { return sum_us_.load(std::memory_order_relaxed); }
+
+    private:
+        using Counts = std::array<uint64_t, kBucketCount>;
+
+        static size_t bucket_index(int64_t us);
+        static Summary summarize(const Counts &counts);
+        Counts load_counts() const;
+
+        std::array<std::atomic<uint64_t>, kBucketCount> buckets_{};
+        std::atomic<uint64_t> sum_us_{0};
+
+        std::mutex interval_mutex_;
+        Counts last_interval_{}; ///< Snapshot at the previous interval() call
+    };
+
+} // namespace ist
@@ -8,27 +8,34 @@
  *            All rights reserved. Internal use only.
  *
  * Entry point for the IST WebRTC Camera Server. Initializes GStreamer,
- * loads configuration, starts camera pipelines and signaling server,
+ * loads configuration, starts camera pipelines (in parallel) and the signaling server,
  * runs a health monitoring watchdog, and handles graceful shutdown
  * with timeout protection.
  */
 
 #include "config.h"
+#include "bus_reactor.h"
 #include "camera_pipeline.h"
 #include "signaling_server.h"
 #include "peer_manager.h"
+#include "metrics_server.h"
+#include "relay_client.h"
+#include "recorder.h"
+#include "thread_placement.h"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/rotating_file_sink.h>
 #include <gst/gst.h>
 
+#include <algorithm>
 #include <csignal>
 #include <atomic>
 #include <thread>
 #include <chrono>
 #include <iostream>
 #include <string>
+#include <vector>
 #include <getopt.h>
 
 static std::atomic<bool> g_running{true};
@@ -50,6 +57,169 @@ static void signal_handler(int sig)
     }
 }
 
+/// Milliseconds elapsed since @p start
+static int64_t elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+/// Camera and pipeline metric families for one /metrics scrape
+static void write_camera_metrics(ist::MetricsText &out,
+                                 const std::vector<std::unique_ptr<ist::CameraPipeline>> &cameras)
+{
+    using Labels = ist::MetricsText::Labels;
+
+    auto each_camera = [&cameras](const auto &fn)
+    {
+        for (const auto &cam : cameras)
+            fn(Labels{{"camera", cam->id()}}, *cam);
+    };
+    auto each_layer = [&cameras](const auto &fn)
+    {
+        for (const auto &cam : cameras)
+            for (size_t l = 0; l < cam->layer_count(); l++)
+                fn(Labels{{"camera", cam->id()}, {"layer", cam->layer_info(l).name}}, *cam, l);
+    };
+
+    out.family("ist_camera_running", "gauge", "1 while the camera pipeline exists");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_running", labels, cam.is_running() ? 1 : 0); });
+
+    out.family("ist_camera_idle", "gauge", "1 while an on-demand pipeline is parked");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_idle", labels, cam.is_idle() ? 1 : 0); });
+
+    out.family("ist_camera_restarts_total", "counter", "Pipeline restarts after errors, EOS or stalls");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_restarts_total", labels, cam.restart_count()); });
+
+    out.family("ist_camera_source_restarts_total", "counter", "Restarts that replaced only the source bin");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_source_restarts_total", labels, cam.source_restart_count()); });
+
+    out.family("ist_camera_stalls_total", "counter", "Frame stalls detected by the watchdog (each restarts the pipeline)");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_stalls_total", labels, static_cast<double>(cam.stall_count())); });
+
+    out.family("ist_camera_last_recovery_seconds", "gauge", "Failure to first frame of the last recovery (negative = none yet)");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_last_recovery_seconds", labels, cam.last_recovery_ms() / 1000.0); });
+
+    out.family("ist_camera_recovery_seconds", "histogram", "Failure (error, EOS or stall) to first frame after restart");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.histogram("ist_camera_recovery_seconds", labels, cam.recovery_time()); });
+
+    out.family("ist_camera_seconds_since_last_frame", "gauge", "Age of the newest full-quality frame");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_seconds_since_last_frame", labels, cam.seconds_since_last_frame()); });
+
+    out.family("ist_camera_keyframe_requests_total", "counter", "Encoder IDRs forced by viewer PLI/FIR");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_keyframe_requests_total", labels, static_cast<double>(cam.keyframe_requests())); });
+
+    out.family("ist_camera_last_launch_seconds", "gauge", "Duration of the last full launch (probe, build, state change)");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_last_launch_seconds", labels, cam.last_launch_ms() / 1000.0); });
+
+    out.family("ist_camera_last_start_seconds", "gauge", "Duration of the last pipeline start state change");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_last_start_seconds", labels, cam.last_start_ms() / 1000.0); });
+
+    out.family("ist_camera_last_warmup_seconds", "gauge", "Start to first frame of the last pipeline start");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_camera_last_warmup_seconds", labels, cam.last_warmup_ms() / 1000.0); });
+
+    out.family("ist_camera_frames_total", "counter", "Encoded frames received from the appsink");
+    each_layer([&](const Labels &labels, ist::CameraPipeline &cam, size_t l)
+               { out.sample("ist_camera_frames_total", labels, static_cast<double>(cam.layer_counters(l).frames)); });
+
+    out.family("ist_camera_bytes_total", "counter", "Encoded bytes received from the appsink");
+    each_layer([&](const Labels &labels, ist::CameraPipeline &cam, size_t l)
+               { out.sample("ist_camera_bytes_total", labels, static_cast<double>(cam.layer_counters(l).bytes)); });
+
+    out.family("ist_camera_keyframes_total", "counter", "IDR frames received from the appsink");
+    each_layer([&](const Labels &labels, ist::CameraPipeline &cam, size_t l)
+               { out.sample("ist_camera_keyframes_total", labels, static_cast<double>(cam.layer_counters(l).keyframes)); });
+
+    out.family("ist_camera_keyframe_interval_seconds", "gauge", "Time between the last two IDR frames");
+    each_layer([&](const Labels &labels, ist::CameraPipeline &cam, size_t l)
+               { out.sample("ist_camera_keyframe_interval_seconds", labels, cam.layer_counters(l).keyframe_interval_s); });
+
+    out.family("ist_camera_encoder_bitrate_kbps", "gauge", "Current encoder target bitrate (0 = passthrough)");
+    each_layer([&](const Labels &labels, ist::CameraPipeline &cam, size_t l)
+               { out.sample("ist_camera_encoder_bitrate_kbps", labels, cam.bitrate_kbps(l)); });
+
+    out.family("ist_camera_capture_latency_seconds", "histogram", "Capture to appsink (source, convert, encode)");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.histogram("ist_camera_capture_latency_seconds", labels, cam.capture_latency()); });
+
+    out.family("ist_buffer_pool_in_use_bytes", "gauge", "Pooled packet/frame buffer capacity held by in-flight batches");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_buffer_pool_in_use_bytes", labels, static_cast<double>(cam.buffer_pool()->stats().in_use_bytes)); });
+
+    out.family("ist_buffer_pool_high_water_bytes", "gauge", "Highest in-use pooled buffer capacity since start");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_buffer_pool_high_water_bytes", labels, static_cast<double>(cam.buffer_pool()->stats().high_water_bytes)); });
+
+    out.family("ist_buffer_pool_free_bytes", "gauge", "Free pooled buffer capacity retained for reuse");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_buffer_pool_free_bytes", labels, static_cast<double>(cam.buffer_pool()->stats().free_bytes)); });
+
+    out.family("ist_buffer_pool_acquires_total", "counter", "Pooled buffers handed out");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_buffer_pool_acquires_total", labels, static_cast<double>(cam.buffer_pool()->stats().acquires)); });
+
+    out.family("ist_buffer_pool_heap_allocations_total", "counter", "Pooled buffer requests that had to allocate (flat once warm)");
+    each_camera([&](const Labels &labels, ist::CameraPipeline &cam)
+                { out.sample("ist_buffer_pool_heap_allocations_total", labels, static_cast<double>(cam.buffer_pool()->stats().heap_allocations)); });
+}
+
+/// Relay (edge) metric families for one /metrics scrape; nothing without RELAY cameras
+static void write_relay_metrics(ist::MetricsText &out,
+                                const std::vector<std::shared_ptr<ist::RelayClient>> &relays)
+{
+    if (relays.empty())
+        return;
+
+    out.family("ist_relay_connected", "gauge", "1 while the PeerConnection to the origin is connected");
+    for (const auto &relay : relays)
+        out.sample("ist_relay_connected", {{"origin", relay->origin_url()}}, relay->connected() ? 1.0 : 0.0);
+
+    out.family("ist_relay_reconnects_total", "counter", "Connection attempts to the origin after the first");
+    for (const auto &relay : relays)
+        out.sample("ist_relay_reconnects_total", {{"origin", relay->origin_url()}}, static_cast<double>(relay->reconnects()));
+
+    out.family("ist_relay_frames_received_total", "counter", "Access units received from the origin");
+    for (const auto &relay : relays)
+        out.sample("ist_relay_frames_received_total", {{"origin", relay->origin_url()}}, static_cast<double>(relay->frames_received()));
+}
+
+/// Recording metric families for one /metrics scrape; nothing while recording is off
+static void write_recorder_metrics(ist::MetricsText &out,
+                                   const std::vector<std::unique_ptr<ist::Recorder>> &recorders)
+{
+    if (recorders.empty())
+        return;
+
+    out.family("ist_recorder_frames_total", "counter", "Frames queued for writing to disk");
+    for (const auto &rec : recorders)
+        out.sample("ist_recorder_frames_total", {{"camera", rec->camera_id()}}, static_cast<double>(rec->frames_written()));
+
+    out.family("ist_recorder_dropped_frames_total", "counter", "Frames not recorded because the disk fell behind");
+    for (const auto &rec : recorders)
+        out.sample("ist_recorder_dropped_frames_total", {{"camera", rec->camera_id()}}, static_cast<double>(rec->frames_dropped()));
+
+    out.family("ist_recorder_segments_total", "counter", "Recording segments completed");
+    for (const auto &rec : recorders)
+        out.sample("ist_recorder_segments_total", {{"camera", rec->camera_id()}}, static_cast<double>(rec->segments_closed()));
+
+    out.family("ist_recorder_errors_total", "counter", "Recording pipeline errors (each rebuilds the recorder)");
+    for (const auto &rec : recorders)
+        out.sample("ist_recorder_errors_total", {{"camera", rec->camera_id()}}, static_cast<double>(rec->errors()));
+}
+
 static void print_usage(const char *program)
 {
     std::cerr << "IST WebRTC Camera Server\n"
@@ -152,21 +322,64 @@ int main(int argc, char *argv[])
             case ist::CameraType::TEST:
                 type_str = "TEST";
                 break;
+            case ist::CameraType::RELAY:
+                type_str = "RELAY";
+                break;
             }
             spdlog::info("  Camera [{}] '{}' type={} uri={} {}x{}@{}fps",
                          cam.id, cam.name, type_str, cam.uri,
                          cam.width, cam.height, cam.fps);
         }
 
+        // Before any thread exists: everything spawned from here inherits
+        // the control placement, cameras and send workers re-place themselves
+        ist::init_thread_placement(config);
+
+        // One event loop watches every pipeline bus and runs recovery timers
+        ist::BusReactor reactor;
+
         // Create camera pipelines
         std::vector<std::unique_ptr<ist::CameraPipeline>> cameras;
         for (const auto &cam_cfg : config.cameras)
         {
-            cameras.push_back(std::make_unique<ist::CameraPipeline>(cam_cfg));
+            cameras.push_back(std::make_unique<ist::CameraPipeline>(cam_cfg, reactor));
         }
 
         // Create peer manager
-        ist::PeerManager peer_manager(config, cameras);
+        ist::PeerManager peer_manager(config, cameras, reactor);
+
+        // Relay (edge) mode: one receive-only client per origin feeds its
+        // RELAY cameras; connected once the pipelines are up
+        std::vector<std::shared_ptr<ist::RelayClient>> relays;
+        {
+            std::vector<std::pair<std::string, std::vector<ist::CameraPipeline *>>> origins;
+            for (auto &camera : cameras)
+            {
+                if (camera->config().type != ist::CameraType::RELAY)
+                    continue;
+                auto origin = std::find_if(origins.begin(), origins.end(),
+                                           [&camera](const auto &entry)
+                                           { return entry.first == camera->config().uri; });
+                if (origin == origins.end())
+                    origin = origins.insert(origins.end(), {camera->config().uri, {}});
+                origin->second.push_back(camera.get());
+            }
+            for (auto &[url, relayed] : origins)
+                relays.push_back(ist::RelayClient::create(url, std::move(relayed), reactor));
+        }
+
+        // Disk recording: one more subscriber per recorded camera, started
+        // once the pipelines are up
+        std::vector<std::unique_ptr<ist::Recorder>> recorders;
+        if (config.recording.enabled)
+        {
+            const auto &ids = config.recording.cameras;
+            for (auto &camera : cameras)
+            {
+                if (ids.empty() || std::find(ids.begin(), ids.end(), camera->id()) != ids.end())
+                    recorders.push_back(std::make_unique<ist::Recorder>(config.recording, *camera, reactor));
+            }
+        }
 
         // Create signaling server
         ist::SignalingServer signaling(config);
@@ -175,6 +388,9 @@ int main(int argc, char *argv[])
                                                     std::shared_ptr<rtc::WebSocket> ws)
                                     { peer_manager.create_peer(client_id, ws); });
 
+        signaling.on_client_open([&peer_manager](const std::string &client_id)
+                                 { peer_manager.open_session(client_id); });
+
         signaling.on_client_disconnect([&peer_manager](const std::string &client_id)
                                        { peer_manager.remove_peer(client_id); });
 
@@ -186,19 +402,64 @@ int main(int argc, char *argv[])
             return 1;
         }
 
-        // Start camera pipelines
+        // Prometheus endpoint (replaces the detailed periodic log lines)
+        std::atomic<int64_t> cameras_start_ms{-1};
+        std::unique_ptr<ist::MetricsServer> metrics;
+        if (config.server.metrics_port > 0)
+        {
+            metrics = std::make_unique<ist::MetricsServer>(
+                config.server.bind, config.server.metrics_port,
+                [&cameras, &peer_manager, &relays, &recorders, &cameras_start_ms](ist::MetricsText &out)
+                {
+                    out.family("ist_cameras_start_seconds", "gauge", "Wall time to start every camera at boot (negative = in progress)");
+                    out.sample("ist_cameras_start_seconds", {}, cameras_start_ms.load() / 1000.0);
+                    write_camera_metrics(out, cameras);
+                    write_relay_metrics(out, relays);
+                    write_recorder_metrics(out, recorders);
+                    peer_manager.write_metrics(out);
+                });
+            if (!metrics->start())
+            {
+                spdlog::warn("Metrics endpoint disabled");
+                metrics.reset();
+            }
+        }
+
+        // Start camera pipelines concurrently: device probing, RTSP connect
+        // and state changes overlap, so cold start is bounded by the slowest
+        // camera instead of the sum
+        auto start_t0 = std::chrono::steady_clock::now();
+        std::vector<char> start_ok(cameras.size(), 0);
+        std::vector<int64_t> start_ms(cameras.size(), 0);
+        {
+            std::vector<std::thread> starters;
+            for (size_t i = 0; i < cameras.size(); i++)
+            {
+                starters.emplace_back([&, i]()
+                                      {
+                    auto t0 = std::chrono::steady_clock::now();
+                    start_ok[i] = cameras[i]->start();
+                    start_ms[i] = elapsed_ms(t0); });
+            }
+            for (auto &starter : starters)
+                starter.join();
+        }
+        cameras_start_ms.store(elapsed_ms(start_t0));
+
         int started = 0;
-        for (auto &camera : cameras)
+        for (size_t i = 0; i < cameras.size(); i++)
         {
-            if (camera->start())
+            if (start_ok[i])
             {
                 started++;
+                spdlog::info("  Camera [{}] started in {} ms", cameras[i]->id(), start_ms[i]);
             }
             else
             {
-                spdlog::error("Failed to start camera: {}", camera->id());
+                spdlog::error("Failed to start camera: {} (after {} ms)", cameras[i]->id(), start_ms[i]);
             }
         }
+        spdlog::info("Cameras started in {} ms ({} in parallel)", cameras_start_ms.load(), cameras.size());
 
         if (started == 0)
         {
@@ -207,6 +468,43 @@ int main(int argc, char *argv[])
             return 1;
         }
 
+        for (auto &relay : relays)
+            relay->start();
+
+        for (auto &recorder : recorders)
+        {
+            if (!recorder->start())
+                spdlog::error("[{}] Recording disabled for this camera", recorder->camera_id());
+        }
+
+        // Cameras started together emit their first IDRs together and would
+        // keep doing so every GOP; force one extra keyframe per encoder
+        // camera at staggered offsets so the periodic IDRs spread over a GOP
+        std::vector<unsigned> stagger_timers;
+        if (config.webrtc.stagger_keyframes)
+        {
+            std::vector<ist::CameraPipeline *> encoded;
+            for (size_t i = 0; i < cameras.size(); i++)
+                if (start_ok[i] && !cameras[i]->passthrough())
+                    encoded.push_back(cameras[i].get());
+
+            for (size_t i = 1; i < encoded.size(); i++)
+            {
+                const auto &cfg = encoded[i]->config();
+                int fps = std::max(1, cfg.fps);
+                int gop = cfg.keyframe_interval > 0 ? cfg.keyframe_interval : 2 * fps;
+                auto offset_ms = static_cast<unsigned>(int64_t(gop) * 1000 / fps * int64_t(i) / int64_t(encoded.size()));
+                ist::CameraPipeline *camera = encoded[i];
+                stagger_timers.push_back(reactor.add_timer(std::max(1u, offset_ms), [camera]()
+                                                           {
+                    for (size_t layer = 0; layer < camera->layer_count(); layer++)
+                        camera->request_keyframe(layer);
+                    return false; }));
+            }
+        }
+
+        ist::log_thread_report();
+
         spdlog::info("------------------------------------------");
         spdlog::info("  Server is running!");
         spdlog::info("  Signaling:  ws://{}:{}", config.server.bind, config.server.port);
@@ -214,9 +512,9 @@ int main(int argc, char *argv[])
         spdlog::info("  Max clients: {}", config.webrtc.max_clients);
         spdlog::info("------------------------------------------");
 
-        // Main loop — health monitoring & watchdog
+        // Main loop — periodic health summary (stalls are detected and
+        // restarted by each camera's own watchdog within about a second)
         auto last_status_log = std::chrono::steady_clock::now();
-        constexpr double kStallThresholdSeconds = 10.0;
 
         while (g_running.load())
         {
@@ -232,19 +530,25 @@ int main(int argc, char *argv[])
             {
                 last_status_log = now;
 
-                int active = 0, stalled = 0;
+                int active = 0, stalled = 0, idle = 0;
                 for (const auto &cam : cameras)
                 {
-                    if (cam->is_running())
+                    if (cam->is_running() && cam->is_idle())
+                    {
+                        // Parked on-demand pipeline — no frames expected
+                        idle++;
+                    }
+                    else if (cam->is_running())
                     {
                         active++;
                         double since_last = cam->seconds_since_last_frame();
-                        if (since_last > kStallThresholdSeconds)
+                        double threshold = std::chrono::duration<double>(cam->stall_threshold()).count();
+                        if (since_last > threshold)
                         {
                             stalled++;
-                            spdlog::warn("[{}] STALLED — no frames for {:.1f}s (total: {}, restarts: {})",
+                            spdlog::warn("[{}] STALLED — no frames for {:.1f}s (total: {}, restarts: {}, stalls: {})",
                                          cam->id(), since_last,
-                                         cam->frame_count(), cam->restart_count());
+                                         cam->frame_count(), cam->restart_count(), cam->stall_count());
                         }
                     }
                     else
@@ -255,17 +559,27 @@ int main(int argc, char *argv[])
                     }
                 }
 
-                spdlog::info("[Health] Cameras: {}/{} active, {} stalled | Clients: {} | Uptime: {}s",
-                             active, cameras.size(), stalled,
+                spdlog::info("[Health] Cameras: {}/{} active, {} idle, {} stalled | Clients: {} | Uptime: {}s",
+                             active, cameras.size(), idle, stalled,
                              peer_manager.peer_count(), elapsed_s);
 
+                // Detailed stats live on /metrics; log them only without it
+                if (metrics)
+                    continue;
+
+                // Per-stage latency over the last interval
+                peer_manager.log_latency_stats();
+
                 // Per-camera frame stats
                 for (const auto &cam : cameras)
                 {
-                    spdlog::debug("[{}] frames={}, last_frame={:.1f}s ago, restarts={}",
+                    spdlog::debug("[{}] frames={}, last_frame={:.1f}s ago, restarts={}, idle={}, "
+                                  "start={}ms, stop={}ms, warmup={}ms",
                                   cam->id(), cam->frame_count(),
                                   cam->seconds_since_last_frame(),
-                                  cam->restart_count());
+                                  cam->restart_count(), cam->is_idle(),
+                                  cam->last_start_ms(), cam->last_stop_ms(),
+                                  cam->last_warmup_ms());
                 }
             }
         }
@@ -273,16 +587,40 @@ int main(int argc, char *argv[])
         // Graceful shutdown with timeout
         spdlog::info("Shutting down...");
 
+        reactor.run_sync([&]()
+                         {
+            for (unsigned id : stagger_timers)
+                reactor.remove(id); });
+
         // Run shutdown in a thread with timeout
         std::atomic<bool> shutdown_done{false};
         std::thread shutdown_thread([&]()
                                     {
-            // Stop cameras first
-            for (auto& camera : cameras) {
-                camera->stop();
+            // Relays first, so no origin frames arrive during teardown
+            for (auto &relay : relays)
+                relay->stop();
+
+            // Close the open segments while the cameras still run
+            for (auto &recorder : recorders)
+                recorder->stop();
+
+            // Stop cameras first, all at once: each teardown may wait up to
+            // 3 s for NULL, so the deadline below covers the slowest camera
+            // rather than the sum
+            auto stop_t0 = std::chrono::steady_clock::now();
+            {
+                std::vector<std::thread> stoppers;
+                for (auto &camera : cameras)
+                    stoppers.emplace_back([&camera]() { camera->stop(); });
+                for (auto &stopper : stoppers)
+                    stopper.join();
             }
+            spdlog::info("Cameras stopped in {} ms", elapsed_ms(stop_t0));
+
             // Stop signaling (disconnects clients)
             signaling.stop();
+            if (metrics)
+                metrics->stop();
             shutdown_done.store(true); });
 
         // Wait up to 5 seconds for graceful shutdown
@@ -0,0 +1,262 @@
+/**
+ * @file    metrics_server.cpp
+ * @brief   Prometheus metrics endpoint implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "metrics_server.h"
+#include <spdlog/spdlog.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace ist
+{
+
+    // ==================== MetricsText ====================
+
+    void MetricsText::family(const std::string &name, const char *type, const char *help)
+    {
+        out_ += fmt::format("# HELP {} {}\n# TYPE {} {}\n", name, help, name, type);
+    }
+
+    void MetricsText::write_labels(const Labels &labels, const char *extra_name,
+                                   const std::string &extra_value)
+    {
+        if (labels.empty() && !extra_name)
+            return;
+
+        auto append = [this](const std::string &key, const std::string &value, bool first)
+        {
+            if (!first)
+                out_ += ',';
+            out_ += key;
+            out_ += "=\"";
+            for (char c : value)
+            {
+                if (c == '\\' || c == '"')
+                    out_ += '\\';
+                if (c == '\n')
+                {
+                    out_ += "\\n";
+                    continue;
+                }
+                out_ += c;
+            }
+            out_ += '"';
+        };
+
+        out_ += '{';
+        bool first = true;
+        for (const auto &[key, value] : labels)
+        {
+            append(key, value, first);
+            first = false;
+        }
+        if (extra_name)
+            append(extra_name, extra_value, first);
+        out_ += '}';
+    }
+
+    void MetricsText::sample(const std::string &name, const Labels &labels, double value)
+    {
+        out_ += name;
+        write_labels(labels);
+        out_ += fmt::format(" {}\n", value);
+    }
+
+    void MetricsText::histogram(const std::string &name, const Labels &labels, const LatencyHistogram &hist)
+    {
+        // Every power of two from 2^8 µs up is an upper bucket edge of
+        // LatencyHistogram, so the cumulative counts below are exact
+        constexpr int kFirstExponent = 8;  // 256 µs
+        constexpr int kLastExponent = 24;  // ~16.8 s
+
+        uint64_t cumulative = 0;
+        size_t index = 0;
+        for (int exponent = kFirstExponent; exponent <= kLastExponent; exponent++)
+        {
+            const int64_t bound_us = int64_t(1) << exponent;
+            for (; index < LatencyHistogram::kBucketCount &&
+                   LatencyHistogram::bucket_upper_us(index) <= bound_us;
+                 index++)
+                cumulative += hist.bucket_count(index);
+
+            out_ += name;
+            out_ += "_bucket";
+            write_labels(labels, "le", fmt::format("{}", static_cast<double>(bound_us) / 1e6));
+            out_ += fmt::format(" {}\n", cumulative);
+        }
+        for (; index < LatencyHistogram::kBucketCount; index++)
+            cumulative += hist.bucket_count(index);
+
+        out_ += name;
+        out_ += "_bucket";
+        write_labels(labels, "le", "+Inf");
+        out_ += fmt::format(" {}\n", cumulative);
+
+        out_ += name;
+        out_ += "_sum";
+        write_labels(labels);
+        out_ += fmt::format(" {}\n", static_cast<double>(hist.sum_us()) / 1e6);
+
+        out_ += name;
+        out_ += "_count";
+        write_labels(labels);
+        out_ += fmt::format(" {}\n", cumulative);
+    }
+
+    // ==================== MetricsServer ====================
+
+    MetricsServer::MetricsServer(std::string bind, int port, Collector collector)
+        : bind_(std::move(bind)), port_(port), collector_(std::move(collector))
+    {
+    }
+
+    MetricsServer::~MetricsServer()
+    {
+        stop();
+    }
+
+    bool MetricsServer::start()
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port_));
+        if (inet_pton(AF_INET, bind_.c_str(), &addr.sin_addr) != 1)
+        {
+            spdlog::error("Metrics server: invalid bind address '{}'", bind_);
+            return false;
+        }
+
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0)
+        {
+            spdlog::error("Metrics server: socket() failed: {}", std::strerror(errno));
+            return false;
+        }
+
+        int reuse = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+            ::listen(listen_fd_, 8) < 0)
+        {
+            spdlog::error("Metrics server: cannot listen on {}:{}: {}", bind_, port_, std::strerror(errno));
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+            return false;
+        }
+
+        running_.store(true);
+        thread_ = std::thread(&MetricsServer::serve_thread, this);
+        spdlog::info("Metrics endpoint on http://{}:{}/metrics", bind_, port_);
+        return true;
+    }
+
+    void MetricsServer::stop()
+    {
+        if (!running_.exchange(false))
+            return;
+
+        if (thread_.joinable())
+            thread_.join();
+        if (listen_fd_ >= 0)
+        {
+            ::close(listen_fd_);
+            listen_fd_ = -1;
+        }
+    }
+
+    void MetricsServer::serve_thread()
+    {
+        while (running_.load())
+        {
+            pollfd pfd{listen_fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, kPollIntervalMs) <= 0)
+                continue;
+
+            int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue;
+
+            timeval tv{kClientTimeoutMs / 1000, (kClientTimeoutMs % 1000) * 1000};
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+            try
+            {
+                handle_client(fd);
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::warn("Metrics server: scrape failed: {}", e.what());
+            }
+            ::close(fd);
+        }
+    }
+
+    void MetricsServer::handle_client(int fd)
+    {
+        // Read up to the end of the request headers
+        std::string request;
+        char buf[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < kMaxRequestBytes)
+        {
+            ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0)
+                return;
+            request.append(buf, static_cast<size_t>(n));
+        }
+
+        std::string status = "200 OK";
+        std::string body;
+        const bool is_get = request.compare(0, 4, "GET ") == 0;
+        const size_t path_end = request.find_first_of(" ?", 4);
+        const std::string path = is_get ? request.substr(4, path_end - 4) : "";
+
+        if (!is_get)
+        {
+            status = "405 Method Not Allowed";
+            body = "Only GET is supported\n";
+        }
+        else if (path == "/metrics")
+        {
+            MetricsText text;
+            collector_(text);
+            body = text.str();
+        }
+        else
+        {
+            status = "404 Not Found";
+            body = "Try /metrics\n";
+        }
+
+        std::string response = fmt::format("HTTP/1.0 {}\r\n"
+                                           "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                           "Content-Length: {}\r\n"
+                                           "Connection: close\r\n\r\n",
+                                           status, body.size());
+        response += body;
+
+        size_t sent = 0;
+        while (sent < response.size())
+        {
+            ssize_t n = ::send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                return;
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+} // namespace ist
@@ -0,0 +1,121 @@
+/**
+ * @file    metrics_server.h
+ * @brief   Prometheus text exposition and a minimal HTTP endpoint for it
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Serves GET /metrics in the Prometheus text format (version 0.0.4) on a
+ * dedicated port. Metrics are gathered only when scraped: the collector
+ * reads the relaxed atomic counters kept by the pipelines, fan-outs and
+ * send queues, so the frame path never takes a lock for observability.
+ */
+
+#pragma once
+
+#include "latency_histogram.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Builder for one Prometheus text exposition
+     *
+     * Declare each metric family once with family(), then add its samples
+     * before starting the next family.
+     */
+    class MetricsText
+    {
+    public:
+        /// Label name/value pairs of one sample
+        using Labels = std::vector<std::pair<std::string, std::string>>;
+
+        /**
+         * @brief Start a metric family
+         * @param name  Metric name (e.g. "ist_camera_frames_total")
+         * @param type  "counter", "gauge" or "histogram"
+         * @param help  One-line description
+         */
+        void family(const std::string &name, const char *type, const char *help);
+
+        /** @brief Add one sample to the current family */
+        void sample(const std::string &name, const Labels &labels, double value);
+
+        /**
+         * @brief Add a latency histogram (seconds) to the current family
+         *
+         * Exported with power-of-two bucket bounds from 256 µs to ~16.8 s,
+         * which coincide with LatencyHistogram bucket edges.
+         */
+        void histogram(const std::string &name, const Labels &labels, const LatencyHistogram &hist);
+
+        /** @brief The exposition text built so far */
+        const std::string &str() const { return out_; }
+
+    private:
+        void write_labels(const Labels &labels, const char *extra_name = nullptr,
+                          const std::string &extra_value = {});
+
+        std::string out_;
+    };
+
+    /**
+     * @brief Blocking single-threaded HTTP server for the /metrics endpoint
+     *
+     * Thread Safety:
+     *   - start() and stop() must be called from the same thread
+     *   - The collector runs on the server thread, one scrape at a time
+     */
+    class MetricsServer
+    {
+    public:
+        /// Fills one exposition per scrape
+        using Collector = std::function<void(MetricsText &out)>;
+
+        /**
+         * @param bind       IPv4 bind address (e.g. "0.0.0.0")
+         * @param port       TCP port
+         * @param collector  Called for every GET /metrics
+         */
+        MetricsServer(std::string bind, int port, Collector collector);
+        ~MetricsServer();
+
+        // Non-copyable, non-movable
+        MetricsServer(const MetricsServer &) = delete;
+        MetricsServer &operator=(const MetricsServer &) = delete;
+
+        /** @brief Bind, listen and start the server thread */
+        bool start();
+
+        /** @brief Stop the server thread and close the socket */
+        void stop();
+
+    private:
+        /// Accept loop (polls so stop() takes effect within kPollIntervalMs)
+        void serve_thread();
+
+        /// Read one request and write the response
+        void handle_client(int fd);
+
+        std::string bind_;
+        int port_;
+        Collector collector_;
+
+        int listen_fd_ = -1;
+        std::atomic<bool> running_{false};
+        std::thread thread_;
+
+        static constexpr int kPollIntervalMs = 500;
+        static constexpr int kClientTimeoutMs = 2000;   ///< Per-connection read/write timeout
+        static constexpr size_t kMaxRequestBytes = 8192; ///< Request headers beyond this are rejected
+    };
+
+} // namespace ist
@@ -0,0 +1,85 @@
+/**
+ * @file    pacer.cpp
+ * @brief   Per-peer RTP send pacing implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "pacer.h"
+#include <algorithm>
+
+namespace ist
+{
+
+    RtpPacer::RtpPacer(bool enabled, double spread, int max_kbps)
+        : enabled_(enabled), spread_(std::clamp(spread, 0.0, 1.0)),
+          max_bps_(static_cast<uint64_t>(std::max(0, max_kbps)) * 1000)
+    {
+    }
+
+    void RtpPacer::begin_frame(Frame &frame, size_t packets, std::chrono::microseconds frame_interval,
+                               bool replay, Clock::time_point now) const
+    {
+        if (!enabled_)
+            return;
+
+        // Idle time earns no credit
+        frame.next = std::max(frame.next, now);
+        frame.burst_left = kBurstPackets;
+        frame.gap = std::chrono::nanoseconds(0);
+        if (!replay && packets > kBurstPackets)
+        {
+            auto window = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_interval * spread_);
+            frame.gap = window / static_cast<int64_t>(packets - kBurstPackets);
+        }
+    }
+
+    RtpPacer::Clock::time_point RtpPacer::due(const Frame &frame) const
+    {
+        if (!enabled_)
+            return Clock::time_point::min();
+        return std::max(frame.next, rate_next_);
+    }
+
+    size_t RtpPacer::burst(const Frame &frame, size_t remaining) const
+    {
+        if (!enabled_)
+            return remaining;
+        if (max_bps_ > 0)
+            return std::min<size_t>(1, remaining);
+        if (frame.burst_left > 0)
+            return std::min(frame.burst_left, remaining);
+        return frame.gap.count() == 0 ? remaining : std::min<size_t>(1, remaining);
+    }
+
+    void RtpPacer::sent(Frame &frame, size_t packets, size_t bytes, Clock::time_point start)
+    {
+        if (!enabled_)
+            return;
+
+        // Spacing for the lane's packet after these
+        std::chrono::nanoseconds gap{0};
+        if (frame.burst_left >= packets)
+            frame.burst_left -= packets;
+        else
+        {
+            frame.burst_left = 0;
+            gap = frame.gap;
+        }
+        frame.next = start + gap;
+
+        if (max_bps_ > 0)
+            rate_next_ = std::max(rate_next_, start) + std::chrono::nanoseconds(bytes * 8 * 1000000000ULL / max_bps_);
+    }
+
+    void RtpPacer::add_waited(Clock::duration waited)
+    {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(waited).count();
+        if (us > 0)
+            waited_us_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+    }
+
+} // namespace ist
@@ -0,0 +1,105 @@
+/**
+ * @file    pacer.h
+ * @brief   Per-peer RTP send pacing
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * A 720p IDR is dozens of MTU-sized packets; sent back to back they hit
+ * the Wi-Fi link as one burst and get dropped exactly when the receiver
+ * can least afford it. The pacer spaces the packets of each frame over a
+ * fraction of its frame interval (a few leading packets go out
+ * immediately, so small delta frames are not delayed), and optionally
+ * enforces a per-peer send-rate cap.
+ *
+ * It never sleeps itself: it tells the peer's send worker when the next
+ * packet of each lane is due, and the worker sends whichever lane is due
+ * first. Frames of different cameras are thus spread side by side rather
+ * than one after the other, and the worker never needs more than one
+ * spread window per frame interval however many cameras the peer watches.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace ist
+{
+
+    /**
+     * @brief Packet spacing for one peer
+     *
+     * Thread Safety:
+     *   - Not thread-safe except waited_seconds(); used by the peer's send
+     *     worker under the send queue mutex
+     */
+    class RtpPacer
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr size_t kBurstPackets = 4; ///< Sent unpaced at the start of each frame
+
+        /// Pacing position of the frame a lane is sending
+        struct Frame
+        {
+            Clock::time_point next{};         ///< Earliest time for the lane's next packet
+            std::chrono::nanoseconds gap{0}; ///< Spacing within the frame
+            size_t burst_left = 0;            ///< Unspread packets left in the frame
+        };
+
+        /**
+         * @param enabled   false = every packet is due immediately
+         * @param spread    Fraction of the frame interval a frame is spread over (0-1)
+         * @param max_kbps  Send-rate cap in kbps (0 = no cap)
+         */
+        RtpPacer(bool enabled, double spread, int max_kbps);
+
+        /**
+         * @brief Start pacing a frame on a lane
+         * @param frame           The lane's pacing position
+         * @param packets         Packets that will be sent for it
+         * @param frame_interval  Nominal time until the next frame of the camera
+         * @param replay          Cached catch-up frame: rate cap only, no spreading
+         * @param now             Current time
+         */
+        void begin_frame(Frame &frame, size_t packets, std::chrono::microseconds frame_interval,
+                         bool replay, Clock::time_point now) const;
+
+        /** @brief When the next packet of @p frame may be sent */
+        Clock::time_point due(const Frame &frame) const;
+
+        /** @brief Packets of @p frame that may go out back to back now (1 … @p remaining) */
+        size_t burst(const Frame &frame, size_t remaining) const;
+
+        /**
+         * @brief Account for packets just sent from @p frame
+         * @param frame    The lane's pacing position
+         * @param packets  Packets sent in one go (at most burst())
+         * @param bytes    Bytes they carried
+         * @param start    When sending started
+         */
+        void sent(Frame &frame, size_t packets, size_t bytes, Clock::time_point start);
+
+        /** @brief Add time the send worker idled until a packet was due */
+        void add_waited(Clock::duration waited);
+
+        /** @brief Total time the send worker spent waiting for the pacer */
+        double waited_seconds() const { return waited_us_.load(std::memory_order_relaxed) / 1e6; }
+
+    private:
+        bool enabled_;
+        double spread_;
+        uint64_t max_bps_;
+
+        Clock::time_point rate_next_{}; ///< Earliest time for any packet under the rate cap
+
+        std::atomic<uint64_t> waited_us_{0};
+    };
+
+} // namespace ist
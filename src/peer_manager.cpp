@@ -16,30 +16,81 @@ namespace ist
 {
 
     PeerManager::PeerManager(const AppConfig &config,
-                             std::vector<std::unique_ptr<CameraPipeline>> &cameras)
-        : config_(config), cameras_(cameras)
+                             std::vector<std::unique_ptr<CameraPipeline>> &cameras,
+                             BusReactor &reactor)
+        : config_(config), cameras_(cameras), reactor_(reactor),
+          budgets_kbps_(cameras.size()),
+          workers_(static_cast<size_t>(std::max(1, config.webrtc.signaling_workers)))
     {
-    }
+        // One shared packetization stage per camera layer
+        fanouts_.resize(cameras_.size());
+        for (size_t i = 0; i < cameras_.size(); i++)
+        {
+            for (size_t layer = 0; layer < cameras_[i]->layer_count(); layer++)
+            {
+                fanouts_[i].push_back(std::make_unique<RtpFanout>(
+                    i, *cameras_[i], layer,
+                    static_cast<size_t>(config_.webrtc.nack_buffer_kb) * 1024,
+                    config_.webrtc.fec == FecMode::ULPFEC ? static_cast<size_t>(config_.webrtc.fec_group) : 0));
+            }
+        }
 
-    PeerManager::~PeerManager()
-    {
-        std::lock_guard<std::mutex> lock(peers_mutex_);
-        for (auto &[id, ctx] : peers_)
+        // The m-line of a camera is identical for every peer (SSRC and
+        // payload type come from the shared fan-out), so build it once
+        for (size_t i = 0; i < cameras_.size(); i++)
         {
-            // Unregister all frame callbacks
-            for (auto &[cam_idx, cb_id] : ctx->callback_ids)
+            const std::string &cam_id = cameras_[i]->id();
+            rtc::Description::Video media(cam_id, rtc::Description::Direction::SendOnly);
+
+            // Every codec the camera's layers carry, configured codec first;
+            // the browser keeps the ones it decodes (apply_codec_negotiation)
+            std::vector<VideoCodec> offered;
+            for (const auto &fanout : fanouts_[i])
             {
-                if (cam_idx < cameras_.size())
-                {
-                    cameras_[cam_idx]->remove_callback(cb_id);
-                }
+                if (std::find(offered.begin(), offered.end(), fanout->codec()) != offered.end())
+                    continue;
+                offered.push_back(fanout->codec());
+                if (fanout->codec() == VideoCodec::H265)
+                    media.addH265Codec(fanout->payload_type(), std::string("profile-id=1"));
+                else if (fanout->codec() == VideoCodec::AV1)
+                    media.addAV1Codec(fanout->payload_type(), std::string("profile=0"));
+                else
+                    media.addH264Codec(fanout->payload_type());
             }
-            if (ctx->peer)
+            if (config_.webrtc.fec == FecMode::ULPFEC)
             {
-                ctx->peer->close();
+                media.addVideoCodec(RtpFanout::kRedPayloadType, "red");
+                media.addVideoCodec(RtpFanout::kUlpfecPayloadType, "ulpfec");
             }
+            media.addSSRC(fanouts_[i].front()->ssrc(), cam_id);
+            media_templates_.push_back(std::move(media));
+        }
+    }
+
+    PeerManager::~PeerManager()
+    {
+        // Finish queued negotiations and teardowns before the state they use goes
+        workers_.stop();
+
+        std::unordered_map<std::string, std::shared_ptr<PeerContext>> peers;
+        {
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            peers.swap(peers_);
         }
-        peers_.clear();
+        for (auto &[id, ctx] : peers)
+        {
+            close_peer(*ctx);
+        }
+    }
+
+    std::vector<std::shared_ptr<PeerContext>> PeerManager::snapshot_peers() const
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex_);
+        std::vector<std::shared_ptr<PeerContext>> peers;
+        peers.reserve(peers_.size());
+        for (const auto &[id, ctx] : peers_)
+            peers.push_back(ctx);
+        return peers;
     }
 
     void PeerManager::create_peer(const std::string &client_id, std::shared_ptr<rtc::WebSocket> ws)
@@ -50,6 +101,22 @@ namespace ist
         ctx->client_id = client_id;
         ctx->ws = ws;
         ctx->start_time = std::chrono::steady_clock::now();
+        ctx->send_queue = std::make_shared<PeerSendQueue>(
+            client_id, static_cast<size_t>(std::max(1, config_.webrtc.send_queue_depth)),
+            config_.webrtc.pacer, config_.webrtc.pacer_spread, config_.webrtc.pacer_max_kbps,
+            config_.threads.send);
+
+        // Bandwidth estimate starts at what the peer's cameras are configured for
+        uint64_t initial_bps = 0, min_bps = 0, max_bps = 0;
+        for (const auto &camera : cameras_)
+        {
+            initial_bps += uint64_t(camera->config().bitrate) * 1000;
+            min_bps += uint64_t(camera->min_bitrate_kbps(camera->last_layer(camera->codec()))) * 1000;
+            max_bps += uint64_t(camera->max_bitrate_kbps()) * 1000;
+        }
+        auto to_u32 = [](uint64_t v)
+        { return static_cast<uint32_t>(std::min<uint64_t>(v, UINT32_MAX)); };
+        ctx->bwe = std::make_shared<BandwidthEstimator>(to_u32(initial_bps), to_u32(min_bps), to_u32(max_bps));
 
         // Configure PeerConnection
         rtc::Configuration rtc_config;
@@ -67,53 +134,101 @@ namespace ist
         }
         rtc_config.disableAutoNegotiation = true;
 
+        // Fast connect: every peer's ICE agent shares one UDP socket, so the
+        // host candidates are the same for all peers and gathering does not
+        // bind a new port per connection
+        const bool fast = config_.webrtc.fast_connect;
+        const int batch_ms = fast ? config_.webrtc.candidate_batch_ms : 0;
+        rtc_config.enableIceUdpMux = fast;
+
         ctx->peer = std::make_shared<rtc::PeerConnection>(rtc_config);
 
-        // ICE state change
-        ctx->peer->onStateChange([client_id](rtc::PeerConnection::State state)
-                                 { spdlog::info("[{}] PeerConnection state: {}", client_id, static_cast<int>(state)); });
+        // ICE state change; connected = setup time from the WebSocket connect
+        ctx->peer->onStateChange([this, client_id, start = ctx->start_time](rtc::PeerConnection::State state)
+                                 {
+        spdlog::info("[{}] PeerConnection state: {}", client_id, static_cast<int>(state));
+        if (state == rtc::PeerConnection::State::Connected) {
+            setup_latency_.record_since(start);
+            spdlog::info("[{}] Connected {} ms after WebSocket connect", client_id,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start).count());
+        } });
 
-        ctx->peer->onGatheringStateChange([client_id, ws_weak = std::weak_ptr(ws)](rtc::PeerConnection::GatheringState state)
+        ctx->send_queue->on_first_frame([this, client_id, start = ctx->start_time]()
+                                        {
+            first_frame_latency_.record_since(start);
+            spdlog::info("[{}] First frame sent {} ms after WebSocket connect", client_id,
+                         std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start).count()); });
+
+        ctx->peer->onGatheringStateChange([client_id, ctx_weak = std::weak_ptr(ctx)](rtc::PeerConnection::GatheringState state)
                                           {
         spdlog::debug("[{}] Gathering state: {}", client_id, static_cast<int>(state));
         
-        // Send end-of-candidates when gathering complete
+        // Flush the batch, then send end-of-candidates when gathering complete
         if (state == rtc::PeerConnection::GatheringState::Complete) {
-            if (auto ws = ws_weak.lock()) {
+            if (auto ctx = ctx_weak.lock()) {
+                std::lock_guard<std::mutex> lock(ctx->candidates_mutex);
+                flush_candidates(*ctx);
+
                 json msg;
                 msg["type"] = "candidate";
                 msg["candidate"] = nullptr;  // null = end of candidates
                 try {
-                    ws->send(msg.dump());
+                    ctx->ws->send(msg.dump());
                 } catch (...) {}
             }
         } });
 
-        // ICE candidate
-        ctx->peer->onLocalCandidate([client_id, ws_weak = std::weak_ptr(ws)](rtc::Candidate candidate)
+        // ICE candidate: trickled one by one, or batched for batch_ms so a
+        // burst of host candidates costs one signaling message
+        ctx->peer->onLocalCandidate([client_id, batch_ms, &reactor = reactor_,
+                                     ctx_weak = std::weak_ptr(ctx)](rtc::Candidate candidate)
                                     {
-        if (auto ws = ws_weak.lock()) {
-            json msg;
-            msg["type"]      = "candidate";
-            msg["candidate"] = std::string(candidate);
-            msg["sdpMid"]    = candidate.mid();
-            try {
-                ws->send(msg.dump());
-            } catch (const std::exception& e) {
-                spdlog::error("[{}] Failed to send candidate: {}", client_id, e.what());
-            }
+        auto ctx = ctx_weak.lock();
+        if (!ctx)
+            return;
+
+        if (batch_ms > 0) {
+            std::lock_guard<std::mutex> lock(ctx->candidates_mutex);
+            ctx->pending_candidates.push_back({{"candidate", std::string(candidate)}, {"sdpMid", candidate.mid()}});
+            if (ctx->candidate_flush_scheduled)
+                return;
+            ctx->candidate_flush_scheduled = true;
+            reactor.add_timer(static_cast<unsigned>(batch_ms), [ctx_weak]() {
+                if (auto ctx = ctx_weak.lock()) {
+                    std::lock_guard<std::mutex> lock(ctx->candidates_mutex);
+                    flush_candidates(*ctx);
+                }
+                return false;
+            });
+            return;
+        }
+
+        json msg;
+        msg["type"]      = "candidate";
+        msg["candidate"] = std::string(candidate);
+        msg["sdpMid"]    = candidate.mid();
+        try {
+            ctx->ws->send(msg.dump());
+        } catch (const std::exception& e) {
+            spdlog::error("[{}] Failed to send candidate: {}", client_id, e.what());
         } });
 
-        // Handle incoming messages from this client's WebSocket
+        // Handle incoming messages from this client's WebSocket on a
+        // signaling worker: other clients' negotiations proceed in parallel,
+        // this client's messages keep their order
         ws->onMessage([this, client_id](auto data)
                       {
         if (auto* msg_str = std::get_if<std::string>(&data)) {
-            try {
-                json msg = json::parse(*msg_str);
-                handle_message(client_id, msg);
-            } catch (const json::parse_error& e) {
-                spdlog::error("[{}] JSON parse error: {}", client_id, e.what());
-            }
+            workers_.post(client_id, [this, client_id, text = *msg_str]() {
+                try {
+                    json msg = json::parse(text);
+                    handle_message(client_id, msg);
+                } catch (const json::parse_error& e) {
+                    spdlog::error("[{}] JSON parse error: {}", client_id, e.what());
+                }
+            });
         } });
 
         // Track open callback
@@ -126,86 +241,323 @@ namespace ist
             peers_[client_id] = ctx;
         }
 
-        // Set up video tracks and create offer
-        setup_tracks(*ctx);
-        create_offer(ctx);
+        // Tracks and the first offer follow the client's request_stream
     }
 
-    void PeerManager::setup_tracks(PeerContext &ctx)
+    void PeerManager::flush_candidates(PeerContext &ctx)
     {
-        spdlog::info("[{}] Setting up {} video tracks", ctx.client_id, cameras_.size());
+        ctx.candidate_flush_scheduled = false;
+        if (ctx.pending_candidates.empty())
+            return;
 
-        for (size_t i = 0; i < cameras_.size(); i++)
+        json msg;
+        msg["type"] = "candidates";
+        msg["candidates"] = std::move(ctx.pending_candidates);
+        ctx.pending_candidates = json::array();
+
+        spdlog::debug("[{}] Sending {} ICE candidates", ctx.client_id, msg["candidates"].size());
+        try
+        {
+            ctx.ws->send(msg.dump());
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::error("[{}] Failed to send candidates: {}", ctx.client_id, e.what());
+        }
+    }
+
+    void PeerManager::open_session(const std::string &client_id)
+    {
+        if (!config_.webrtc.fast_connect)
+            return;
+
+        std::shared_ptr<PeerContext> ctx;
         {
-            auto &camera = cameras_[i];
-            const auto &cam_config = camera->config();
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            auto it = peers_.find(client_id);
+            if (it != peers_.end())
+                ctx = it->second;
+        }
+        if (!ctx)
+            return;
 
-            uint32_t ssrc = static_cast<uint32_t>(1000 + i);
-            uint8_t payloadType = static_cast<uint8_t>(96 + i);
+        // "/?cameras=cam_front,cam_rear" ("*" = all); no parameter = wait
+        // for request_stream as before
+        std::string path = ctx->ws->path().value_or("");
+        size_t query = path.find('?');
+        if (query == std::string::npos)
+            return;
+        json request;
+        for (size_t pos = query + 1; pos < path.size();)
+        {
+            size_t end = path.find('&', pos);
+            if (end == std::string::npos)
+                end = path.size();
+            std::string param = path.substr(pos, end - pos);
+            pos = end + 1;
+            if (param.rfind("cameras=", 0) != 0)
+                continue;
 
-            // Create video track description
-            rtc::Description::Video media(cam_config.id, rtc::Description::Direction::SendOnly);
-            media.addH264Codec(payloadType);
-            media.addSSRC(ssrc, cam_config.id);
+            request["type"] = "request_stream";
+            std::string list = param.substr(8);
+            if (list == "*")
+                break; // no "cameras" field = all
+            request["cameras"] = json::array();
+            for (size_t start = 0; start <= list.size();)
+            {
+                size_t comma = std::min(list.find(',', start), list.size());
+                if (comma > start)
+                    request["cameras"].push_back(list.substr(start, comma - start));
+                start = comma + 1;
+            }
+        }
+        if (request.empty())
+            return;
 
-            auto track = ctx.peer->addTrack(media);
+        spdlog::info("[{}] Fast connect: offering cameras from URL", client_id);
+        workers_.post(client_id, [this, client_id, request = std::move(request)]()
+                      { handle_message(client_id, request); });
+    }
+
+    std::shared_ptr<rtc::Track> PeerManager::add_track(PeerContext &ctx, size_t i)
+    {
+        auto &camera = cameras_[i];
+        auto &fanout = fanouts_[i].front();
+        const auto &cam_config = camera->config();
+
+        uint32_t ssrc = fanout->ssrc();
+        uint8_t payloadType = fanout->payload_type(); // layer 0; the packets carry their layer's type
+
+        auto track = ctx.peer->addTrack(media_templates_[i]);
+
+        // RTCP feedback: PLI/FIR → force IDR on whichever layer the track
+        // currently receives (or re-prime from cache)
+        auto feedback = std::make_shared<RtcpFeedbackHandler>();
+        feedback->on_keyframe_request([layers = &fanouts_[i], track_weak = std::weak_ptr(track)]()
+                                      {
+            if (auto track = track_weak.lock())
+            {
+                for (const auto &layer_fanout : *layers)
+                {
+                    if (layer_fanout->request_keyframe(track.get()))
+                        break;
+                }
+            } });
+        if (config_.webrtc.adaptive_bitrate)
+        {
+            feedback->on_remb([this, bwe_weak = std::weak_ptr(ctx.bwe)](uint32_t bps)
+                              {
+                if (auto bwe = bwe_weak.lock())
+                {
+                    bwe->on_remb(bps);
+                    update_bitrates();
+                } });
+        }
 
-            // Set up RTP packetization config + H264 packetizer
-            auto rtpConfig = std::make_shared<rtc::RtpPacketizationConfig>(
+        // Per-peer RTP state — packetization itself is shared per camera
+        // in RtpFanout, which only rewrites SSRC/sequence/timestamp here.
+        // Kept across unsubscribe so the sequence stays continuous.
+        auto rtp = std::make_shared<PeerRtpState>(
+            std::make_shared<rtc::RtpPacketizationConfig>(
                 ssrc,
                 cam_config.id,
                 payloadType,
                 rtc::H264RtpPacketizer::defaultClockRate // 90000 Hz
-            );
+                ),
+            config_.webrtc.nack_buffer_kb > 0 ? RetransmitHistory::kDefaultCapacity : 0);
+        ctx.rtp_states[cam_config.id] = rtp;
+
+        // Receiver reports: metrics always, bandwidth estimation when enabled
+        auto stats = std::make_shared<TrackRtcpStats>();
+        ctx.rtcp_stats[cam_config.id] = stats;
+
+        // NACK: resend from the camera's shared retransmission cache
+        if (config_.webrtc.nack_buffer_kb > 0)
+        {
+            feedback->on_nack([rtp_weak = std::weak_ptr(rtp), stats, track_weak = std::weak_ptr(track),
+                               ssrc](uint32_t media_ssrc, const std::vector<uint16_t> &seqs)
+                              {
+                auto rtp = rtp_weak.lock();
+                auto track = track_weak.lock();
+                if (media_ssrc != ssrc || !rtp || !track)
+                    return;
+                auto result = RtpFanout::retransmit(*rtp, *track, seqs);
+                stats->nacked.fetch_add(seqs.size(), std::memory_order_relaxed);
+                stats->retransmitted.fetch_add(result.sent, std::memory_order_relaxed);
+                stats->nack_misses.fetch_add(result.missed, std::memory_order_relaxed); });
+        }
+        feedback->on_report([this, stats, bwe_weak = std::weak_ptr(ctx.bwe), ssrc,
+                             adaptive = config_.webrtc.adaptive_bitrate,
+                             budgeted = config_.webrtc.uplink_budget_kbps > 0](const RtcpFeedbackHandler::ReceptionReport &report)
+                            {
+            if (report.ssrc != ssrc)
+                return;
 
-            auto packetizer = std::make_shared<rtc::H264RtpPacketizer>(
-                rtc::NalUnit::Separator::LongStartSequence,
-                rtpConfig);
+            stats->fraction_lost.store(report.fraction_lost / 256.0, std::memory_order_relaxed);
+            stats->packets_lost.store(report.cumulative_lost, std::memory_order_relaxed);
+            stats->jitter_s.store(report.jitter / 90000.0, std::memory_order_relaxed);
+            double rtt = round_trip_seconds(report);
+            if (rtt >= 0)
+                stats->rtt_s.store(rtt, std::memory_order_relaxed);
 
-            track->setMediaHandler(packetizer);
+            if (adaptive)
+            {
+                if (auto bwe = bwe_weak.lock())
+                    bwe->on_loss_report(report.fraction_lost);
+            }
+            if (adaptive || budgeted)
+                update_bitrates(); });
+        track->setMediaHandler(feedback);
+        ctx.tracks[cam_config.id] = track;
+
+        spdlog::info("[{}] Added track for camera '{}' (mid={}, ssrc={}, pt={})",
+                     ctx.client_id, cam_config.id, track->mid(), ssrc, payloadType);
+        return track;
+    }
+
+    bool PeerManager::update_subscriptions(PeerContext &ctx, const std::vector<bool> &wanted)
+    {
+        bool changed = false;
+
+        for (size_t i = 0; i < cameras_.size(); i++)
+        {
+            const std::string &cam_id = cameras_[i]->id();
+            bool want = i < wanted.size() && wanted[i];
+            if (want == ctx.subscribed(i))
+                continue;
 
-            ctx.tracks[cam_config.id] = track;
+            changed = true;
+            auto it = ctx.tracks.find(cam_id);
 
-            spdlog::info("[{}] Added track for camera '{}' (mid={}, ssrc={}, pt={})",
-                         ctx.client_id, cam_config.id, track->mid(), ssrc, payloadType);
+            if (want)
+            {
+                std::shared_ptr<rtc::Track> track;
+                if (it == ctx.tracks.end())
+                {
+                    track = add_track(ctx, i);
+                }
+                else
+                {
+                    // m-lines cannot be removed — re-activate the existing one
+                    track = it->second;
+                    auto desc = track->description();
+                    desc.setDirection(rtc::Description::Direction::SendOnly);
+                    track->setDescription(std::move(desc));
+                }
 
-            // Register frame callback with ID tracking for cleanup
-            auto track_weak = std::weak_ptr(track);
-            auto rtp_config_weak = std::weak_ptr(rtpConfig);
-            auto start_time = ctx.start_time;
+                auto pinned = ctx.pinned_layers.find(i);
+                size_t layer = pinned != ctx.pinned_layers.end() ? pinned->second
+                                                                 : cameras_[i]->first_layer(track_codec(ctx, i));
+                CallbackId cb_id = fanouts_[i][layer]->subscribe(track, ctx.rtp_states[cam_id], ctx.send_queue);
+                ctx.subscriptions.push_back({i, layer, cb_id});
+                spdlog::info("[{}] Subscribed to camera '{}' (layer '{}')",
+                             ctx.client_id, cam_id, cameras_[i]->layer_info(layer).name);
+            }
+            else
+            {
+                auto *sub = ctx.subscription(i);
+                fanouts_[i][sub->layer]->unsubscribe(sub->id);
+                ctx.subscriptions.erase(ctx.subscriptions.begin() + (sub - ctx.subscriptions.data()));
 
-            CallbackId cb_id = camera->on_frame(
-                [track_weak, rtp_config_weak, start_time,
-                 cam_id = cam_config.id](const H264Frame &frame)
+                if (it != ctx.tracks.end())
                 {
-                    auto track = track_weak.lock();
-                    if (!track || !track->isOpen())
-                        return;
+                    auto desc = it->second->description();
+                    desc.setDirection(rtc::Description::Direction::Inactive);
+                    it->second->setDescription(std::move(desc));
+                }
+                spdlog::info("[{}] Unsubscribed from camera '{}'", ctx.client_id, cam_id);
+            }
+        }
 
-                    auto rtpConfig = rtp_config_weak.lock();
-                    if (!rtpConfig)
-                        return;
+        return changed;
+    }
 
-                    // Calculate RTP timestamp (90kHz clock from elapsed time)
-                    auto elapsed = std::chrono::steady_clock::now() - start_time;
-                    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
-                    rtpConfig->timestamp = static_cast<uint32_t>(elapsed_us * 90 / 1000);
+    void PeerManager::apply_fec_negotiation(PeerContext &ctx, rtc::Description &answer)
+    {
+        // m-line mids are the camera IDs
+        for (int m = 0; m < answer.mediaCount(); m++)
+        {
+            auto entry = answer.media(m);
+            auto *media = std::get_if<rtc::Description::Media *>(&entry);
+            if (!media || !*media)
+                continue;
+            auto it = ctx.rtp_states.find((*media)->mid());
+            if (it == ctx.rtp_states.end())
+                continue;
 
-                    try
-                    {
-                        track->send(
-                            reinterpret_cast<const std::byte *>(frame.data.data()),
-                            frame.data.size());
-                    }
-                    catch (const std::exception &e)
-                    {
-                        spdlog::warn("[{}] Failed to send frame: {}", cam_id, e.what());
-                    }
-                });
+            bool red = (*media)->hasPayloadType(RtpFanout::kRedPayloadType) &&
+                       (*media)->hasPayloadType(RtpFanout::kUlpfecPayloadType);
+            if (it->second->red.exchange(red) != red)
+                spdlog::info("[{}] ULPFEC {} for camera '{}'", ctx.client_id, red ? "enabled" : "not negotiated",
+                             it->first);
+        }
+    }
 
-            // Store callback ID for cleanup when peer disconnects
-            ctx.callback_ids.push_back({i, cb_id});
+    void PeerManager::apply_codec_negotiation(PeerContext &ctx, rtc::Description &answer)
+    {
+        for (int m = 0; m < answer.mediaCount(); m++)
+        {
+            auto entry = answer.media(m);
+            auto *media = std::get_if<rtc::Description::Media *>(&entry);
+            if (!media || !*media)
+                continue;
+            auto cam = std::find_if(cameras_.begin(), cameras_.end(),
+                                    [media](const auto &camera)
+                                    { return camera->id() == (*media)->mid(); });
+            if (cam == cameras_.end())
+                continue;
+            const size_t index = static_cast<size_t>(cam - cameras_.begin());
+
+            const RtpFanout *chosen = nullptr;
+            for (const auto &fanout : fanouts_[index])
+            {
+                if ((*media)->hasPayloadType(fanout->payload_type()))
+                {
+                    chosen = fanout.get();
+                    break;
+                }
+            }
+            if (!chosen)
+            {
+                spdlog::warn("[{}] No common video codec for camera '{}' (offered {})", ctx.client_id,
+                             (*cam)->id(), video_codec_name((*cam)->codec()));
+                continue;
+            }
+
+            const VideoCodec codec = chosen->codec();
+            auto previous = ctx.codecs.find(index);
+            if (previous == ctx.codecs.end() || previous->second != codec)
+                spdlog::info("[{}] Camera '{}' sent as {}", ctx.client_id, (*cam)->id(), video_codec_name(codec));
+            ctx.codecs[index] = codec;
+
+            // A pin on a layer the browser cannot decode no longer applies
+            auto pinned = ctx.pinned_layers.find(index);
+            if (pinned != ctx.pinned_layers.end() && (*cam)->layer_info(pinned->second).codec != codec)
+                ctx.pinned_layers.erase(pinned);
+
+            auto *sub = ctx.subscription(index);
+            if (sub && (*cam)->layer_info(sub->layer).codec != codec)
+                switch_layer(ctx, *sub, (*cam)->first_layer(codec));
+        }
+    }
+
+    VideoCodec PeerManager::track_codec(const PeerContext &ctx, size_t index) const
+    {
+        auto it = ctx.codecs.find(index);
+        return it != ctx.codecs.end() ? it->second : cameras_[index]->codec();
+    }
+
+    void PeerManager::renegotiate(std::shared_ptr<PeerContext> ctx)
+    {
+        // Only one offer may be outstanding; the answer handler re-offers
+        if (ctx->negotiating)
+        {
+            ctx->renegotiate_pending = true;
+            return;
         }
+        ctx->negotiating = true;
+        ctx->renegotiate_pending = false;
+        create_offer(std::move(ctx));
     }
 
     void PeerManager::create_offer(std::shared_ptr<PeerContext> ctx)
@@ -235,17 +587,204 @@ namespace ist
         ctx->peer->setLocalDescription(rtc::Description::Type::Offer);
     }
 
+    size_t PeerManager::select_layer(size_t index, uint64_t share_kbps, size_t current) const
+    {
+        const auto &camera = cameras_[index];
+        const VideoCodec codec = camera->layer_info(current).codec;
+        for (size_t layer = 0; layer < camera->layer_count(); layer++)
+        {
+            if (camera->layer_info(layer).codec != codec)
+                continue;
+
+            // Moving up needs the full nominal bitrate; staying tolerates a
+            // shortfall that the layer's own ABR range can absorb
+            double needed = camera->layer_info(layer).bitrate * (layer >= current ? kLayerDownFraction : 1.0);
+            if (share_kbps >= needed)
+                return layer;
+        }
+        return camera->last_layer(codec);
+    }
+
+    void PeerManager::switch_layer(PeerContext &ctx, PeerContext::Subscription &sub, size_t layer)
+    {
+        const std::string &cam_id = cameras_[sub.camera]->id();
+        auto &track = ctx.tracks[cam_id];
+
+        // Subscribe before unsubscribing so the camera callback of a layer
+        // that keeps other viewers is never dropped and re-added
+        CallbackId id = fanouts_[sub.camera][layer]->subscribe(track, ctx.rtp_states[cam_id], ctx.send_queue);
+        fanouts_[sub.camera][sub.layer]->unsubscribe(sub.id);
+
+        spdlog::info("[{}] Camera '{}' layer {} → {}", ctx.client_id, cam_id,
+                     cameras_[sub.camera]->layer_info(sub.layer).name,
+                     cameras_[sub.camera]->layer_info(layer).name);
+        sub.layer = layer;
+        sub.id = id;
+
+        // The new subscriber primes from the layer's cache; make sure an IDR
+        // follows soon in case the cache is disabled
+        cameras_[sub.camera]->request_keyframe(layer);
+    }
+
+    void PeerManager::update_bitrates()
+    {
+        int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count();
+        int64_t last = last_bitrate_update_ms_.load();
+        if (now_ms - last < kBitrateUpdateIntervalMs ||
+            !last_bitrate_update_ms_.compare_exchange_strong(last, now_ms))
+            return;
+
+        std::unique_lock<std::mutex> round(bitrate_mutex_, std::try_to_lock);
+        if (!round.owns_lock())
+            return;
+
+        // Never block an RTCP thread behind a negotiation; a busy peer is
+        // counted again in the next round. try_lock only, so holding
+        // several peer locks at once cannot deadlock.
+        std::vector<std::shared_ptr<PeerContext>> peers;
+        std::vector<std::unique_lock<std::mutex>> peer_locks;
+        for (auto &ctx : snapshot_peers())
+        {
+            std::unique_lock<std::mutex> peer_lock(ctx->mutex, std::try_to_lock);
+            if (!peer_lock.owns_lock())
+                continue;
+            peers.push_back(std::move(ctx));
+            peer_locks.push_back(std::move(peer_lock));
+        }
+
+        std::vector<int> budgets = allocate_budgets(peers);
+
+        // Per camera layer: each watching peer's share of its estimate (kbps)
+        std::vector<std::vector<std::vector<int>>> shares(cameras_.size());
+        for (size_t i = 0; i < cameras_.size(); i++)
+            shares[i].resize(cameras_[i]->layer_count());
+
+        for (const auto &ctx : peers)
+        {
+            // Without feedback only the budget constrains the peer
+            bool feedback = ctx->bwe && ctx->bwe->has_feedback();
+            if (!feedback && budgets.empty())
+                continue;
+
+            uint64_t weight_total = 0;
+            for (const auto &sub : ctx->subscriptions)
+                weight_total += cameras_[sub.camera]->max_bitrate_kbps();
+            if (weight_total == 0)
+                continue;
+
+            uint64_t estimate_kbps = feedback ? ctx->bwe->estimate_bps() / 1000 : 0;
+            for (auto &sub : ctx->subscriptions)
+            {
+                uint64_t share = feedback ? estimate_kbps * cameras_[sub.camera]->max_bitrate_kbps() / weight_total
+                                          : UINT32_MAX;
+                if (!budgets.empty())
+                    share = std::min<uint64_t>(share, static_cast<uint64_t>(budgets[sub.camera]));
+
+                if (cameras_[sub.camera]->layer_count() > 1 && !ctx->pinned_layers.count(sub.camera))
+                {
+                    size_t layer = select_layer(sub.camera, share, sub.layer);
+                    if (layer != sub.layer)
+                        switch_layer(*ctx, sub, layer);
+                }
+                shares[sub.camera][sub.layer].push_back(static_cast<int>(std::min<uint64_t>(share, INT32_MAX)));
+            }
+        }
+
+        for (size_t i = 0; i < cameras_.size(); i++)
+        {
+            for (size_t layer = 0; layer < shares[i].size(); layer++)
+            {
+                auto &layer_shares = shares[i][layer];
+                if (layer_shares.empty())
+                    continue;
+
+                size_t rank = layer_shares.size() * static_cast<size_t>(config_.webrtc.abr_percentile) / 100;
+                rank = std::min(rank, layer_shares.size() - 1);
+                std::nth_element(layer_shares.begin(), layer_shares.begin() + rank, layer_shares.end());
+                cameras_[i]->set_bitrate(layer_shares[rank], layer);
+            }
+        }
+    }
+
+    std::vector<int> PeerManager::allocate_budgets(const std::vector<std::shared_ptr<PeerContext>> &peers)
+    {
+        if (config_.webrtc.uplink_budget_kbps <= 0)
+            return {};
+
+        // Highest priority any viewer gives each camera; unwatched = none
+        std::vector<int> level(cameras_.size(), -1);
+        for (const auto &ctx : peers)
+        {
+            for (const auto &sub : ctx->subscriptions)
+            {
+                auto it = ctx->priorities.find(sub.camera);
+                auto priority = it != ctx->priorities.end() ? it->second : ViewPriority::NORMAL;
+                level[sub.camera] = std::max(level[sub.camera], static_cast<int>(priority));
+            }
+        }
+
+        std::vector<BitrateDemand> demands(cameras_.size());
+        for (size_t i = 0; i < cameras_.size(); i++)
+        {
+            const auto &camera = cameras_[i];
+            double weight = 0;
+            if (level[i] == static_cast<int>(ViewPriority::FOCUS))
+                weight = config_.webrtc.focus_weight;
+            else if (level[i] == static_cast<int>(ViewPriority::NORMAL))
+                weight = 1.0;
+            else if (level[i] == static_cast<int>(ViewPriority::BACKGROUND))
+                weight = config_.webrtc.background_weight;
+            demands[i] = {weight * camera->max_bitrate_kbps(),
+                          camera->min_bitrate_kbps(camera->last_layer(camera->codec())),
+                          camera->max_bitrate_kbps()};
+        }
+
+        std::vector<int> budgets = allocate_bitrates(config_.webrtc.uplink_budget_kbps, demands);
+        for (size_t i = 0; i < cameras_.size(); i++)
+        {
+            if (budgets_kbps_[i].exchange(budgets[i]) != budgets[i] && level[i] >= 0)
+                spdlog::debug("[{}] Bitrate budget {} kbps ({})", cameras_[i]->id(), budgets[i],
+                              view_priority_name(static_cast<ViewPriority>(level[i])));
+
+            // Frame rate: background-only cameras slow down, others return
+            // to their configured rate (RTSP cannot be reconfigured)
+            const auto &camera = cameras_[i];
+            if (config_.webrtc.background_fps <= 0 || level[i] < 0 || camera->passthrough())
+                continue;
+            int fps = level[i] == static_cast<int>(ViewPriority::BACKGROUND)
+                          ? std::min(config_.webrtc.background_fps, camera->config().fps)
+                          : camera->config().fps;
+            VideoMode mode = camera->video_mode();
+            if (mode.fps != fps)
+            {
+                spdlog::info("[{}] {} fps for {} view", camera->id(), fps,
+                             view_priority_name(static_cast<ViewPriority>(level[i])));
+                mode.fps = fps;
+                camera->reconfigure(mode);
+            }
+        }
+        return budgets;
+    }
+
     void PeerManager::handle_message(const std::string &client_id, const json &msg)
     {
-        std::lock_guard<std::mutex> lock(peers_mutex_);
-        auto it = peers_.find(client_id);
-        if (it == peers_.end())
+        std::shared_ptr<PeerContext> ctx;
+        {
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            auto it = peers_.find(client_id);
+            if (it != peers_.end())
+                ctx = it->second;
+        }
+        if (!ctx)
         {
             spdlog::warn("[{}] Peer not found for message", client_id);
             return;
         }
 
-        auto &ctx = it->second;
+        // Slow libdatachannel calls below only hold up this client
+        std::lock_guard<std::mutex> lock(ctx->mutex);
         std::string type = msg.value("type", "");
 
         if (type == "answer")
@@ -259,19 +798,28 @@ namespace ist
                     rtc::Description answer(sdp, rtc::Description::Type::Answer);
                     ctx->peer->setRemoteDescription(answer);
                     ctx->ready = true;
+                    if (config_.webrtc.fec == FecMode::ULPFEC)
+                        apply_fec_negotiation(*ctx, answer);
+                    apply_codec_negotiation(*ctx, answer);
                 }
                 catch (const std::exception &e)
                 {
                     spdlog::error("[{}] Failed to set answer: {}", client_id, e.what());
                 }
+
+                ctx->negotiating = false;
+                if (ctx->renegotiate_pending)
+                    renegotiate(ctx);
             }
         }
-        else if (type == "candidate")
+        else if (type == "candidate" || type == "candidates")
         {
-            if (msg.contains("candidate") && !msg["candidate"].is_null())
+            auto add_candidate = [&](const json &entry)
             {
-                std::string candidate = msg["candidate"].get<std::string>();
-                std::string mid = msg.value("sdpMid", "");
+                if (!entry.contains("candidate") || !entry["candidate"].is_string())
+                    return;
+                std::string candidate = entry["candidate"].get<std::string>();
+                std::string mid = entry.value("sdpMid", "");
                 spdlog::debug("[{}] Adding ICE candidate", client_id);
                 try
                 {
@@ -281,38 +829,153 @@ namespace ist
                 {
                     spdlog::error("[{}] Failed to add candidate: {}", client_id, e.what());
                 }
-            }
+            };
+
+            // Batched form: {"type":"candidates","candidates":[{candidate, sdpMid}, ...]}
+            if (type == "candidate")
+                add_candidate(msg);
+            else if (msg.contains("candidates") && msg["candidates"].is_array())
+                for (const auto &entry : msg["candidates"])
+                    add_candidate(entry);
         }
         else if (type == "request_stream")
         {
-            spdlog::info("[{}] Client requesting stream (peer already created)", client_id);
-        }
-    }
+            // Absent list = every camera (clients predating subscriptions)
+            std::vector<bool> wanted(cameras_.size(), !msg.contains("cameras"));
+            if (msg.contains("cameras") && msg["cameras"].is_array())
+            {
+                for (const auto &id : msg["cameras"])
+                {
+                    if (!id.is_string())
+                        continue;
+                    auto cam = std::find_if(cameras_.begin(), cameras_.end(),
+                                            [&id](const auto &camera)
+                                            { return camera->id() == id.get<std::string>(); });
+                    if (cam == cameras_.end())
+                    {
+                        spdlog::warn("[{}] request_stream: unknown camera '{}'", client_id, id.get<std::string>());
+                        continue;
+                    }
+                    wanted[static_cast<size_t>(cam - cameras_.begin())] = true;
+                }
+            }
 
-    void PeerManager::remove_peer(const std::string &client_id)
-    {
-        std::lock_guard<std::mutex> lock(peers_mutex_);
-        auto it = peers_.find(client_id);
-        if (it != peers_.end())
-        {
-            spdlog::info("[{}] Removing peer (cleaning up {} callbacks)",
-                         client_id, it->second->callback_ids.size());
+            size_t count = static_cast<size_t>(std::count(wanted.begin(), wanted.end(), true));
+            spdlog::info("[{}] Client requesting {} of {} cameras", client_id, count, cameras_.size());
 
-            // Unregister all frame callbacks for this peer
-            for (auto &[cam_idx, cb_id] : it->second->callback_ids)
+            // Optional layer pins: {"layers": {"cam_front": "half" | "auto"}}
+            if (msg.contains("layers") && msg["layers"].is_object())
             {
-                if (cam_idx < cameras_.size())
+                for (const auto &[cam_id, layer_name] : msg["layers"].items())
                 {
-                    cameras_[cam_idx]->remove_callback(cb_id);
+                    auto cam = std::find_if(cameras_.begin(), cameras_.end(),
+                                            [&cam_id](const auto &camera)
+                                            { return camera->id() == cam_id; });
+                    if (cam == cameras_.end() || !layer_name.is_string())
+                        continue;
+                    size_t index = static_cast<size_t>(cam - cameras_.begin());
+
+                    std::string name = layer_name.get<std::string>();
+                    size_t layer = 0;
+                    while (layer < (*cam)->layer_count() && (*cam)->layer_info(layer).name != name)
+                        layer++;
+                    if (layer == (*cam)->layer_count())
+                    {
+                        ctx->pinned_layers.erase(index); // "auto" or unknown → follow bandwidth
+                        continue;
+                    }
+                    if ((*cam)->layer_info(layer).codec != track_codec(*ctx, index))
+                    {
+                        spdlog::warn("[{}] Layer '{}' of camera '{}' is {}, not the negotiated {}", client_id,
+                                     name, cam_id, video_codec_name((*cam)->layer_info(layer).codec),
+                                     video_codec_name(track_codec(*ctx, index)));
+                        continue;
+                    }
+
+                    ctx->pinned_layers[index] = layer;
+                    if (auto *sub = ctx->subscription(index); sub && sub->layer != layer)
+                        switch_layer(*ctx, *sub, layer);
                 }
             }
 
-            if (it->second->peer)
+            if (update_subscriptions(*ctx, wanted))
+                renegotiate(ctx);
+        }
+        else if (type == "priority")
+        {
+            // {"cameras": {"cam_front": "focus", "cam_rear": "background"}}
+            // replaces the previous report; unnamed cameras are "normal"
+            ctx->priorities.clear();
+            if (msg.contains("cameras") && msg["cameras"].is_object())
             {
-                it->second->peer->close();
+                for (const auto &[cam_id, name] : msg["cameras"].items())
+                {
+                    auto cam = std::find_if(cameras_.begin(), cameras_.end(),
+                                            [&cam_id](const auto &camera)
+                                            { return camera->id() == cam_id; });
+                    ViewPriority priority = ViewPriority::NORMAL;
+                    if (cam == cameras_.end() || !name.is_string() ||
+                        !parse_view_priority(name.get<std::string>(), priority))
+                    {
+                        spdlog::warn("[{}] priority: ignoring '{}'", client_id, cam_id);
+                        continue;
+                    }
+                    if (priority != ViewPriority::NORMAL)
+                        ctx->priorities[static_cast<size_t>(cam - cameras_.begin())] = priority;
+                }
             }
+            spdlog::info("[{}] View priorities updated ({} non-normal)", client_id, ctx->priorities.size());
+
+            // Reallocate on the next receiver report rather than after the
+            // rate limit; this thread holds ctx->mutex, which the round needs
+            last_bitrate_update_ms_.store(0);
+        }
+    }
+
+    void PeerManager::remove_peer(const std::string &client_id)
+    {
+        std::shared_ptr<PeerContext> ctx;
+        {
+            std::lock_guard<std::mutex> lock(peers_mutex_);
+            auto it = peers_.find(client_id);
+            if (it == peers_.end())
+                return;
+            ctx = std::move(it->second);
             peers_.erase(it);
         }
+
+        // Behind anything the client sent before it went away
+        if (!workers_.post(client_id, [this, ctx]()
+                           { close_peer(*ctx); }))
+        {
+            close_peer(*ctx); // shutting down
+        }
+    }
+
+    void PeerManager::close_peer(PeerContext &ctx)
+    {
+        std::lock_guard<std::mutex> lock(ctx.mutex);
+        spdlog::info("[{}] Removing peer (cleaning up {} callbacks)",
+                     ctx.client_id, ctx.subscriptions.size());
+
+        // Unsubscribe this peer from all camera fan-outs
+        for (const auto &sub : ctx.subscriptions)
+        {
+            fanouts_[sub.camera][sub.layer]->unsubscribe(sub.id);
+        }
+        ctx.subscriptions.clear();
+
+        // Stop the send worker before closing the connection
+        if (auto &queue = ctx.send_queue)
+        {
+            spdlog::info("[{}] Send queue: {} frames dropped", ctx.client_id, queue->dropped());
+            queue->stop();
+        }
+
+        if (ctx.peer)
+        {
+            ctx.peer->close();
+        }
     }
 
     size_t PeerManager::peer_count() const
@@ -321,4 +984,197 @@ namespace ist
         return peers_.size();
     }
 
+    void PeerManager::log_latency_stats()
+    {
+        for (size_t i = 0; i < cameras_.size(); i++)
+        {
+            auto capture = cameras_[i]->capture_latency().interval();
+            if (capture.count > 0)
+            {
+                spdlog::info("[{}] Latency capture→appsink p50={:.1f}ms p95={:.1f}ms p99={:.1f}ms (n={})",
+                             cameras_[i]->id(), capture.p50_ms, capture.p95_ms, capture.p99_ms, capture.count);
+            }
+
+            for (const auto &fanout : fanouts_[i])
+            {
+                auto dispatch = fanout->dispatch_latency().interval();
+                auto packetize = fanout->packetize_latency().interval();
+                if (packetize.count == 0)
+                    continue;
+                spdlog::info("[{}] Latency ({}) appsink→dispatch p99={:.2f}ms, appsink→packetized "
+                             "p50={:.2f}ms p95={:.2f}ms p99={:.2f}ms",
+                             cameras_[i]->id(), cameras_[i]->layer_info(fanout->layer()).name,
+                             dispatch.p99_ms, packetize.p50_ms, packetize.p95_ms, packetize.p99_ms);
+            }
+        }
+
+        for (const auto &ctx : snapshot_peers())
+        {
+            if (!ctx->send_queue)
+                continue;
+            auto sent = ctx->send_queue->send_latency().interval();
+            if (sent.count == 0)
+                continue;
+            spdlog::info("[{}] Latency capture→sent p50={:.1f}ms p95={:.1f}ms p99={:.1f}ms "
+                         "(n={}, queued={}, dropped={})",
+                         ctx->client_id, sent.p50_ms, sent.p95_ms, sent.p99_ms, sent.count,
+                         ctx->queue_depth(), ctx->dropped_frames());
+        }
+    }
+
+    void PeerManager::write_metrics(MetricsText &out) const
+    {
+        // ---- Fan-out (camera layer) ----
+        auto layer_labels = [this](size_t i, const RtpFanout &fanout) -> MetricsText::Labels
+        {
+            return {{"camera", cameras_[i]->id()}, {"layer", cameras_[i]->layer_info(fanout.layer()).name}};
+        };
+        auto each_fanout = [this](const auto &fn)
+        {
+            for (size_t i = 0; i < fanouts_.size(); i++)
+                for (const auto &fanout : fanouts_[i])
+                    fn(i, *fanout);
+        };
+
+        if (config_.webrtc.uplink_budget_kbps > 0)
+        {
+            out.family("ist_camera_bitrate_budget_kbps", "gauge", "Camera's share of the uplink budget (0 = unwatched)");
+            for (size_t i = 0; i < cameras_.size(); i++)
+                out.sample("ist_camera_bitrate_budget_kbps", {{"camera", cameras_[i]->id()}},
+                           static_cast<double>(budgets_kbps_[i].load()));
+        }
+
+        out.family("ist_fanout_subscribers", "gauge", "Peer tracks subscribed to the camera layer");
+        each_fanout([&](size_t i, const RtpFanout &f)
+                    { out.sample("ist_fanout_subscribers", layer_labels(i, f), static_cast<double>(f.subscriber_count())); });
+
+        out.family("ist_fanout_frames_sent_total", "counter", "Frames sent to peer tracks");
+        each_fanout([&](size_t i, const RtpFanout &f)
+                    { out.sample("ist_fanout_frames_sent_total", layer_labels(i, f), static_cast<double>(f.traffic().frames)); });
+
+        out.family("ist_fanout_packets_sent_total", "counter", "RTP packets sent to peer tracks");
+        each_fanout([&](size_t i, const RtpFanout &f)
+                    { out.sample("ist_fanout_packets_sent_total", layer_labels(i, f), static_cast<double>(f.traffic().packets)); });
+
+        out.family("ist_fanout_bytes_sent_total", "counter", "RTP bytes sent to peer tracks");
+        each_fanout([&](size_t i, const RtpFanout &f)
+                    { out.sample("ist_fanout_bytes_sent_total", layer_labels(i, f), static_cast<double>(f.traffic().bytes)); });
+
+        out.family("ist_fanout_retransmit_cache_bytes", "gauge", "Pooled batch capacity kept for NACK retransmission");
+        each_fanout([&](size_t i, const RtpFanout &f)
+                    { out.sample("ist_fanout_retransmit_cache_bytes", layer_labels(i, f), static_cast<double>(f.retransmit_cache_bytes())); });
+
+        out.family("ist_fanout_packetize_latency_seconds", "histogram", "Appsink to packets ready");
+        each_fanout([&](size_t i, RtpFanout &f)
+                    { out.histogram("ist_fanout_packetize_latency_seconds", layer_labels(i, f), f.packetize_latency()); });
+
+        // ---- Peers ----
+        struct PeerSnapshot
+        {
+            std::string client_id;
+            std::shared_ptr<PeerSendQueue> queue;
+            std::shared_ptr<BandwidthEstimator> bwe;
+            std::vector<std::pair<std::string, std::shared_ptr<TrackRtcpStats>>> tracks;
+        };
+        std::vector<PeerSnapshot> peers;
+        for (const auto &ctx : snapshot_peers())
+        {
+            PeerSnapshot snapshot{ctx->client_id, ctx->send_queue, ctx->bwe, {}};
+            // Never wait on a peer mid-negotiation: its RTCP samples are
+            // skipped this scrape, like update_bitrates skips busy peers
+            std::unique_lock<std::mutex> lock(ctx->mutex, std::try_to_lock);
+            if (lock.owns_lock())
+                for (const auto &[camera_id, stats] : ctx->rtcp_stats)
+                    snapshot.tracks.emplace_back(camera_id, stats);
+            peers.push_back(std::move(snapshot));
+        }
+
+        out.family("ist_peers", "gauge", "Connected WebRTC peers");
+        out.sample("ist_peers", {}, static_cast<double>(peers.size()));
+
+        out.family("ist_peer_setup_seconds", "histogram", "WebSocket connect to PeerConnection connected");
+        out.histogram("ist_peer_setup_seconds", {}, setup_latency_);
+
+        out.family("ist_peer_first_frame_seconds", "histogram", "WebSocket connect to first frame sent");
+        out.histogram("ist_peer_first_frame_seconds", {}, first_frame_latency_);
+
+        auto each_queue = [&peers](const char *name, const auto &value)
+        {
+            for (const auto &peer : peers)
+                if (peer.queue)
+                    value(name, MetricsText::Labels{{"client", peer.client_id}}, *peer.queue);
+        };
+
+        out.family("ist_peer_frames_sent_total", "counter", "Frames handed to the peer's tracks");
+        each_queue("ist_peer_frames_sent_total", [&](const char *name, const auto &labels, const PeerSendQueue &q)
+                   { out.sample(name, labels, static_cast<double>(q.frames_sent())); });
+
+        out.family("ist_peer_bytes_sent_total", "counter", "RTP bytes handed to the peer's tracks");
+        each_queue("ist_peer_bytes_sent_total", [&](const char *name, const auto &labels, const PeerSendQueue &q)
+                   { out.sample(name, labels, static_cast<double>(q.bytes_sent())); });
+
+        out.family("ist_peer_queue_depth", "gauge", "Frames waiting in the peer's send queue");
+        each_queue("ist_peer_queue_depth", [&](const char *name, const auto &labels, const PeerSendQueue &q)
+                   { out.sample(name, labels, static_cast<double>(q.depth())); });
+
+        out.family("ist_peer_dropped_frames_total", "counter", "Frames dropped by the send queue overflow policy");
+        each_queue("ist_peer_dropped_frames_total", [&](const char *name, const auto &labels, const PeerSendQueue &q)
+                   { out.sample(name, labels, static_cast<double>(q.dropped())); });
+
+        out.family("ist_peer_pacer_wait_seconds_total", "counter", "Time the send worker spent pacing packets");
+        each_queue("ist_peer_pacer_wait_seconds_total", [&](const char *name, const auto &labels, const PeerSendQueue &q)
+                   { out.sample(name, labels, q.pacer().waited_seconds()); });
+
+        out.family("ist_peer_send_latency_seconds", "histogram", "Capture to track send completion");
+        each_queue("ist_peer_send_latency_seconds", [&](const char *name, const auto &labels, PeerSendQueue &q)
+                   { out.histogram(name, labels, q.send_latency()); });
+
+        out.family("ist_peer_bandwidth_estimate_bps", "gauge", "REMB/loss bandwidth estimate");
+        for (const auto &peer : peers)
+        {
+            if (peer.bwe && peer.bwe->has_feedback())
+                out.sample("ist_peer_bandwidth_estimate_bps", {{"client", peer.client_id}},
+                           static_cast<double>(peer.bwe->estimate_bps()));
+        }
+
+        // ---- Per-track receiver reports ----
+        auto each_track = [&peers](const auto &fn)
+        {
+            for (const auto &peer : peers)
+                for (const auto &[camera_id, stats] : peer.tracks)
+                    fn(MetricsText::Labels{{"client", peer.client_id}, {"camera", camera_id}}, *stats);
+        };
+
+        out.family("ist_peer_fraction_lost", "gauge", "Fraction of packets lost in the last RTCP report interval");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   { out.sample("ist_peer_fraction_lost", labels, s.fraction_lost.load(std::memory_order_relaxed)); });
+
+        out.family("ist_peer_packets_lost", "gauge", "Cumulative packets lost reported by the receiver");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   { out.sample("ist_peer_packets_lost", labels, s.packets_lost.load(std::memory_order_relaxed)); });
+
+        out.family("ist_peer_jitter_seconds", "gauge", "Interarrival jitter reported by the receiver");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   { out.sample("ist_peer_jitter_seconds", labels, s.jitter_s.load(std::memory_order_relaxed)); });
+
+        out.family("ist_peer_nack_packets_total", "counter", "Packets requested by the receiver's NACKs");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   { out.sample("ist_peer_nack_packets_total", labels, static_cast<double>(s.nacked.load(std::memory_order_relaxed))); });
+
+        out.family("ist_peer_retransmitted_packets_total", "counter", "Packets resent from the retransmission cache");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   { out.sample("ist_peer_retransmitted_packets_total", labels, static_cast<double>(s.retransmitted.load(std::memory_order_relaxed))); });
+
+        out.family("ist_peer_nack_misses_total", "counter", "NACKed packets no longer in the retransmission cache");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   { out.sample("ist_peer_nack_misses_total", labels, static_cast<double>(s.nack_misses.load(std::memory_order_relaxed))); });
+
+        out.family("ist_peer_rtt_seconds", "gauge", "Round-trip time from sender/receiver reports");
+        each_track([&](const auto &labels, const TrackRtcpStats &s)
+                   {
+            double rtt = s.rtt_s.load(std::memory_order_relaxed);
+            if (rtt >= 0)
+                out.sample("ist_peer_rtt_seconds", labels, rtt); });
+    }
+
 } // namespace ist
@@ -9,19 +9,49 @@
  *
  * Manages the lifecycle of WebRTC PeerConnection instances for each
  * connected control room client. Handles SDP negotiation, ICE candidate
- * exchange, video track setup with H.264 RTP packetization, and proper
+ * exchange, video track setup on top of the shared per-camera RTP fan-out
+ * (see rtp_fanout.h), and proper
  * resource cleanup on disconnection to prevent memory leaks.
+ *
+ * Clients choose which cameras they receive with a `request_stream`
+ * message: {"type":"request_stream","cameras":["cam_front", ...]}
+ * (no "cameras" field = all). Changing the set later renegotiates the
+ * live PeerConnection; dropped cameras become inactive m-lines.
+ * On simulcast cameras each peer receives the layer that fits its
+ * bandwidth estimate; "layers": {"cam_front": "half"} pins one ("auto"
+ * returns to bandwidth-driven selection).
+ *
+ * With webrtc.uplink_budget_kbps the cameras share one bitrate budget;
+ * clients report how prominently they show each camera with
+ * {"type":"priority","cameras":{"cam_front":"focus","cam_rear":"background"}}
+ * (unnamed cameras are "normal"), and focused views get the larger share.
+ *
+ * With webrtc.fast_connect a client may name its cameras in the WebSocket
+ * URL (`ws://host:8554/?cameras=cam_front,cam_rear`, `*` = all); the offer
+ * then follows `camera_list` without waiting for a request_stream, every
+ * peer shares one ICE UDP port, and local candidates are sent in batches
+ * ({"type":"candidates","candidates":[...]}).
  */
 
 #pragma once
 
 #include "config.h"
 #include "camera_pipeline.h"
+#include "rtp_fanout.h"
+#include "send_queue.h"
+#include "rtcp_feedback.h"
+#include "bandwidth_estimator.h"
+#include "bitrate_allocator.h"
+#include "bus_reactor.h"
+#include "metrics_server.h"
+#include "signaling_workers.h"
 #include <rtc/rtc.hpp>
 #include <nlohmann/json.hpp>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <chrono>
@@ -31,42 +61,121 @@ namespace ist
 
     using json = nlohmann::json;
 
+    /// Latest RTCP receiver report for one track (written on libdatachannel threads)
+    struct TrackRtcpStats
+    {
+        std::atomic<double> fraction_lost{0};  ///< 0-1, from the most recent report
+        std::atomic<uint32_t> packets_lost{0}; ///< Cumulative packets lost
+        std::atomic<double> jitter_s{0};       ///< Interarrival jitter
+        std::atomic<double> rtt_s{-1};         ///< Negative until a sender report is acknowledged
+        std::atomic<uint64_t> nacked{0};        ///< Packets requested by NACK
+        std::atomic<uint64_t> retransmitted{0}; ///< Packets resent from the cache
+        std::atomic<uint64_t> nack_misses{0};   ///< Requested packets no longer available
+    };
+
     /**
      * @brief Per-client WebRTC session state
      *
      * Holds all resources associated with a single control room client,
      * including the PeerConnection, video tracks, and registered frame
      * callback IDs for proper cleanup on disconnection.
+     *
+     * Negotiation state, tracks and subscriptions are guarded by `mutex`;
+     * the identity, connection, queue and estimator pointers are set before
+     * the context is published and never change.
      */
     struct PeerContext
     {
+        mutable std::mutex mutex; ///< Per-peer lock, never taken while holding peers_mutex_
+
         std::string client_id;                                               ///< Unique client identifier
         std::shared_ptr<rtc::PeerConnection> peer;                           ///< WebRTC peer connection
         std::shared_ptr<rtc::WebSocket> ws;                                  ///< Signaling WebSocket
-        std::unordered_map<std::string, std::shared_ptr<rtc::Track>> tracks; ///< camera_id → track
+        std::unordered_map<std::string, std::shared_ptr<rtc::Track>> tracks; ///< camera_id → track (kept once negotiated)
+        std::unordered_map<std::string, std::shared_ptr<PeerRtpState>> rtp_states; ///< camera_id → RTP state + NACK history
         std::chrono::steady_clock::time_point start_time;                    ///< Session start time
         bool ready = false;                                                  ///< True after SDP answer received
+        bool negotiating = false;                                            ///< Offer sent, answer pending
+        bool renegotiate_pending = false;                                    ///< Subscriptions changed mid-negotiation
+        std::shared_ptr<PeerSendQueue> send_queue;                           ///< Async per-track send lanes
+        std::shared_ptr<BandwidthEstimator> bwe;                             ///< REMB/loss estimate for this peer
+        std::unordered_map<std::string, std::shared_ptr<TrackRtcpStats>> rtcp_stats; ///< camera_id → receiver report
+
+        std::mutex candidates_mutex;                 ///< Guards the local candidate batch; may nest inside mutex, never around it
+        json pending_candidates = json::array();     ///< Local candidates not yet sent
+        bool candidate_flush_scheduled = false;      ///< Batch timer armed
+
+        /** @brief Frames currently queued for this peer across all tracks */
+        size_t queue_depth() const { return send_queue ? send_queue->depth() : 0; }
+
+        /** @brief Frames dropped by the send queue overflow policy */
+        uint64_t dropped_frames() const { return send_queue ? send_queue->dropped() : 0; }
+
+        /// One active fan-out subscription
+        struct Subscription
+        {
+            size_t camera; ///< Camera index
+            size_t layer;  ///< Simulcast layer currently received
+            CallbackId id; ///< Fan-out subscription ID
+        };
+
+        /// Active fan-out subscriptions, at most one per camera
+        std::vector<Subscription> subscriptions;
+
+        /// camera index → layer pinned by the client (absent = follow bandwidth)
+        std::unordered_map<size_t, size_t> pinned_layers;
+
+        /// camera index → codec chosen from the last answer (absent = camera codec, not answered yet)
+        std::unordered_map<size_t, VideoCodec> codecs;
+
+        /// camera index → view priority reported by the client (absent = normal)
+        std::unordered_map<size_t, ViewPriority> priorities;
 
-        /// Registered frame callback IDs for cleanup (camera_index, callback_id)
-        std::vector<std::pair<size_t, CallbackId>> callback_ids;
+        /** @brief Active subscription for camera @p index, or nullptr */
+        Subscription *subscription(size_t index)
+        {
+            auto it = std::find_if(subscriptions.begin(), subscriptions.end(),
+                                   [index](const auto &sub)
+                                   { return sub.camera == index; });
+            return it == subscriptions.end() ? nullptr : &*it;
+        }
+
+        /** @brief True if the peer currently receives camera @p index */
+        bool subscribed(size_t index) const
+        {
+            return std::any_of(subscriptions.begin(), subscriptions.end(),
+                               [index](const auto &sub)
+                               { return sub.camera == index; });
+        }
     };
 
     /**
      * @brief Manages WebRTC PeerConnection lifecycle for all clients
      *
      * Creates a PeerConnection per client with one SendOnly video track per
-     * camera. Handles the full WebRTC negotiation flow (offer → answer → ICE)
-     * and properly cleans up frame callbacks when clients disconnect.
+     * requested camera. Handles the full WebRTC negotiation flow (offer →
+     * answer → ICE), renegotiates when the client changes its camera set,
+     * and properly cleans up fan-out subscriptions when clients disconnect.
      *
      * Thread Safety:
-     *   - All public methods are thread-safe (protected by peers_mutex_)
+     *   - All public methods are thread-safe
+     *   - peers_mutex_ guards only the client map and is held for lookups;
+     *     each peer's negotiation runs under its own PeerContext::mutex
+     *   - Signaling messages and peer teardown run on SignalingWorkers,
+     *     in order per client and in parallel across clients
      *   - Frame callbacks are invoked from GStreamer pipeline threads
      */
     class PeerManager
     {
     public:
+        /**
+         * @param config   Application configuration
+         * @param cameras  Camera pipelines (outlive the manager)
+         * @param reactor  Event loop for the candidate batch timers (outlives the manager)
+         */
         PeerManager(const AppConfig &config,
-                    std::vector<std::unique_ptr<CameraPipeline>> &cameras);
+                    std::vector<std::unique_ptr<CameraPipeline>> &cameras,
+                    BusReactor &reactor);
         ~PeerManager();
 
         // Non-copyable, non-movable
@@ -76,19 +185,33 @@ namespace ist
         /**
          * @brief Create a new PeerConnection for a client
          *
-         * Sets up video tracks for all cameras, configures RTP packetization,
-         * registers frame callbacks, and initiates SDP offer generation.
+         * The first SDP offer is sent once the client's request_stream
+         * names the cameras it wants, or right after open_session() when
+         * fast connect is on and the URL names them.
          *
          * @param client_id  Unique client identifier
          * @param ws         Client's signaling WebSocket connection
          */
         void create_peer(const std::string &client_id, std::shared_ptr<rtc::WebSocket> ws);
 
+        /**
+         * @brief Start negotiating for a client whose WebSocket just opened
+         *
+         * With fast connect, a `cameras` query parameter in the WebSocket
+         * path is applied as the client's first request_stream, so the
+         * offer (and ICE gathering) no longer waits for a round trip.
+         *
+         * @param client_id  Client whose `version` / `camera_list` were sent
+         */
+        void open_session(const std::string &client_id);
+
         /**
          * @brief Remove a peer and clean up all associated resources
          *
-         * Unregisters all frame callbacks for this peer from camera pipelines
-         * to prevent callback accumulation, then closes the PeerConnection.
+         * The peer leaves the client map immediately; unsubscribing its
+         * tracks from the camera fan-outs and closing the PeerConnection
+         * run on the client's signaling worker after any message it sent
+         * before disconnecting.
          *
          * @param client_id  Client to remove
          */
@@ -96,26 +219,135 @@ namespace ist
 
         /**
          * @brief Handle an incoming signaling message from a client
+         *
+         * Blocks only on this client's own negotiation. Messages from the
+         * client's WebSocket are dispatched here from the worker pool.
+         *
          * @param client_id  Source client identifier
-         * @param msg        Parsed JSON message (type: answer, candidate, request_stream)
+         * @param msg        Parsed JSON message (type: answer, candidate, candidates, request_stream, priority)
          */
         void handle_message(const std::string &client_id, const json &msg);
 
         /** @brief Get the number of active peer connections */
         size_t peer_count() const;
 
+        /**
+         * @brief Log per-camera and per-peer latency percentiles
+         *
+         * Covers the interval since the previous call: capture → appsink,
+         * appsink → packetized per camera layer, and capture → sent per peer.
+         */
+        void log_latency_stats();
+
+        /**
+         * @brief Append fan-out and per-peer metric families for a scrape
+         *
+         * Covers subscribers and traffic per camera layer, and per peer the
+         * send throughput, queue depth, drops, bandwidth estimate, RTCP
+         * loss/jitter/RTT and send latency, plus connection setup and
+         * time-to-first-frame. Cumulative, unlike log_latency_stats().
+         * Never blocks on a peer's mutex; the RTCP series of a peer busy
+         * negotiating are omitted from that scrape.
+         */
+        void write_metrics(MetricsText &out) const;
+
     private:
-        /// Set up video tracks with H264RtpPacketizer for each camera
-        void setup_tracks(PeerContext &ctx);
+        /**
+         * @brief  Subscribe the peer to exactly the given cameras
+         *
+         * Adds or re-activates tracks for new cameras and sets dropped ones
+         * inactive. Caller holds ctx.mutex.
+         *
+         * @param  wanted  One flag per camera index
+         * @return true if the SDP needs renegotiating
+         */
+        bool update_subscriptions(PeerContext &ctx, const std::vector<bool> &wanted);
+
+        /// Add the track for camera @p index on first use (SDP m-line, ctx.mutex held)
+        std::shared_ptr<rtc::Track> add_track(PeerContext &ctx, size_t index);
+
+        /// Offer now, or once the outstanding answer arrives (ctx->mutex held)
+        void renegotiate(std::shared_ptr<PeerContext> ctx);
+
+        /// Enable RED/ULPFEC on the tracks whose answered m-line kept both codecs (ctx.mutex held)
+        static void apply_fec_negotiation(PeerContext &ctx, rtc::Description &answer);
+
+        /**
+         * @brief Pick each track's codec from the answered m-line (ctx.mutex held)
+         *
+         * The first of the camera's codecs (layer order, so the configured
+         * codec before the H.264 fallback) that the browser kept wins; a
+         * subscription on a layer of another codec moves to the best layer
+         * of the chosen one.
+         */
+        void apply_codec_negotiation(PeerContext &ctx, rtc::Description &answer);
+
+        /// Codec camera @p index is sent in to @p ctx (ctx.mutex held)
+        VideoCodec track_codec(const PeerContext &ctx, size_t index) const;
+
+        /// Unsubscribe every track, stop the send queue and close the connection
+        void close_peer(PeerContext &ctx);
+
+        /// Peers currently in the map (copied under peers_mutex_)
+        std::vector<std::shared_ptr<PeerContext>> snapshot_peers() const;
+
+        /// Send the batched local candidates as one message (ctx.candidates_mutex held)
+        static void flush_candidates(PeerContext &ctx);
 
         /// Generate and send SDP offer to the client
         void create_offer(std::shared_ptr<PeerContext> ctx);
 
+        /**
+         * @brief Retarget layers and encoder bitrates from the peers' estimates
+         *
+         * Each peer's estimate is split across the cameras it watches in
+         * proportion to their max bitrate, and capped by the camera's share
+         * of the uplink budget when one is configured. On simulcast cameras
+         * the peer is moved to the best layer that share fits (unless
+         * pinned); each layer's encoder then follows the configured viewer
+         * percentile (0 = weakest viewer). Rate-limited, and peers busy
+         * negotiating are skipped for the round, since it is driven from
+         * RTCP callbacks on libdatachannel threads.
+         */
+        void update_bitrates();
+
+        /**
+         * @brief  Split the uplink budget across the watched cameras
+         *
+         * A camera's priority is the highest any of @p peers gives it.
+         * Cameras every viewer has in the background drop to
+         * background_fps. Caller holds the peers' mutexes.
+         *
+         * @return kbps per camera index (0 = unwatched)
+         */
+        std::vector<int> allocate_budgets(const std::vector<std::shared_ptr<PeerContext>> &peers);
+
+        /// Best layer of camera @p index for a bandwidth share, with hysteresis (same codec as @p current)
+        size_t select_layer(size_t index, uint64_t share_kbps, size_t current) const;
+
+        /// Move a peer's subscription to another layer of the same camera (ctx.mutex held)
+        void switch_layer(PeerContext &ctx, PeerContext::Subscription &sub, size_t layer);
+
         AppConfig config_;
         std::vector<std::unique_ptr<CameraPipeline>> &cameras_;
+        std::vector<std::vector<std::unique_ptr<RtpFanout>>> fanouts_; ///< [camera][layer] shared packetizers
+        std::vector<rtc::Description::Video> media_templates_;         ///< [camera] m-line, copied per peer
+        BusReactor &reactor_;
+
+        LatencyHistogram setup_latency_;       ///< WebSocket connect → PeerConnection connected
+        LatencyHistogram first_frame_latency_; ///< WebSocket connect → first frame sent
 
         mutable std::mutex peers_mutex_;
         std::unordered_map<std::string, std::shared_ptr<PeerContext>> peers_;
+
+        std::atomic<int64_t> last_bitrate_update_ms_{0};
+        std::mutex bitrate_mutex_;                  ///< One update_bitrates() round at a time
+        std::vector<std::atomic<int>> budgets_kbps_; ///< [camera] last allocated budget (metrics)
+        static constexpr int64_t kBitrateUpdateIntervalMs = 1000;
+        static constexpr double kLayerDownFraction = 0.75; ///< Keep a layer until share < 75% of its bitrate
+
+        // Stopped at the start of ~PeerManager(), while everything its tasks use is alive
+        SignalingWorkers workers_;
     };
 
 } // namespace ist
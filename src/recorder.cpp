@@ -0,0 +1,432 @@
+/**
+ * @file    recorder.cpp
+ * @brief   Continuous disk recording of a camera's encoded stream implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "recorder.h"
+#include <gst/app/gstappsrc.h>
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+
+namespace ist
+{
+
+    Recorder::Recorder(const RecordingConfig &config, CameraPipeline &camera, BusReactor &reactor)
+        : config_(config), camera_(camera), reactor_(reactor), container_(config.container)
+    {
+        // AV1 in MPEG-TS is not widely supported by muxers or players
+        if (camera_.codec() == VideoCodec::AV1 && container_ == RecordContainer::MPEGTS)
+        {
+            spdlog::warn("[{}] AV1 is recorded as fmp4, not mpegts", camera_.id());
+            container_ = RecordContainer::FMP4;
+        }
+    }
+
+    Recorder::~Recorder()
+    {
+        stop();
+    }
+
+    bool Recorder::start()
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(config_.path, ec);
+        if (ec)
+        {
+            spdlog::error("[{}] Cannot create recording directory '{}': {}",
+                          camera_.id(), config_.path, ec.message());
+            return false;
+        }
+
+        // Bus watch and index are reactor-thread state; launch there too
+        running_.store(true);
+        bool ok = false;
+        reactor_.run_sync([this, &ok]()
+                          {
+            next_index_ = find_next_index();
+            ok = launch(); });
+        if (!ok)
+        {
+            running_.store(false);
+            return false;
+        }
+
+        callback_id_ = camera_.on_frame([this](const H264Frame &frame)
+                                        { on_frame(frame); });
+        // The first segment starts on a keyframe; do not wait a full GOP for it
+        camera_.request_keyframe(0);
+
+        spdlog::info("[{}] Recording to {} ({}, {} s segments, ring of {})",
+                     camera_.id(), location(),
+                     container_ == RecordContainer::FMP4 ? "fmp4" : "mpegts",
+                     config_.segment_seconds, config_.max_segments);
+        return true;
+    }
+
+    void Recorder::stop()
+    {
+        if (!running_.exchange(false))
+            return;
+
+        camera_.remove_callback(callback_id_, 0);
+        reactor_.run_sync([this]()
+                          {
+            reactor_.remove(restart_timer_);
+            restart_timer_ = 0;
+            reactor_.remove(bus_watch_id_);
+            bus_watch_id_ = 0; });
+
+        teardown(true);
+        spdlog::info("[{}] Recording stopped ({} frames, {} dropped, {} segments)",
+                     camera_.id(), frames_written(), frames_dropped(), segments_closed());
+    }
+
+    std::string Recorder::location() const
+    {
+        const char *ext = container_ == RecordContainer::FMP4 ? "mp4" : "ts";
+        return (std::filesystem::path(config_.path) / (camera_.id() + "_%05d." + ext)).string();
+    }
+
+    unsigned Recorder::find_next_index() const
+    {
+        const std::string prefix = camera_.id() + "_";
+        const std::string ext = container_ == RecordContainer::FMP4 ? ".mp4" : ".ts";
+
+        std::error_code ec;
+        std::filesystem::file_time_type newest_time;
+        long newest = -1;
+        for (const auto &entry : std::filesystem::directory_iterator(config_.path, ec))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.size() <= prefix.size() + ext.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+                name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
+                continue;
+
+            std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - ext.size());
+            if (digits.empty() || digits.find_first_not_of("0123456789") != std::string::npos)
+                continue;
+
+            auto mtime = entry.last_write_time(ec);
+            if (ec)
+                continue;
+            if (newest < 0 || mtime > newest_time)
+            {
+                newest = std::stol(digits);
+                newest_time = mtime;
+            }
+        }
+
+        if (newest < 0)
+            return 0;
+        auto next = static_cast<unsigned>(newest + 1);
+        return config_.max_segments > 0 ? next % static_cast<unsigned>(config_.max_segments) : next;
+    }
+
+    bool Recorder::launch()
+    {
+        // The camera's access units go straight to the muxer; the parser
+        // only inserts parameter sets per segment and fills in DTS
+        std::string caps = "video/x-h264,stream-format=byte-stream,alignment=au";
+        std::string parser = "h264parse config-interval=-1";
+        if (camera_.codec() == VideoCodec::H265)
+        {
+            caps = "video/x-h265,stream-format=byte-stream,alignment=au";
+            parser = "h265parse config-interval=-1";
+        }
+        else if (camera_.codec() == VideoCodec::AV1)
+        {
+            caps = "video/x-av1,stream-format=obu-stream,alignment=tu";
+            parser = "av1parse";
+        }
+        std::string desc =
+            "appsrc name=src is-live=true format=time do-timestamp=false "
+            "caps=\"" + caps + "\" "
+            "! " + parser + " "
+            "! splitmuxsink name=mux";
+
+        GError *error = nullptr;
+        GstElement *pipeline = gst_parse_launch(desc.c_str(), &error);
+        if (!pipeline || error)
+        {
+            spdlog::error("[{}] Failed to create recording pipeline: {}",
+                          camera_.id(), error ? error->message : "unknown");
+            if (error)
+                g_error_free(error);
+            if (pipeline)
+                gst_object_unref(pipeline);
+            return false;
+        }
+
+        bool fmp4 = container_ == RecordContainer::FMP4;
+        GstElement *mux = gst_bin_get_by_name(GST_BIN(pipeline), "mux");
+        GstElement *muxer = gst_element_factory_make(fmp4 ? "mp4mux" : "mpegtsmux", nullptr);
+        GstElement *sink = gst_element_factory_make("filesink", nullptr);
+        if (!mux || !muxer || !sink)
+        {
+            spdlog::error("[{}] Recording needs splitmuxsink, {} and filesink", camera_.id(),
+                          fmp4 ? "mp4mux" : "mpegtsmux");
+            if (mux)
+                gst_object_unref(mux);
+            if (muxer)
+                gst_object_unref(muxer);
+            if (sink)
+                gst_object_unref(sink);
+            gst_object_unref(pipeline);
+            return false;
+        }
+
+        // Fragmented MP4: moov up front, then self-contained fragments
+        if (fmp4)
+            g_object_set(muxer, "fragment-duration", static_cast<guint>(config_.fragment_ms), nullptr);
+
+        // Fully buffered writes: the disk sees large sequential chunks
+        // instead of one write per mux packet
+        gst_util_set_object_arg(G_OBJECT(sink), "buffer-mode", "full");
+        g_object_set(sink, "buffer-size", static_cast<guint>(config_.write_buffer_kb * 1024), nullptr);
+
+        std::string loc = location();
+        g_object_set(mux,
+                     "location", loc.c_str(),
+                     "max-size-time", static_cast<guint64>(config_.segment_seconds) * GST_SECOND,
+                     "max-files", static_cast<guint>(config_.max_segments),
+                     "start-index", static_cast<gint>(next_index_),
+                     "send-keyframe-requests", FALSE,
+                     "muxer", muxer,
+                     "sink", sink,
+                     nullptr);
+        gst_object_unref(mux);
+
+        GstElement *appsrc = gst_bin_get_by_name(GST_BIN(pipeline), "src");
+        if (gst_element_set_state(pipeline, GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE)
+        {
+            spdlog::error("[{}] Failed to start recording pipeline", camera_.id());
+            gst_element_set_state(pipeline, GST_STATE_NULL);
+            if (appsrc)
+                gst_object_unref(appsrc);
+            gst_object_unref(pipeline);
+            return false;
+        }
+
+        GstBus *bus = gst_element_get_bus(pipeline);
+        bus_watch_id_ = reactor_.watch_bus(bus, [this](GstMessage *msg)
+                                           { handle_bus_message(msg); });
+        gst_object_unref(bus);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pipeline_ = pipeline;
+            appsrc_ = appsrc;
+        }
+        rebase_.store(true);
+        return true;
+    }
+
+    void Recorder::teardown(bool drain)
+    {
+        GstElement *pipeline = nullptr;
+        GstElement *appsrc = nullptr;
+        {
+            // No frame is pushed once the elements are detached
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::swap(pipeline, pipeline_);
+            std::swap(appsrc, appsrc_);
+        }
+        if (!pipeline)
+            return;
+
+        // EOS lets the muxer finish the open segment (fMP4: last fragment)
+        if (drain && appsrc)
+        {
+            gst_app_src_end_of_stream(GST_APP_SRC(appsrc));
+            GstBus *bus = gst_element_get_bus(pipeline);
+            GstClockTime deadline = gst_util_get_timestamp() + kDrainTimeout;
+            bool done = false;
+            while (!done)
+            {
+                GstClockTime now = gst_util_get_timestamp();
+                if (now >= deadline)
+                {
+                    spdlog::warn("[{}] Recording did not drain in time, last segment may be truncated",
+                                 camera_.id());
+                    break;
+                }
+                GstMessage *msg = gst_bus_timed_pop(bus, deadline - now);
+                if (!msg)
+                    continue;
+                done = GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS || GST_MESSAGE_TYPE(msg) == GST_MESSAGE_ERROR;
+                gst_message_unref(msg);
+            }
+            gst_object_unref(bus);
+        }
+
+        gst_element_set_state(pipeline, GST_STATE_NULL);
+        if (appsrc)
+            gst_object_unref(appsrc);
+        gst_object_unref(pipeline);
+    }
+
+    void Recorder::schedule_restart()
+    {
+        if (restart_timer_ || !running_.load())
+            return;
+
+        spdlog::warn("[{}] Rebuilding recorder in {} ms", camera_.id(), kRestartDelayMs);
+        restart_timer_ = reactor_.add_timer(kRestartDelayMs, [this]()
+                                            {
+            restart_timer_ = 0;
+            reactor_.remove(bus_watch_id_);
+            bus_watch_id_ = 0;
+            teardown(false);
+            if (running_.load() && !launch())
+                schedule_restart();
+            return false; });
+    }
+
+    void Recorder::handle_bus_message(GstMessage *msg)
+    {
+        if (!running_.load())
+            return;
+
+        switch (GST_MESSAGE_TYPE(msg))
+        {
+        case GST_MESSAGE_ERROR:
+        {
+            GError *err = nullptr;
+            gchar *debug = nullptr;
+            gst_message_parse_error(msg, &err, &debug);
+            spdlog::error("[{}] Recording ERROR: {} (debug: {})",
+                          camera_.id(),
+                          err ? err->message : "unknown",
+                          debug ? debug : "none");
+            if (err)
+                g_error_free(err);
+            if (debug)
+                g_free(debug);
+
+            errors_.fetch_add(1, std::memory_order_relaxed);
+            schedule_restart();
+            break;
+        }
+
+        case GST_MESSAGE_WARNING:
+        {
+            GError *err = nullptr;
+            gchar *debug = nullptr;
+            gst_message_parse_warning(msg, &err, &debug);
+            spdlog::warn("[{}] Recording WARNING: {} (debug: {})",
+                         camera_.id(),
+                         err ? err->message : "unknown",
+                         debug ? debug : "none");
+            if (err)
+                g_error_free(err);
+            if (debug)
+                g_free(debug);
+            break;
+        }
+
+        case GST_MESSAGE_ELEMENT:
+        {
+            // splitmuxsink reports every segment it opens and closes
+            const GstStructure *s = gst_message_get_structure(msg);
+            if (s && gst_structure_has_name(s, "splitmuxsink-fragment-opened"))
+            {
+                next_index_++;
+                if (config_.max_segments > 0)
+                    next_index_ %= static_cast<unsigned>(config_.max_segments);
+            }
+            else if (s && gst_structure_has_name(s, "splitmuxsink-fragment-closed"))
+            {
+                segments_closed_.fetch_add(1, std::memory_order_relaxed);
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    void Recorder::on_frame(const H264Frame &frame)
+    {
+        if (!frame.buffer)
+            return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!appsrc_)
+            return;
+
+        if (rebase_.exchange(false))
+        {
+            waiting_keyframe_ = true;
+            have_base_ = false;
+            last_pts_ns_ = 0;
+        }
+
+        // Slow disk: drop whole GOPs rather than queueing without bound
+        auto *src = GST_APP_SRC(appsrc_);
+        if (gst_app_src_get_current_level_bytes(src) > static_cast<guint64>(config_.queue_kb) * 1024)
+        {
+            if (!waiting_keyframe_)
+                spdlog::warn("[{}] Recording queue full, dropping until the next keyframe", camera_.id());
+            waiting_keyframe_ = true;
+        }
+        if (waiting_keyframe_)
+        {
+            if (!frame.is_keyframe)
+            {
+                frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            waiting_keyframe_ = false;
+        }
+
+        // Recording time starts at 0 and only moves forward; a jump back
+        // (camera restarted) or a long gap continues one frame later
+        int64_t interval = 1'000'000'000LL / std::max(1, camera_.config().fps);
+        // Sources without a PTS fall back to the arrival clock; the
+        // jump handling below absorbs a switch between the two
+        auto ts = GST_CLOCK_TIME_IS_VALID(frame.timestamp)
+                      ? static_cast<int64_t>(frame.timestamp)
+                      : std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            frame.appsink_time.time_since_epoch())
+                            .count();
+        if (!have_base_)
+        {
+            base_ns_ = ts;
+            have_base_ = true;
+        }
+        else
+        {
+            int64_t delta = ts - base_ns_ - last_pts_ns_;
+            if (delta <= 0 || delta > kMaxTimestampJumpNs)
+                base_ns_ = ts - (last_pts_ns_ + interval);
+        }
+        last_pts_ns_ = ts - base_ns_;
+
+        // Zero-copy: the GstBuffer holds a reference to the frame payload
+        auto *hold = new std::shared_ptr<const FrameBuffer>(frame.buffer);
+        GstBuffer *buffer = gst_buffer_new_wrapped_full(
+            GST_MEMORY_FLAG_READONLY, const_cast<std::byte *>(frame.data()), frame.size(), 0, frame.size(), hold,
+            [](gpointer data)
+            { delete static_cast<std::shared_ptr<const FrameBuffer> *>(data); });
+        GST_BUFFER_PTS(buffer) = static_cast<GstClockTime>(last_pts_ns_);
+        GST_BUFFER_DURATION(buffer) = static_cast<GstClockTime>(interval);
+        if (!frame.is_keyframe)
+            GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+        // Never blocks: appsrc queues and its own thread muxes and writes
+        if (gst_app_src_push_buffer(src, buffer) == GST_FLOW_OK)
+            frames_written_.fetch_add(1, std::memory_order_relaxed);
+        else
+            frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+} // namespace ist
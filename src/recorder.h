@@ -0,0 +1,145 @@
+/**
+ * @file    recorder.h
+ * @brief   Continuous disk recording of a camera's encoded stream
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * A Recorder is one more frame callback on a CameraPipeline (layer 0). It
+ * writes the access units the camera already produces (H.264, H.265 or
+ * AV1, as layer 0 carries them) — no decode,
+ * no re-encode — into keyframe-aligned segments through a small pipeline
+ * of its own:
+ *
+ *   appsrc ! h264parse | h265parse | av1parse ! splitmuxsink (mpegtsmux | mp4mux fragmented → filesink)
+ *
+ * The callback only wraps the frame (zero-copy, the GstBuffer keeps the
+ * FrameBuffer alive) and queues it in appsrc; muxing and file I/O run on
+ * the appsrc streaming thread, so a slow disk never stalls the camera or
+ * the viewers. When the queue exceeds queue_kb, frames are dropped until
+ * the next keyframe so the recording never contains a broken GOP.
+ *
+ * Segments are cut on keyframes and written in write_buffer_kb chunks;
+ * once max_segments exist the oldest is overwritten, and a restarted
+ * server continues after the newest segment on disk. MPEG-TS segments are
+ * playable up to the last written packet after a crash; fMP4 up to the
+ * last completed fragment.
+ */
+
+#pragma once
+
+#include "config.h"
+#include "camera_pipeline.h"
+#include "bus_reactor.h"
+#include <gst/gst.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace ist
+{
+
+    /**
+     * @brief Segmented recorder for one camera
+     *
+     * Thread Safety:
+     *   - start() and stop() from the main thread
+     *   - The frame callback runs on the camera's streaming thread and only
+     *     takes a short lock to read the appsrc
+     *   - Bus messages and rebuilds after an error run on the reactor
+     *   - Stat getters may be called from any thread
+     */
+    class Recorder
+    {
+    public:
+        /**
+         * @param config   Recording settings (shared by all recorders)
+         * @param camera   Recorded camera (outlives the recorder)
+         * @param reactor  Event loop for the bus watch and rebuild timer (outlives the recorder)
+         */
+        Recorder(const RecordingConfig &config, CameraPipeline &camera, BusReactor &reactor);
+        ~Recorder();
+
+        // Non-copyable, non-movable
+        Recorder(const Recorder &) = delete;
+        Recorder &operator=(const Recorder &) = delete;
+
+        /**
+         * @brief  Build the recording pipeline and subscribe to the camera
+         * @return false if the directory or pipeline could not be created
+         */
+        bool start();
+
+        /** @brief Unsubscribe, finish the open segment (EOS), and tear down */
+        void stop();
+
+        const std::string &camera_id() const { return camera_.id(); }
+
+        /** @brief Frames queued for writing */
+        uint64_t frames_written() const { return frames_written_.load(std::memory_order_relaxed); }
+
+        /** @brief Frames dropped because the disk fell behind (or before the first keyframe) */
+        uint64_t frames_dropped() const { return frames_dropped_.load(std::memory_order_relaxed); }
+
+        /** @brief Segments completed and closed */
+        uint64_t segments_closed() const { return segments_closed_.load(std::memory_order_relaxed); }
+
+        /** @brief Pipeline errors (each one rebuilds the recorder) */
+        uint64_t errors() const { return errors_.load(std::memory_order_relaxed); }
+
+    private:
+        /// Create the pipeline and start it (main thread or reactor)
+        bool launch();
+
+        /// Set the pipeline to NULL and release it; @p drain sends EOS first
+        void teardown(bool drain);
+
+        /// Camera frame callback (streaming thread)
+        void on_frame(const H264Frame &frame);
+
+        /// Recorder bus message (reactor thread)
+        void handle_bus_message(GstMessage *msg);
+
+        /// Rebuild the pipeline after kRestartDelayMs (reactor thread)
+        void schedule_restart();
+
+        /// splitmuxsink location pattern for this camera
+        std::string location() const;
+
+        /// Index after the newest segment already on disk, so a restart continues the ring
+        unsigned find_next_index() const;
+
+        const RecordingConfig &config_;
+        CameraPipeline &camera_;
+        BusReactor &reactor_;
+        RecordContainer container_; ///< Configured container (AV1 forces FMP4)
+
+        std::mutex mutex_;              ///< Guards pipeline_ and appsrc_
+        GstElement *pipeline_ = nullptr;
+        GstElement *appsrc_ = nullptr;  ///< Referenced; frames are pushed here
+        unsigned bus_watch_id_ = 0;     ///< Reactor thread only
+        unsigned restart_timer_ = 0;    ///< Reactor thread only
+        unsigned next_index_ = 0;       ///< Segment index the next launch starts at (reactor thread)
+        CallbackId callback_id_ = 0;
+        std::atomic<bool> running_{false};
+
+        // Streaming thread only (reset through rebase_ on rebuild)
+        bool waiting_keyframe_ = true;
+        bool have_base_ = false;
+        int64_t base_ns_ = 0;  ///< Camera timestamp of recording time 0
+        int64_t last_pts_ns_ = 0;
+        std::atomic<bool> rebase_{true}; ///< Set by launch(): restart timestamps for the new pipeline
+
+        std::atomic<uint64_t> frames_written_{0};
+        std::atomic<uint64_t> frames_dropped_{0};
+        std::atomic<uint64_t> segments_closed_{0};
+        std::atomic<uint64_t> errors_{0};
+
+        static constexpr unsigned kRestartDelayMs = 5000;
+        static constexpr int64_t kMaxTimestampJumpNs = 5'000'000'000; ///< Larger gaps are a camera restart
+        static constexpr GstClockTime kDrainTimeout = 2 * GST_SECOND;
+    };
+
+} // namespace ist
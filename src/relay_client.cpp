@@ -0,0 +1,344 @@
+/**
+ * @file    relay_client.cpp
+ * @brief   Edge-side WebRTC client that pulls cameras from an origin server implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "relay_client.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ist
+{
+
+    using json = nlohmann::json;
+
+    std::shared_ptr<RelayClient> RelayClient::create(std::string origin_url,
+                                                     std::vector<CameraPipeline *> cameras,
+                                                     BusReactor &reactor)
+    {
+        return std::shared_ptr<RelayClient>(new RelayClient(std::move(origin_url), std::move(cameras), reactor));
+    }
+
+    RelayClient::RelayClient(std::string origin_url, std::vector<CameraPipeline *> cameras, BusReactor &reactor)
+        : origin_url_(std::move(origin_url)), cameras_(std::move(cameras)), reactor_(reactor)
+    {
+    }
+
+    RelayClient::~RelayClient()
+    {
+        stop();
+    }
+
+    void RelayClient::start()
+    {
+        connect();
+    }
+
+    void RelayClient::stop()
+    {
+        unsigned timer = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_)
+                return;
+            stopped_ = true;
+            std::swap(timer, reconnect_timer_);
+        }
+        if (timer)
+            reactor_.run_sync([this, timer]()
+                              { reactor_.remove(timer); });
+        disconnect();
+    }
+
+    CameraPipeline *RelayClient::camera_for(const std::string &origin_id) const
+    {
+        auto it = std::find_if(cameras_.begin(), cameras_.end(),
+                               [&origin_id](const CameraPipeline *camera)
+                               { return camera->config().relay_camera == origin_id; });
+        return it == cameras_.end() ? nullptr : *it;
+    }
+
+    void RelayClient::disconnect()
+    {
+        std::shared_ptr<rtc::WebSocket> ws;
+        std::shared_ptr<rtc::PeerConnection> pc;
+        std::vector<std::shared_ptr<rtc::Track>> tracks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            generation_++; // callbacks of the old connection are ignored from here on
+            ws.swap(ws_);
+            pc.swap(pc_);
+            tracks.swap(tracks_);
+        }
+        connected_.store(false);
+        for (auto *camera : cameras_)
+            camera->set_keyframe_forwarder(nullptr);
+
+        // Outside the lock: closing may invoke the (now stale) callbacks
+        if (pc)
+            pc->close();
+        if (ws)
+            ws->close();
+    }
+
+    void RelayClient::connect()
+    {
+        disconnect();
+
+        uint64_t generation;
+        auto ws = std::make_shared<rtc::WebSocket>();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopped_)
+                return;
+            generation = ++generation_;
+            ws_ = ws;
+        }
+
+        std::weak_ptr<RelayClient> weak = weak_from_this();
+        ws->onOpen([weak]()
+                   {
+            if (auto self = weak.lock())
+                spdlog::info("[{}] Origin signaling connected", self->origin_url_); });
+        ws->onClosed([weak, generation]()
+                     {
+            if (auto self = weak.lock())
+                self->schedule_reconnect(generation); });
+        ws->onError([weak, generation](std::string error)
+                    {
+            if (auto self = weak.lock())
+            {
+                spdlog::warn("[{}] Origin signaling error: {}", self->origin_url_, error);
+                self->schedule_reconnect(generation);
+            } });
+        ws->onMessage([weak, generation](rtc::message_variant data)
+                      {
+            auto self = weak.lock();
+            auto *text = std::get_if<std::string>(&data);
+            if (!self || !text)
+                return;
+            try {
+                self->handle_message(generation, json::parse(*text));
+            } catch (const std::exception &e) {
+                spdlog::error("[{}] Bad message from origin: {}", self->origin_url_, e.what());
+            } });
+
+        // Fast connect: the origin offers right after camera_list
+        std::string list;
+        for (const auto *camera : cameras_)
+            list += (list.empty() ? "" : ",") + camera->config().relay_camera;
+        std::string url = origin_url_ + (origin_url_.find('?') == std::string::npos ? "/?cameras=" : "&cameras=") + list;
+
+        spdlog::info("[{}] Connecting to origin for {} cameras", origin_url_, cameras_.size());
+        try
+        {
+            ws->open(url);
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::error("[{}] Failed to open origin signaling: {}", origin_url_, e.what());
+            schedule_reconnect(generation);
+        }
+    }
+
+    void RelayClient::schedule_reconnect(uint64_t generation)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopped_ || generation != generation_ || reconnect_timer_)
+            return;
+        connected_.store(false);
+
+        int delay = backoff_ms_;
+        backoff_ms_ = std::min(backoff_ms_ * 2, kMaxBackoffMs);
+        spdlog::warn("[{}] Origin connection lost, reconnecting in {} ms", origin_url_, delay);
+
+        std::weak_ptr<RelayClient> weak = weak_from_this();
+        reconnect_timer_ = reactor_.add_timer(static_cast<unsigned>(delay), [weak]()
+                                              {
+            if (auto self = weak.lock())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(self->mutex_);
+                    self->reconnect_timer_ = 0;
+                }
+                self->reconnects_.fetch_add(1);
+                self->connect();
+            }
+            return false; });
+    }
+
+    void RelayClient::send(uint64_t generation, const json &msg)
+    {
+        std::shared_ptr<rtc::WebSocket> ws;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (generation != generation_)
+                return;
+            ws = ws_;
+        }
+        try
+        {
+            if (ws && ws->isOpen())
+                ws->send(msg.dump());
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::error("[{}] Send to origin failed: {}", origin_url_, e.what());
+        }
+    }
+
+    void RelayClient::handle_message(uint64_t generation, const json &msg)
+    {
+        std::string type = msg.value("type", "");
+        if (type == "camera_list")
+        {
+            json request;
+            request["type"] = "request_stream";
+            request["cameras"] = json::array();
+            for (const auto *camera : cameras_)
+            {
+                const std::string &id = camera->config().relay_camera;
+                bool offered = false;
+                for (const auto &entry : msg.value("cameras", json::array()))
+                    offered = offered || (entry.is_object() && entry.value("id", "") == id);
+                if (!offered)
+                    spdlog::warn("[{}] Origin has no camera '{}' (for '{}')", origin_url_, id, camera->id());
+                request["cameras"].push_back(id);
+            }
+            // A no-op on the origin when the URL already named the same set
+            send(generation, request);
+        }
+        else if (type == "offer")
+        {
+            // Renegotiation offers reuse the connection. libdatachannel may
+            // call back (onTrack) from inside, so mutex_ is not held
+            std::shared_ptr<rtc::PeerConnection> pc;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (generation != generation_)
+                    return;
+                if (!pc_)
+                    create_peer_connection(generation);
+                pc = pc_;
+            }
+            // Relay cameras are H.264 passthrough: leave only H.264 in the
+            // offer so the origin sends its H.264 layer
+            rtc::Description offer(msg.value("sdp", ""), rtc::Description::Type::Offer);
+            for (int m = 0; m < offer.mediaCount(); m++)
+            {
+                auto entry = offer.media(m);
+                if (auto *media = std::get_if<rtc::Description::Media *>(&entry); media && *media)
+                {
+                    (*media)->removeFormat("H265");
+                    (*media)->removeFormat("AV1");
+                }
+            }
+            pc->setRemoteDescription(offer);
+        }
+        else if (type == "candidate" || type == "candidates")
+        {
+            std::shared_ptr<rtc::PeerConnection> pc;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (generation == generation_)
+                    pc = pc_;
+            }
+            auto add = [&pc](const json &entry)
+            {
+                if (pc && entry.contains("candidate") && entry["candidate"].is_string())
+                    pc->addRemoteCandidate(rtc::Candidate(entry["candidate"].get<std::string>(),
+                                                          entry.value("sdpMid", "")));
+            };
+            if (type == "candidate")
+                add(msg);
+            else
+                for (const auto &entry : msg.value("candidates", json::array()))
+                    add(entry);
+        }
+        else if (type == "error")
+        {
+            spdlog::error("[{}] Origin error: {}", origin_url_, msg.value("message", ""));
+        }
+    }
+
+    void RelayClient::create_peer_connection(uint64_t generation)
+    {
+        std::weak_ptr<RelayClient> weak = weak_from_this();
+        pc_ = std::make_shared<rtc::PeerConnection>(rtc::Configuration{});
+
+        pc_->onLocalDescription([weak, generation](rtc::Description desc)
+                                {
+            if (auto self = weak.lock())
+                self->send(generation, {{"type", desc.typeString()}, {"sdp", std::string(desc)}}); });
+        pc_->onLocalCandidate([weak, generation](rtc::Candidate candidate)
+                              {
+            if (auto self = weak.lock())
+                self->send(generation, {{"type", "candidate"}, {"candidate", std::string(candidate)},
+                                        {"sdpMid", candidate.mid()}}); });
+        pc_->onStateChange([weak, generation](rtc::PeerConnection::State state)
+                           {
+            auto self = weak.lock();
+            if (!self)
+                return;
+            if (state == rtc::PeerConnection::State::Connected)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(self->mutex_);
+                    if (generation != self->generation_)
+                        return;
+                    self->backoff_ms_ = kInitialBackoffMs;
+                }
+                self->connected_.store(true);
+                spdlog::info("[{}] Origin PeerConnection connected", self->origin_url_);
+            }
+            else if (state == rtc::PeerConnection::State::Failed ||
+                     state == rtc::PeerConnection::State::Disconnected ||
+                     state == rtc::PeerConnection::State::Closed)
+            {
+                self->schedule_reconnect(generation);
+            } });
+        pc_->onTrack([weak, generation](std::shared_ptr<rtc::Track> track)
+                     {
+            auto self = weak.lock();
+            if (!self)
+                return;
+            CameraPipeline *camera = self->camera_for(track->mid());
+            if (!camera)
+            {
+                spdlog::warn("[{}] Ignoring origin track '{}'", self->origin_url_, track->mid());
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(self->mutex_);
+                if (generation != self->generation_)
+                    return;
+                self->tracks_.push_back(track);
+            }
+
+            // Reassemble access units (Annex B, as the origin's appsink
+            // produced them); receiver reports keep the origin's NACK and
+            // bandwidth estimation working on the relay link
+            auto depacketizer = std::make_shared<rtc::H264RtpDepacketizer>(rtc::NalUnit::Separator::LongStartSequence);
+            depacketizer->addToChain(std::make_shared<rtc::RtcpReceivingSession>());
+            track->setMediaHandler(depacketizer);
+            track->onFrame([weak, camera](rtc::binary data, rtc::FrameInfo)
+                           {
+                if (auto self = weak.lock())
+                    self->frames_received_.fetch_add(1, std::memory_order_relaxed);
+                camera->push_frame(data.data(), data.size()); });
+
+            // Edge viewers' PLI/FIR become PLI towards the origin
+            camera->set_keyframe_forwarder([track_weak = std::weak_ptr(track)]()
+                                           {
+                auto t = track_weak.lock();
+                return t && t->isOpen() && t->requestKeyframe(); });
+
+            spdlog::info("[{}] Relaying origin camera '{}' as '{}'", self->origin_url_, track->mid(), camera->id()); });
+    }
+
+} // namespace ist
@@ -0,0 +1,126 @@
+/**
+ * @file    relay_client.h
+ * @brief   Edge-side WebRTC client that pulls cameras from an origin server
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * In relay mode the same binary runs as an edge server: its RELAY cameras
+ * are fed by one RelayClient per origin, which connects to the origin's
+ * signaling server exactly like a dashboard viewer (fast connect with
+ * `?cameras=`, request_stream, offer/answer, candidates) and hands every
+ * received H.264 access unit to the matching CameraPipeline without
+ * decoding. Downstream viewers are then served by the edge's own
+ * SignalingServer/PeerManager, so the origin sends each stream once no
+ * matter how many viewers the edge has.
+ *
+ * Keyframe requests from edge viewers are forwarded to the origin as PLI.
+ * A lost connection is re-established with exponential backoff.
+ */
+
+#pragma once
+
+#include "camera_pipeline.h"
+#include "bus_reactor.h"
+#include <rtc/rtc.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Receive-only connection to one origin server
+     *
+     * Thread Safety:
+     *   - start() and stop() from the main thread
+     *   - Callbacks run on libdatachannel threads and the reactor; they hold
+     *     only a weak reference and ignore connections replaced since
+     */
+    class RelayClient : public std::enable_shared_from_this<RelayClient>
+    {
+    public:
+        /**
+         * @param origin_url  Origin signaling URL (e.g., "ws://vehicle:8554")
+         * @param cameras     RELAY cameras fed from this origin (outlive the client)
+         * @param reactor     Event loop for reconnect timers (outlives the client)
+         */
+        static std::shared_ptr<RelayClient> create(std::string origin_url,
+                                                   std::vector<CameraPipeline *> cameras,
+                                                   BusReactor &reactor);
+
+        ~RelayClient();
+
+        // Non-copyable, non-movable
+        RelayClient(const RelayClient &) = delete;
+        RelayClient &operator=(const RelayClient &) = delete;
+
+        /** @brief Connect to the origin (reconnects on its own afterwards) */
+        void start();
+
+        /** @brief Close the connection and cancel reconnects; cameras stop receiving */
+        void stop();
+
+        const std::string &origin_url() const { return origin_url_; }
+
+        /** @brief True while the PeerConnection to the origin is connected */
+        bool connected() const { return connected_.load(); }
+
+        /** @brief Connection attempts after the first */
+        uint64_t reconnects() const { return reconnects_.load(); }
+
+        /** @brief Access units received from the origin, all cameras */
+        uint64_t frames_received() const { return frames_received_.load(std::memory_order_relaxed); }
+
+    private:
+        RelayClient(std::string origin_url, std::vector<CameraPipeline *> cameras, BusReactor &reactor);
+
+        /// Drop the current connection and open a new one (reactor or main thread)
+        void connect();
+
+        /// Close and release the current connection (connection state detached first)
+        void disconnect();
+
+        /// Reconnect after the backoff, unless stopped or already scheduled
+        void schedule_reconnect(uint64_t generation);
+
+        void handle_message(uint64_t generation, const nlohmann::json &msg);
+
+        /// Send on the signaling WebSocket of @p generation if it is still current
+        void send(uint64_t generation, const nlohmann::json &msg);
+
+        /// PeerConnection answering the origin's offers (mutex_ held)
+        void create_peer_connection(uint64_t generation);
+
+        /// Origin camera id → local camera, nullptr if not relayed
+        CameraPipeline *camera_for(const std::string &origin_id) const;
+
+        std::string origin_url_;
+        std::vector<CameraPipeline *> cameras_;
+        BusReactor &reactor_;
+
+        mutable std::mutex mutex_;
+        uint64_t generation_ = 0; ///< Bumped per connection; stale callbacks compare against it
+        std::shared_ptr<rtc::WebSocket> ws_;
+        std::shared_ptr<rtc::PeerConnection> pc_;
+        std::vector<std::shared_ptr<rtc::Track>> tracks_;
+        unsigned reconnect_timer_ = 0;
+        int backoff_ms_ = kInitialBackoffMs;
+        bool stopped_ = false;
+
+        std::atomic<bool> connected_{false};
+        std::atomic<uint64_t> reconnects_{0};
+        std::atomic<uint64_t> frames_received_{0};
+
+        static constexpr int kInitialBackoffMs = 1000;
+        static constexpr int kMaxBackoffMs = 30000;
+    };
+
+} // namespace ist
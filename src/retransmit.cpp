@@ -0,0 +1,83 @@
+/**
+ * @file    retransmit.cpp
+ * @brief   Shared retransmission cache and per-track NACK history implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "retransmit.h"
+
+namespace ist
+{
+
+    // ==================== RetransmitCache ====================
+
+    void RetransmitCache::retain(std::shared_ptr<const RtpPacketBatch> batch)
+    {
+        if (!enabled() || !batch)
+            return;
+
+        held_ += batch->storage.capacity();
+        batches_.push_back(std::move(batch));
+        while (held_ > budget_ && batches_.size() > 1)
+        {
+            held_ -= batches_.front()->storage.capacity();
+            batches_.pop_front();
+        }
+        bytes_.store(held_, std::memory_order_relaxed);
+    }
+
+    // ==================== RetransmitHistory ====================
+
+    RetransmitHistory::RetransmitHistory(size_t capacity)
+    {
+        if (capacity == 0)
+            return;
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        ring_.resize(size);
+        mask_ = size - 1;
+    }
+
+    void RetransmitHistory::record(const std::shared_ptr<const RtpPacketBatch> &batch, uint16_t first_seq,
+                                   uint32_t timestamp, bool red, size_t count)
+    {
+        if (!enabled() || count == 0)
+            return;
+
+        std::weak_ptr<const RtpPacketBatch> weak = batch;
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t k = 0; k < count; k++)
+        {
+            const uint16_t seq = static_cast<uint16_t>(first_seq + k);
+            auto &entry = ring_[seq & mask_];
+            entry.batch = weak;
+            entry.index = static_cast<uint32_t>(k);
+            entry.timestamp = timestamp;
+            entry.seq = seq;
+            entry.first_seq = first_seq;
+            entry.red = red;
+            entry.resends = 0;
+            entry.valid = true;
+        }
+    }
+
+    bool RetransmitHistory::find(uint16_t seq, Entry &out)
+    {
+        if (!enabled())
+            return false;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &entry = ring_[seq & mask_];
+        if (!entry.valid || entry.seq != seq || entry.resends >= kMaxResends)
+            return false;
+        entry.resends++;
+        out = entry;
+        return true;
+    }
+
+} // namespace ist
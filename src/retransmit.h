@@ -0,0 +1,111 @@
+/**
+ * @file    retransmit.h
+ * @brief   Shared retransmission cache and per-track NACK history
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Packets are packetized once per camera layer, so retransmission keeps
+ * them once as well: the RetransmitCache of each RtpFanout holds the most
+ * recent packet batches up to a byte budget, and each peer track only
+ * keeps a small ring that maps its own sequence numbers to (batch, packet)
+ * by weak reference. A NACKed packet is rebuilt with the peer's SSRC,
+ * sequence number and timestamp and sent again; once its batch has aged
+ * out of the camera cache the request is counted as a miss.
+ */
+
+#pragma once
+
+#include "rtp_packetizer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Recent packet batches of one camera layer, bounded by bytes
+     *
+     * Thread Safety:
+     *   - retain() only from the camera's streaming thread
+     *   - bytes() may be read from any thread
+     */
+    class RetransmitCache
+    {
+    public:
+        /** @param budget_bytes  Pooled capacity kept alive for retransmission (0 = disabled) */
+        explicit RetransmitCache(size_t budget_bytes) : budget_(budget_bytes) {}
+
+        bool enabled() const { return budget_ > 0; }
+
+        /** @brief Keep @p batch alive, dropping the oldest ones beyond the budget */
+        void retain(std::shared_ptr<const RtpPacketBatch> batch);
+
+        /** @brief Capacity currently held */
+        size_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    private:
+        size_t budget_;
+        std::deque<std::shared_ptr<const RtpPacketBatch>> batches_;
+        size_t held_ = 0;
+        std::atomic<size_t> bytes_{0};
+    };
+
+    /**
+     * @brief Sequence number → packet map of what one track sent
+     *
+     * Thread Safety:
+     *   - record() runs on the peer's send worker, find() on libdatachannel's
+     *     transport thread; both take a short internal lock
+     */
+    class RetransmitHistory
+    {
+    public:
+        static constexpr size_t kDefaultCapacity = 1024; ///< Packets (~32 KiB per track)
+        static constexpr uint8_t kMaxResends = 2;        ///< Per packet, against NACK storms
+
+        /// Everything needed to rebuild one sent packet
+        struct Entry
+        {
+            std::weak_ptr<const RtpPacketBatch> batch;
+            uint32_t index = 0;     ///< Packet index in the batch
+            uint32_t timestamp = 0; ///< Peer RTP timestamp
+            uint16_t seq = 0;       ///< Peer sequence number
+            uint16_t first_seq = 0; ///< Peer sequence number of packet 0 (FEC SN base)
+            bool red = false;       ///< Sent RED-encapsulated
+            uint8_t resends = 0;
+            bool valid = false;
+        };
+
+        /** @param capacity  Ring size, rounded up to a power of two (0 = disabled) */
+        explicit RetransmitHistory(size_t capacity = kDefaultCapacity);
+
+        bool enabled() const { return !ring_.empty(); }
+
+        /**
+         * @brief Remember the first @p count packets of @p batch as sent
+         *        with sequence numbers first_seq, first_seq + 1, ...
+         */
+        void record(const std::shared_ptr<const RtpPacketBatch> &batch, uint16_t first_seq,
+                    uint32_t timestamp, bool red, size_t count);
+
+        /**
+         * @brief  Look up a packet for retransmission
+         * @return false if unknown, overwritten, or already resent kMaxResends times
+         */
+        bool find(uint16_t seq, Entry &out);
+
+    private:
+        std::mutex mutex_;
+        std::vector<Entry> ring_;
+        size_t mask_ = 0;
+    };
+
+} // namespace ist
@@ -0,0 +1,173 @@
+/**
+ * @file    rtcp_feedback.cpp
+ * @brief   RTCP feedback parser implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "rtcp_feedback.h"
+#include <algorithm>
+#include <chrono>
+
+namespace ist
+{
+
+    // RTCP packet types (RFC 3550 / RFC 4585)
+    static constexpr uint8_t kRtcpSr = 200;    ///< Sender report
+    static constexpr uint8_t kRtcpRr = 201;    ///< Receiver report
+    static constexpr uint8_t kRtcpRtpfb = 205; ///< Transport-layer feedback
+    static constexpr uint8_t kRtcpPsfb = 206;  ///< Payload-specific feedback
+
+    // RTPFB feedback message types (FMT field)
+    static constexpr uint8_t kFmtNack = 1; ///< Generic NACK
+
+    // PSFB feedback message types (FMT field)
+    static constexpr uint8_t kFmtPli = 1;  ///< Picture Loss Indication
+    static constexpr uint8_t kFmtFir = 4;  ///< Full Intra Request
+    static constexpr uint8_t kFmtAfb = 15; ///< Application layer feedback (REMB)
+
+    static constexpr size_t kReportBlockSize = 24;
+
+    void RtcpFeedbackHandler::incoming(rtc::message_vector &messages, const rtc::message_callback &)
+    {
+        for (const auto &message : messages)
+        {
+            if (message && message->type == rtc::Message::Control)
+                parse_compound(message->data(), message->size());
+        }
+    }
+
+    void RtcpFeedbackHandler::parse_compound(const std::byte *data, size_t size)
+    {
+        auto u8 = [data](size_t i)
+        { return std::to_integer<uint8_t>(data[i]); };
+        auto u32 = [&u8](size_t i)
+        { return uint32_t(u8(i)) << 24 | uint32_t(u8(i + 1)) << 16 | uint32_t(u8(i + 2)) << 8 | u8(i + 3); };
+
+        bool keyframe_requested = false;
+
+        size_t offset = 0;
+        while (offset + 4 <= size)
+        {
+            uint8_t fmt = u8(offset) & 0x1F;
+            uint8_t pt = u8(offset + 1);
+            size_t length = (static_cast<size_t>(u8(offset + 2)) << 8 | u8(offset + 3)) * 4 + 4;
+            if (offset + length > size)
+                break; // truncated — ignore the rest
+
+            if (pt == kRtcpPsfb && (fmt == kFmtPli || fmt == kFmtFir))
+            {
+                keyframe_requested = true;
+            }
+            else if (pt == kRtcpRtpfb && fmt == kFmtNack && length >= 16 && on_nack_)
+            {
+                // header(4) sender(4) media(4), then PID(2) + BLP(2) per FCI:
+                // PID is lost, bit i of BLP means PID + i + 1 is lost too
+                std::vector<uint16_t> seqs;
+                for (size_t p = offset + 12; p + 4 <= offset + length; p += 4)
+                {
+                    uint16_t pid = static_cast<uint16_t>(u8(p) << 8 | u8(p + 1));
+                    uint16_t blp = static_cast<uint16_t>(u8(p + 2) << 8 | u8(p + 3));
+                    seqs.push_back(pid);
+                    for (int i = 0; i < 16; i++)
+                        if (blp & (1u << i))
+                            seqs.push_back(static_cast<uint16_t>(pid + i + 1));
+                }
+                on_nack_(u32(offset + 8), seqs);
+            }
+            else if (pt == kRtcpPsfb && fmt == kFmtAfb && length >= 20 && on_remb_)
+            {
+                // header(4) sender(4) media(4) "REMB"(4) num(1) exp:6|mantissa:18
+                size_t p = offset + 12;
+                if (u8(p) == 'R' && u8(p + 1) == 'E' && u8(p + 2) == 'M' && u8(p + 3) == 'B')
+                {
+                    uint8_t exp = u8(p + 5) >> 2;
+                    uint32_t mantissa = (uint32_t(u8(p + 5) & 0x03) << 16) |
+                                        (uint32_t(u8(p + 6)) << 8) | u8(p + 7);
+                    uint64_t bps = uint64_t(mantissa) << exp;
+                    on_remb_(static_cast<uint32_t>(std::min<uint64_t>(bps, UINT32_MAX)));
+                }
+            }
+            else if ((pt == kRtcpRr || pt == kRtcpSr) && on_report_)
+            {
+                // RR: header(4) sender(4); SR adds 20 bytes of sender info
+                size_t p = offset + (pt == kRtcpSr ? 28 : 8);
+                for (uint8_t i = 0; i < fmt && p + kReportBlockSize <= offset + length; i++)
+                {
+                    ReceptionReport report;
+                    report.ssrc = u32(p);
+                    report.fraction_lost = u8(p + 4);
+                    report.cumulative_lost = u32(p + 4) & 0x00FFFFFF;
+                    report.highest_seq = u32(p + 8);
+                    report.jitter = u32(p + 12);
+                    report.lsr = u32(p + 16);
+                    report.dlsr = u32(p + 20);
+                    on_report_(report);
+                    p += kReportBlockSize;
+                }
+            }
+
+            offset += length;
+        }
+
+        // One request per compound packet is enough
+        if (keyframe_requested && on_keyframe_request_)
+            on_keyframe_request_();
+    }
+
+    uint64_t ntp_now()
+    {
+        // NTP epoch is 1900-01-01, 2208988800 s before the Unix epoch
+        constexpr uint64_t kNtpUnixOffset = 2208988800ULL;
+        auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count();
+        uint64_t seconds = static_cast<uint64_t>(us / 1000000) + kNtpUnixOffset;
+        uint64_t fraction = (static_cast<uint64_t>(us % 1000000) << 32) / 1000000;
+        return seconds << 32 | fraction;
+    }
+
+    double round_trip_seconds(const RtcpFeedbackHandler::ReceptionReport &report)
+    {
+        if (report.lsr == 0)
+            return -1.0;
+
+        // All three values are in 1/65536 s; unsigned arithmetic handles wrap
+        uint32_t now_mid = static_cast<uint32_t>(ntp_now() >> 16);
+        uint32_t rtt = now_mid - report.lsr - report.dlsr;
+        if (rtt > 0x80000000u)
+            return -1.0; // clock step or bogus report
+        return static_cast<double>(rtt) / 65536.0;
+    }
+
+    rtc::binary build_sender_report(uint32_t ssrc, uint64_t ntp, uint32_t rtp_timestamp,
+                                    uint32_t packets, uint32_t octets)
+    {
+        rtc::binary out(28);
+        size_t p = 0;
+        auto put8 = [&out, &p](uint8_t v)
+        { out[p++] = std::byte{v}; };
+        auto put32 = [&put8](uint32_t v)
+        {
+            put8(uint8_t(v >> 24));
+            put8(uint8_t(v >> 16));
+            put8(uint8_t(v >> 8));
+            put8(uint8_t(v));
+        };
+
+        put8(0x80); // V=2, P=0, RC=0
+        put8(kRtcpSr);
+        put8(0);
+        put8(6); // length in 32-bit words minus one
+        put32(ssrc);
+        put32(static_cast<uint32_t>(ntp >> 32));
+        put32(static_cast<uint32_t>(ntp));
+        put32(rtp_timestamp);
+        put32(packets);
+        put32(octets);
+        return out;
+    }
+
+} // namespace ist
@@ -0,0 +1,107 @@
+/**
+ * @file    rtcp_feedback.h
+ * @brief   RTCP feedback parser attached to each outgoing video track
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * libdatachannel media handler that inspects RTCP packets arriving from
+ * the browser on a SendOnly track and turns them into server actions.
+ * Picture Loss Indication (PLI) and Full Intra Request (FIR) are reported
+ * as keyframe requests; generic NACKs as lists of lost sequence numbers;
+ * REMB and receiver report blocks feed bandwidth estimation. RTP packets
+ * pass through untouched. Helpers for building sender reports and deriving
+ * RTT from LSR/DLSR live here as well.
+ */
+
+#pragma once
+
+#include <rtc/rtc.hpp>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Media handler that surfaces RTCP feedback from a remote receiver
+     *
+     * Register callbacks before attaching the handler to a track; they are
+     * invoked from libdatachannel's transport threads.
+     */
+    class RtcpFeedbackHandler : public rtc::MediaHandler
+    {
+    public:
+        /// RTCP receiver report block (RFC 3550 §6.4.1)
+        struct ReceptionReport
+        {
+            uint32_t ssrc;          ///< Source the report is about
+            uint8_t fraction_lost;  ///< Loss since last report (0-255)
+            uint32_t cumulative_lost;
+            uint32_t highest_seq;   ///< Extended highest sequence number received
+            uint32_t jitter;        ///< Interarrival jitter (RTP timestamp units)
+            uint32_t lsr;           ///< Middle 32 bits of the last SR NTP timestamp
+            uint32_t dlsr;          ///< Delay since last SR (1/65536 s)
+        };
+
+        /// Invoked on PLI or FIR from the remote receiver
+        using KeyframeRequestCallback = std::function<void()>;
+
+        /// Invoked with the sequence numbers of a generic NACK (RFC 4585 §6.2.1)
+        using NackCallback = std::function<void(uint32_t media_ssrc, const std::vector<uint16_t> &seqs)>;
+
+        /// Invoked with the receiver's REMB estimate in bits per second
+        using RembCallback = std::function<void(uint32_t bps)>;
+
+        /// Invoked for each report block in an RR/SR from the receiver
+        using ReportCallback = std::function<void(const ReceptionReport &report)>;
+
+        /** @brief Register callback for PLI/FIR keyframe requests */
+        void on_keyframe_request(KeyframeRequestCallback cb) { on_keyframe_request_ = std::move(cb); }
+
+        /** @brief Register callback for NACKed packets */
+        void on_nack(NackCallback cb) { on_nack_ = std::move(cb); }
+
+        /** @brief Register callback for REMB bandwidth estimates */
+        void on_remb(RembCallback cb) { on_remb_ = std::move(cb); }
+
+        /** @brief Register callback for receiver report blocks */
+        void on_report(ReportCallback cb) { on_report_ = std::move(cb); }
+
+        /// Parse incoming RTCP, leaving the messages in place for later handlers
+        void incoming(rtc::message_vector &messages, const rtc::message_callback &send) override;
+
+    private:
+        /// Walk one compound RTCP packet
+        void parse_compound(const std::byte *data, size_t size);
+
+        KeyframeRequestCallback on_keyframe_request_;
+        NackCallback on_nack_;
+        RembCallback on_remb_;
+        ReportCallback on_report_;
+    };
+
+    /** @brief Current wall-clock time as a 64-bit NTP timestamp (RFC 3550 §4) */
+    uint64_t ntp_now();
+
+    /**
+     * @brief  Round-trip time derived from a report block's LSR/DLSR fields
+     * @return Seconds, or a negative value if the receiver has not seen an SR yet
+     */
+    double round_trip_seconds(const RtcpFeedbackHandler::ReceptionReport &report);
+
+    /**
+     * @brief  Build an RTCP sender report without report blocks (RFC 3550 §6.4.1)
+     * @param  ssrc          Sender SSRC
+     * @param  ntp           NTP timestamp of the report (see ntp_now())
+     * @param  rtp_timestamp RTP timestamp corresponding to @p ntp
+     * @param  packets       Sender packet count
+     * @param  octets        Sender payload octet count
+     */
+    rtc::binary build_sender_report(uint32_t ssrc, uint64_t ntp, uint32_t rtp_timestamp,
+                                    uint32_t packets, uint32_t octets);
+
+} // namespace ist
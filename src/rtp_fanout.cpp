@@ -0,0 +1,515 @@
+/**
+ * @file    rtp_fanout.cpp
+ * @brief   Per-camera shared RTP packetization implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "rtp_fanout.h"
+#include "send_queue.h"
+#include "rtcp_feedback.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+namespace ist
+{
+
+    RtpFanout::RtpFanout(size_t index, CameraPipeline &camera, size_t layer,
+                         size_t retransmit_budget, size_t fec_group)
+        : index_(index), camera_(camera), layer_(layer),
+          packetizer_(ssrc_for(index), payload_type_for(index, camera.layer_info(layer).codec), camera.buffer_pool(),
+                      VideoPacketizer::kDefaultMaxPayload, camera.layer_info(layer).codec),
+          retransmit_cache_(retransmit_budget),
+          epoch_(std::chrono::steady_clock::now())
+    {
+        if (fec_group > 0)
+            packetizer_.enable_fec(kUlpfecPayloadType, fec_group);
+    }
+
+    RtpFanout::~RtpFanout()
+    {
+        std::lock_guard<std::mutex> reg_lock(reg_mutex_);
+        if (camera_cb_id_ != 0)
+        {
+            camera_.remove_callback(camera_cb_id_, layer_);
+            camera_cb_id_ = 0;
+        }
+    }
+
+    CallbackId RtpFanout::subscribe(std::shared_ptr<rtc::Track> track,
+                                    std::shared_ptr<PeerRtpState> rtp,
+                                    std::shared_ptr<PeerSendQueue> queue)
+    {
+        auto state = std::make_shared<TrackState>();
+        state->camera_id = camera_.id();
+        state->track = track;
+        state->rtp = std::move(rtp);
+        state->frame_ticks = 90000 / static_cast<uint32_t>(std::max(1, camera_.config().fps));
+        state->traffic = traffic_;
+
+        size_t lane = queue->add_lane(camera_.id(),
+                                      [state](const std::shared_ptr<const RtpPacketBatch> &batch, size_t begin, size_t end)
+                                      { return send_batch(*state, batch, begin, end); },
+                                      std::chrono::microseconds(state->frame_ticks * 1000 / 90));
+
+        std::lock_guard<std::mutex> reg_lock(reg_mutex_);
+
+        CallbackId id = subscribers_.add({std::move(queue), lane, track,
+                                          std::make_shared<SubscriberState>()});
+
+        // First subscriber — start receiving frames from the camera
+        if (camera_cb_id_ == 0)
+        {
+            camera_cb_id_ = camera_.on_frame([this](const H264Frame &frame)
+                                             { on_frame(frame); },
+                                             layer_);
+        }
+
+        spdlog::debug("[{}] RTP fan-out subscriber id={} added", camera_.id(), id);
+        return id;
+    }
+
+    void RtpFanout::unsubscribe(CallbackId id)
+    {
+        std::lock_guard<std::mutex> reg_lock(reg_mutex_);
+
+        std::shared_ptr<PeerSendQueue> queue;
+        size_t lane = 0;
+        for (const auto &entry : *subscribers_.snapshot())
+        {
+            if (entry.id == id)
+            {
+                queue = entry.value.queue;
+                lane = entry.value.lane;
+                break;
+            }
+        }
+
+        // Wait out a frame in flight before closing the lane: add_lane()
+        // reuses closed slots, so a late push could otherwise land on the
+        // lane of another camera subscribed right after
+        subscribers_.remove(id, /*sync=*/true);
+        if (queue)
+            queue->remove_lane(lane);
+
+        // Last subscriber gone — stop packetizing frames nobody receives
+        if (subscribers_.size() == 0 && camera_cb_id_ != 0)
+        {
+            camera_.remove_callback(camera_cb_id_, layer_);
+            camera_cb_id_ = 0;
+        }
+    }
+
+    size_t RtpFanout::subscriber_count() const
+    {
+        return subscribers_.size();
+    }
+
+    RtpFanout::Traffic RtpFanout::traffic() const
+    {
+        return {traffic_->frames.load(std::memory_order_relaxed),
+                traffic_->packets.load(std::memory_order_relaxed),
+                traffic_->bytes.load(std::memory_order_relaxed)};
+    }
+
+    bool RtpFanout::request_keyframe(const rtc::Track *track)
+    {
+        auto subscribers = subscribers_.snapshot();
+        for (const auto &entry : *subscribers)
+        {
+            const auto &sub = entry.value;
+            if (sub.track.lock().get() != track)
+                continue;
+
+            if (camera_.request_keyframe(layer_))
+                return true;
+
+            // Passthrough source — resend the cached IDR to this track only (reprime)
+            auto now = std::chrono::steady_clock::now().time_since_epoch();
+            int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+
+            int64_t last_ms = sub.state->last_reprime_ms.load();
+            if (now_ms - last_ms >= kMinReprimeIntervalMs &&
+                sub.state->last_reprime_ms.compare_exchange_strong(last_ms, now_ms))
+            {
+                sub.state->reprime.store(true);
+                sub.state->primed.store(false);
+                spdlog::debug("[{}] Keyframe request on passthrough source, re-priming from cache",
+                              camera_.id());
+            }
+            return true;
+        }
+        return false;
+    }
+
+    uint32_t RtpFanout::canonical_timestamp(const H264Frame &frame)
+    {
+        if (!GST_CLOCK_TIME_IS_VALID(frame.timestamp))
+        {
+            // No PTS: 90kHz clock from elapsed time
+            auto elapsed = std::chrono::steady_clock::now() - epoch_;
+            auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+            return static_cast<uint32_t>(elapsed_us * 90 / 1000);
+        }
+
+        // ns → 90 kHz; wraps naturally in 32 bits like RTP itself
+        const uint64_t pts = frame.timestamp;
+        const uint32_t ticks = static_cast<uint32_t>(pts * 9 / 100000);
+
+        // A restart resets running time to 0 — continue one frame after the
+        // newest timestamp instead of jumping back. Passthrough streams with
+        // B-frames arrive in decode order, so a PTS somewhat older than the
+        // newest one is reordering and keeps its real spacing
+        constexpr uint64_t kMaxPtsJumpNs = 5ULL * 1000000000ULL;
+        constexpr uint64_t kMaxPtsReorderNs = 1000000000ULL;
+        const int restarts = camera_.restart_count();
+        const bool restarted = pts_mapped_ && restarts != pts_restarts_;
+        const bool backwards = pts + kMaxPtsReorderNs < newest_pts_;
+        const bool jump = pts > newest_pts_ && pts - newest_pts_ > kMaxPtsJumpNs;
+        pts_restarts_ = restarts;
+        if (!pts_mapped_ || restarted || backwards || jump)
+        {
+            uint32_t frame_ticks = 90000 / static_cast<uint32_t>(std::max(1, camera_.config().fps));
+            pts_offset_ = pts_mapped_ ? newest_timestamp_ + frame_ticks - ticks : 0;
+            if (pts_mapped_)
+                spdlog::debug("[{}] PTS discontinuity, rebasing RTP timestamps", camera_.id());
+            pts_mapped_ = true;
+            newest_pts_ = pts;
+        }
+
+        const uint32_t timestamp = ticks + pts_offset_;
+        if (pts >= newest_pts_)
+        {
+            newest_pts_ = pts;
+            newest_timestamp_ = timestamp;
+        }
+        return timestamp;
+    }
+
+    void RtpFanout::on_frame(const H264Frame &frame)
+    {
+        dispatch_latency_.record_since(frame.appsink_time);
+
+        std::shared_ptr<RtpPacketBatch> packets = packetize(frame, canonical_timestamp(frame));
+        if (!packets)
+            return;
+        packetize_latency_.record_since(frame.appsink_time);
+        std::shared_ptr<const RtpPacketBatch> batch = std::move(packets);
+        retransmit_cache_.retain(batch);
+
+        // Hand the shared batch to every peer's send worker (non-blocking)
+        auto subscribers = subscribers_.snapshot();
+        for (const auto &entry : *subscribers)
+        {
+            const auto &sub = entry.value;
+            if (!sub.state->primed.load())
+            {
+                // Nothing can be sent before the track opens; prime it from
+                // the cache on the first frame after it does
+                auto track = sub.track.lock();
+                if (!track || !track->isOpen())
+                    continue;
+                sub.state->primed.store(true);
+                if (sub.state->reprime.exchange(false))
+                    reprime(sub, frame, batch);
+                else
+                    prime(sub, frame, batch);
+                continue;
+            }
+            sub.queue->push(sub.lane, batch);
+        }
+    }
+
+    std::shared_ptr<RtpPacketBatch> RtpFanout::packetize(const H264Frame &frame, uint32_t timestamp)
+    {
+        // Packetize once into a single pooled block (single NAL / FU, AV1 OBU elements)
+        std::shared_ptr<RtpPacketBatch> batch;
+        try
+        {
+            batch = packetizer_.packetize(frame.data(), frame.size(), timestamp);
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::warn("[{}] RTP packetization failed: {}", camera_.id(), e.what());
+            return nullptr;
+        }
+        if (!batch)
+            return nullptr;
+
+        batch->is_keyframe = frame.is_keyframe;
+        batch->capture_time = frame.capture_time;
+        return batch;
+    }
+
+    /// True if @p cached is the cache entry of @p live (the IDR entry may be a copy with SPS/PPS prepended)
+    static bool same_frame(const H264Frame &cached, const H264Frame &live)
+    {
+        if (cached.buffer == live.buffer)
+            return true;
+        if (GST_CLOCK_TIME_IS_VALID(cached.timestamp) && GST_CLOCK_TIME_IS_VALID(live.timestamp))
+            return cached.timestamp == live.timestamp;
+        return cached.appsink_time == live.appsink_time;
+    }
+
+    void RtpFanout::prime(const Subscriber &sub, const H264Frame &live,
+                          const std::shared_ptr<const RtpPacketBatch> &live_batch)
+    {
+        auto cached = camera_.cached_frames(layer_);
+
+        // Nothing useful cached (or this frame is the cached IDR itself)
+        if (cached.empty() || (cached.size() == 1 && same_frame(cached.front(), live)))
+        {
+            sub.queue->push(sub.lane, live_batch);
+            return;
+        }
+
+        // Cache already ends with the live frame in GOP mode — do not send it twice
+        bool live_cached = same_frame(cached.back(), live);
+        if (live_cached)
+            cached.pop_back();
+
+        // Place cached frames behind the live timestamp using their PTS
+        // spacing, or the nominal frame interval when PTS is unavailable
+        const uint32_t frame_ticks = 90000 / static_cast<uint32_t>(std::max(1, camera_.config().fps));
+        std::vector<std::shared_ptr<const RtpPacketBatch>> replay;
+        replay.reserve(cached.size());
+        for (size_t k = 0; k < cached.size(); k++)
+        {
+            const auto &frame = cached[k];
+            uint32_t back_ticks;
+            if (GST_CLOCK_TIME_IS_VALID(frame.timestamp) && GST_CLOCK_TIME_IS_VALID(live.timestamp) &&
+                live.timestamp > frame.timestamp)
+            {
+                back_ticks = static_cast<uint32_t>((live.timestamp - frame.timestamp) * 90 / 1000000);
+            }
+            else
+            {
+                back_ticks = static_cast<uint32_t>(cached.size() - k) * frame_ticks;
+            }
+
+            if (auto batch = packetize(frame, live_batch->timestamp - back_ticks))
+            {
+                retransmit_cache_.retain(batch);
+                replay.push_back(std::move(batch));
+            }
+        }
+        sub.queue->push_replay(sub.lane, std::move(replay));
+        sub.queue->push(sub.lane, live_batch);
+
+        spdlog::debug("[{}] Primed new subscriber with {} cached frame(s)",
+                      camera_.id(), cached.size());
+    }
+
+    void RtpFanout::reprime(const Subscriber &sub, const H264Frame &live,
+                            const std::shared_ptr<const RtpPacketBatch> &live_batch)
+    {
+        auto cached = camera_.cached_frames(layer_);
+        if (live.is_keyframe || cached.empty() || !cached.front().is_keyframe)
+        {
+            sub.queue->push(sub.lane, live_batch);
+            return;
+        }
+
+        // The live timestamp is newer than anything the track has sent
+        auto batch = packetize(cached.front(), live_batch->timestamp);
+        if (!batch)
+        {
+            sub.queue->push(sub.lane, live_batch);
+            return;
+        }
+        retransmit_cache_.retain(batch);
+        sub.queue->push_replay(sub.lane, {std::move(batch)});
+
+        spdlog::debug("[{}] Re-primed subscriber with the cached keyframe", camera_.id());
+    }
+
+    size_t RtpFanout::send_batch(TrackState &state, const std::shared_ptr<const RtpPacketBatch> &batch_ptr,
+                                 size_t begin, size_t end)
+    {
+        auto track = state.track.lock();
+        if (!track || !track->isOpen())
+            return 0;
+
+        const RtpPacketBatch &batch = *batch_ptr;
+        auto &config = *state.rtp->config;
+
+        if (begin == 0)
+        {
+            // Anchor the peer's timestamp sequence at its own random start value,
+            // or one frame after the last one sent when the track already carried
+            // another layer (or an earlier subscription) so it never runs backwards
+            if (!state.timestamp_synced)
+            {
+                uint32_t anchor = config.timestamp == config.startTimestamp
+                                      ? config.startTimestamp
+                                      : config.timestamp + state.frame_ticks;
+                state.ts_offset = anchor - batch.timestamp;
+                state.timestamp_synced = true;
+            }
+            state.batch_timestamp = batch.timestamp + state.ts_offset;
+            state.batch_first_seq = config.sequenceNumber;
+            // FEC packets come last and only go to peers that negotiated RED
+            state.batch_red = state.rtp->red.load(std::memory_order_relaxed);
+            state.batch_packets = 0;
+            state.batch_open = true;
+        }
+        else if (!state.batch_open)
+            return 0; // Track opened mid-batch; start with the next one
+        const uint32_t timestamp = state.batch_timestamp;
+        const bool red = state.batch_red;
+
+        size_t sent_bytes = 0;
+        uint32_t sent_packets = 0;
+        try
+        {
+            for (size_t k = begin; k < end; k++)
+            {
+                if (batch.packets[k].fec && !red)
+                    break;
+
+                // libdatachannel takes ownership of what it sends, so each
+                // peer gets its own copy to rewrite
+                rtc::binary out = build_packet(batch, k, config.ssrc, config.sequenceNumber++,
+                                               timestamp, state.batch_first_seq, red);
+                auto *header = reinterpret_cast<rtc::RtpHeader *>(out.data());
+                size_t size = out.size();
+                size_t payload = size - header->getSize() - header->getExtensionHeaderSize();
+                track->send(std::move(out));
+                sent_bytes += size;
+                sent_packets++;
+                state.octets_sent += static_cast<uint32_t>(payload);
+            }
+            config.timestamp = timestamp;
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::warn("[{}] Failed to send frame: {}", state.camera_id, e.what());
+        }
+        state.batch_packets += sent_packets;
+
+        state.packets_sent += sent_packets;
+        state.traffic->packets.fetch_add(sent_packets, std::memory_order_relaxed);
+        state.traffic->bytes.fetch_add(sent_bytes, std::memory_order_relaxed);
+
+        if (end == batch.packets.size())
+        {
+            state.batch_open = false;
+            state.rtp->history.record(batch_ptr, state.batch_first_seq, timestamp, red, state.batch_packets);
+            if (state.batch_packets > 0)
+                state.traffic->frames.fetch_add(1, std::memory_order_relaxed);
+            maybe_send_report(state, *track);
+        }
+        return sent_bytes;
+    }
+
+    rtc::binary RtpFanout::build_packet(const RtpPacketBatch &batch, size_t index, uint32_t ssrc,
+                                        uint16_t seq, uint32_t timestamp, uint16_t first_seq, bool red)
+    {
+        constexpr size_t kHeader = VideoPacketizer::kRtpHeaderSize;
+        const auto &packet = batch.packets[index];
+        const std::byte *data = batch.data(packet);
+
+        rtc::binary out(packet.size + (red ? 1 : 0));
+        std::memcpy(out.data(), data, kHeader);
+        if (red)
+        {
+            // Single-block RED header (F=0) carrying the original payload type
+            out[1] = (data[1] & std::byte{0x80}) | std::byte{kRedPayloadType};
+            out[kHeader] = data[1] & std::byte{0x7F};
+            std::memcpy(out.data() + kHeader + 1, data + kHeader, packet.size - kHeader);
+        }
+        else
+        {
+            std::memcpy(out.data() + kHeader, data + kHeader, packet.size - kHeader);
+        }
+
+        auto *header = reinterpret_cast<rtc::RtpHeader *>(out.data());
+        header->setSsrc(ssrc);
+        header->setSeqNumber(seq);
+        header->setTimestamp(timestamp);
+
+        if (packet.fec)
+        {
+            auto u16 = [](const std::byte *p)
+            { return static_cast<uint16_t>(std::to_integer<uint16_t>(p[0]) << 8 | std::to_integer<uint16_t>(p[1])); };
+
+            // The protected packets keep their offsets from the batch start,
+            // and all share the frame timestamp: XOR is the timestamp itself
+            // for an odd number of packets, zero for an even one
+            std::byte *fec = out.data() + kHeader + (red ? 1 : 0);
+            const uint16_t canonical_first = u16(batch.data(batch.packets.front()) + 2);
+            const uint16_t sn_base = static_cast<uint16_t>(first_seq + (u16(fec + 2) - canonical_first));
+            const bool odd = std::bitset<16>(u16(fec + 12)).count() % 2 == 1;
+            const uint32_t ts_recovery = odd ? timestamp : 0;
+            fec[2] = std::byte(sn_base >> 8);
+            fec[3] = std::byte(sn_base & 0xFF);
+            fec[4] = std::byte(ts_recovery >> 24);
+            fec[5] = std::byte((ts_recovery >> 16) & 0xFF);
+            fec[6] = std::byte((ts_recovery >> 8) & 0xFF);
+            fec[7] = std::byte(ts_recovery & 0xFF);
+        }
+        return out;
+    }
+
+    RtpFanout::RetransmitResult RtpFanout::retransmit(PeerRtpState &rtp, rtc::Track &track,
+                                                      const std::vector<uint16_t> &seqs)
+    {
+        RetransmitResult result{0, 0};
+        if (!track.isOpen())
+            return result;
+
+        const uint32_t ssrc = rtp.config->ssrc;
+        for (uint16_t seq : seqs)
+        {
+            RetransmitHistory::Entry entry;
+            auto batch = rtp.history.find(seq, entry) ? entry.batch.lock() : nullptr;
+            if (!batch)
+            {
+                result.missed++;
+                continue;
+            }
+
+            // Same packet, same sequence number (RFC 4585 plain NACK, no RTX)
+            try
+            {
+                track.send(build_packet(*batch, entry.index, ssrc, entry.seq, entry.timestamp,
+                                        entry.first_seq, entry.red));
+                result.sent++;
+            }
+            catch (const std::exception &e)
+            {
+                result.missed++;
+                spdlog::debug("Retransmission on SSRC {} failed: {}", ssrc, e.what());
+                break;
+            }
+        }
+        return result;
+    }
+
+    void RtpFanout::maybe_send_report(TrackState &state, rtc::Track &track)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (now - state.last_sr < kSenderReportInterval)
+            return;
+        state.last_sr = now;
+
+        // The RTP timestamp of the last frame stands in for "now"; the
+        // offset is at most one frame interval, well below RTT resolution
+        const auto &config = *state.rtp->config;
+        try
+        {
+            track.send(build_sender_report(config.ssrc, ntp_now(), config.timestamp,
+                                           state.packets_sent, state.octets_sent));
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::debug("[{}] Failed to send sender report: {}", state.camera_id, e.what());
+        }
+    }
+
+} // namespace ist
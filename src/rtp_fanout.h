@@ -0,0 +1,327 @@
+/**
+ * @file    rtp_fanout.h
+ * @brief   Per-camera shared RTP packetization and fan-out to peers
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Packetizes each access unit exactly once per camera (NAL start code
+ * scan + FU fragmentation or AV1 OBU aggregation, into a pooled block)
+ * and fans the
+ * resulting RTP packets out
+ * to every subscribed peer track. Per peer only the SSRC, sequence number
+ * and timestamp header fields are rewritten before sending, so the cost
+ * of packetization no longer scales with the number of viewers. Sending
+ * happens on each peer's PeerSendQueue worker, never on the camera thread.
+ * Simulcast cameras have one fan-out per layer; a peer track switches
+ * layers by moving its subscription between them. Each subscribed track
+ * also emits an RTCP sender report about once a second so the receiver's
+ * report blocks carry LSR/DLSR for round-trip time measurement.
+ *
+ * NACKed packets are resent from a per-layer RetransmitCache shared by all
+ * subscribers. With ULPFEC enabled the batches also carry FEC packets;
+ * peers that negotiated RED/ULPFEC receive everything RED-encapsulated.
+ */
+
+#pragma once
+
+#include "camera_pipeline.h"
+#include "cow_registry.h"
+#include "latency_histogram.h"
+#include "rtp_packetizer.h"
+#include "retransmit.h"
+#include <rtc/rtc.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <chrono>
+
+namespace ist
+{
+
+    class PeerSendQueue;
+
+    /**
+     * @brief RTP state of one camera track on one peer
+     *
+     * Outlives individual subscriptions so sequence numbers, timestamps and
+     * the NACK history stay continuous across layer switches.
+     */
+    struct PeerRtpState
+    {
+        PeerRtpState(std::shared_ptr<rtc::RtpPacketizationConfig> config, size_t history_packets)
+            : config(std::move(config)), history(history_packets) {}
+
+        std::shared_ptr<rtc::RtpPacketizationConfig> config; ///< SSRC, sequence number, timestamp (send worker)
+        RetransmitHistory history;                            ///< Sent packets, for NACK (thread-safe)
+        std::atomic<bool> red{false};                         ///< Receiver negotiated RED + ULPFEC
+    };
+
+    /**
+     * @brief Shared packetization stage for a single camera layer
+     *
+     * Registers one frame callback on its CameraPipeline while at least one
+     * peer is subscribed, packetizes each frame with VideoPacketizer into the
+     * camera's BufferPool and queues the packets on every subscriber's send queue.
+     *
+     * Thread Safety:
+     *   - subscribe(), unsubscribe() are thread-safe and never block the
+     *     frame path (subscribers are a copy-on-write snapshot)
+     *   - Frames are packetized on the camera's streaming thread
+     *   - Header rewrite and track->send() run on the peer's send worker
+     */
+    class RtpFanout
+    {
+    public:
+        /**
+         * @param index   Camera index (selects SSRC 1000+i and H.264 payload type 100+i)
+         * @param camera  Camera pipeline to take frames from
+         * @param layer   Simulcast layer of the camera (0 = full quality)
+         * @param retransmit_budget  Batch capacity kept for NACK retransmission in bytes (0 = off)
+         * @param fec_group          Media packets per ULPFEC packet (0 = no FEC)
+         */
+        RtpFanout(size_t index, CameraPipeline &camera, size_t layer = 0,
+                  size_t retransmit_budget = 0, size_t fec_group = 0);
+        ~RtpFanout();
+
+        // Non-copyable, non-movable
+        RtpFanout(const RtpFanout &) = delete;
+        RtpFanout &operator=(const RtpFanout &) = delete;
+
+        /** @brief SSRC advertised for camera @p index */
+        static uint32_t ssrc_for(size_t index) { return static_cast<uint32_t>(1000 + index); }
+
+        // One pool over the dynamic range 96-127: shared types first,
+        // then one H.264 type per camera
+        static constexpr uint8_t kRedPayloadType = 96;       ///< RED (RFC 2198), same for every camera
+        static constexpr uint8_t kUlpfecPayloadType = 97;    ///< ULPFEC (RFC 5109), same for every camera
+        static constexpr uint8_t kH265PayloadType = 98;      ///< H.265 (RFC 7798), same for every camera
+        static constexpr uint8_t kAv1PayloadType = 99;       ///< AV1, same for every camera
+        static constexpr uint8_t kH264PayloadTypeBase = 100; ///< H.264 of camera i is base + i
+        static_assert(kH264PayloadTypeBase + kMaxCameras - 1 <= 127, "H.264 payload types overflow the dynamic range");
+
+        /** @brief RTP payload type advertised for @p codec on camera @p index (< kMaxCameras) */
+        static uint8_t payload_type_for(size_t index, VideoCodec codec = VideoCodec::H264)
+        {
+            if (codec == VideoCodec::H265)
+                return kH265PayloadType;
+            if (codec == VideoCodec::AV1)
+                return kAv1PayloadType;
+            return static_cast<uint8_t>(kH264PayloadTypeBase + index);
+        }
+
+        uint32_t ssrc() const { return ssrc_for(index_); }
+        uint8_t payload_type() const { return payload_type_for(index_, codec()); }
+        VideoCodec codec() const { return camera_.layer_info(layer_).codec; }
+        size_t layer() const { return layer_; }
+
+        /**
+         * @brief  Start sending this camera's packets to a peer track
+         * @param  track   SendOnly video track (no packetizer attached)
+         * @param  rtp     Per-peer RTP state (SSRC, sequence number, timestamp,
+         *                 NACK history); continues from it when switching layers
+         * @param  queue   Peer send queue; a lane is added for this track
+         * @return Subscription ID (used with unsubscribe)
+         */
+        CallbackId subscribe(std::shared_ptr<rtc::Track> track,
+                             std::shared_ptr<PeerRtpState> rtp,
+                             std::shared_ptr<PeerSendQueue> queue);
+
+        /**
+         * @brief Stop sending to a previously subscribed track
+         *
+         * Returns once the camera thread can no longer be dispatching a
+         * frame to the subscriber, then closes the track's lane on the peer
+         * send queue. Must not be called from inside a frame callback.
+         *
+         * @param id  Subscription ID returned by subscribe()
+         */
+        void unsubscribe(CallbackId id);
+
+        /** @brief Number of currently subscribed tracks */
+        size_t subscriber_count() const;
+
+        /**
+         * @brief Handle a PLI/FIR from one subscribed track
+         *
+         * Forces an encoder IDR when the camera supports it; for RTSP
+         * passthrough the track is re-primed from the keyframe cache on
+         * the next frame instead.
+         *
+         * @param  track  Track that received the request
+         * @return false if the track is not subscribed to this fan-out
+         */
+        bool request_keyframe(const rtc::Track *track);
+
+        /// Outcome of one NACK
+        struct RetransmitResult
+        {
+            size_t sent;   ///< Packets sent again
+            size_t missed; ///< Unknown, aged out of the cache or resent too often
+        };
+
+        /**
+         * @brief Resend NACKed packets of one track (libdatachannel thread)
+         *
+         * Works across layer switches: the history references batches of
+         * whichever fan-out sent them.
+         */
+        static RetransmitResult retransmit(PeerRtpState &rtp, rtc::Track &track,
+                                           const std::vector<uint16_t> &seqs);
+
+        /** @brief Batch capacity held for retransmission */
+        size_t retransmit_cache_bytes() const { return retransmit_cache_.bytes(); }
+
+        /** @brief Appsink → fan-out callback latency (streaming thread dispatch) */
+        LatencyHistogram &dispatch_latency() { return dispatch_latency_; }
+
+        /** @brief Appsink → packets ready latency (dispatch + packetization) */
+        LatencyHistogram &packetize_latency() { return packetize_latency_; }
+
+        /// Traffic counters summed over all subscribers
+        struct Traffic
+        {
+            uint64_t frames;  ///< Frames sent to tracks
+            uint64_t packets; ///< RTP packets sent to tracks
+            uint64_t bytes;   ///< RTP bytes sent to tracks
+        };
+
+        /** @brief Snapshot of the traffic sent by this fan-out */
+        Traffic traffic() const;
+
+    private:
+        /// Outgoing counters, written by send workers (relaxed)
+        struct TrafficCounters
+        {
+            std::atomic<uint64_t> frames{0};
+            std::atomic<uint64_t> packets{0};
+            std::atomic<uint64_t> bytes{0};
+        };
+
+        /// Per-track rewrite state, touched only from the peer's send worker
+        struct TrackState
+        {
+            std::string camera_id;
+            std::weak_ptr<rtc::Track> track;
+            std::shared_ptr<PeerRtpState> rtp;
+            bool timestamp_synced = false; ///< True once ts_offset has been derived
+            uint32_t ts_offset = 0;        ///< Peer timestamp minus canonical timestamp
+            uint32_t frame_ticks = 3000;   ///< Nominal frame interval (90 kHz) for layer switches
+
+            // Batch being sent, which the send queue may hand over in pieces
+            uint32_t batch_timestamp = 0; ///< Peer timestamp of the batch
+            uint16_t batch_first_seq = 0; ///< Peer sequence number of its first packet
+            bool batch_red = false;       ///< RED/ULPFEC decided when the batch started
+            uint32_t batch_packets = 0;   ///< Packets of it sent so far
+            bool batch_open = false;      ///< Its first packets went out on an open track
+
+            // Sender report state
+            uint32_t packets_sent = 0;
+            uint32_t octets_sent = 0; ///< RTP payload octets
+            std::chrono::steady_clock::time_point last_sr{};
+            std::shared_ptr<TrafficCounters> traffic;
+        };
+
+        /// Mutable per-subscriber flags shared between snapshots
+        struct SubscriberState
+        {
+            std::atomic<bool> primed{false};          ///< Join cache already replayed
+            std::atomic<bool> reprime{false};         ///< Unprimed by a PLI while already streaming
+            std::atomic<int64_t> last_reprime_ms{0};  ///< PLI fallback rate limit
+        };
+
+        struct Subscriber
+        {
+            std::shared_ptr<PeerSendQueue> queue;
+            size_t lane;                           ///< Lane index in queue
+            std::weak_ptr<rtc::Track> track;       ///< For the open check before priming
+            std::shared_ptr<SubscriberState> state;
+        };
+
+        /// Camera frame callback — packetize once, then fan out
+        void on_frame(const H264Frame &frame);
+
+        /**
+         * @brief Canonical 90 kHz RTP timestamp of a frame (streaming thread)
+         *
+         * Derived from the buffer PTS so the browser's jitter estimate sees
+         * real capture spacing. Rebased to continue after the newest
+         * timestamp on a pipeline restart or a PTS jump (over 1 s back or
+         * 5 s forward); B-frame reordering is kept as is. Falls back to the
+         * wall clock without PTS.
+         */
+        uint32_t canonical_timestamp(const H264Frame &frame);
+
+        /// Packetize one access unit at the given canonical RTP timestamp
+        std::shared_ptr<RtpPacketBatch> packetize(const H264Frame &frame, uint32_t timestamp);
+
+        /**
+         * @brief Replay the camera's keyframe/GOP cache into a new subscriber
+         *
+         * Runs on the streaming thread in place of the live push, so cached
+         * and live frames reach the lane in order without gaps or duplicates.
+         */
+        void prime(const Subscriber &sub, const H264Frame &live,
+                   const std::shared_ptr<const RtpPacketBatch> &live_batch);
+
+        /**
+         * @brief Answer a PLI on a source that cannot force an IDR (streaming thread)
+         *
+         * The track already carried later frames, so replaying the cached
+         * GOP at its original spacing would run the RTP timestamps
+         * backwards. Sends only the cached IDR, stamped with the live
+         * frame's timestamp, in place of that frame.
+         */
+        void reprime(const Subscriber &sub, const H264Frame &live,
+                     const std::shared_ptr<const RtpPacketBatch> &live_batch);
+
+        /// Rewrite headers and send packets [begin, end) of a batch on a single track; returns bytes sent
+        static size_t send_batch(TrackState &state, const std::shared_ptr<const RtpPacketBatch> &batch,
+                                 size_t begin, size_t end);
+
+        /**
+         * @brief Peer copy of packet @p index with its own SSRC/sequence/timestamp
+         *
+         * With @p red the payload is RED-encapsulated and FEC packets get the
+         * peer's SN base (@p first_seq + offset) and timestamp recovery.
+         */
+        static rtc::binary build_packet(const RtpPacketBatch &batch, size_t index, uint32_t ssrc,
+                                        uint16_t seq, uint32_t timestamp, uint16_t first_seq, bool red);
+
+        /// Send an RTCP sender report if the last one is older than kSenderReportInterval
+        static void maybe_send_report(TrackState &state, rtc::Track &track);
+
+        size_t index_;
+        CameraPipeline &camera_;
+        size_t layer_;
+
+        VideoPacketizer packetizer_; ///< Canonical stream state (streaming thread only)
+        RetransmitCache retransmit_cache_; ///< Recent batches for NACK (streaming thread only)
+        std::chrono::steady_clock::time_point epoch_;
+
+        // PTS → RTP timestamp mapping (streaming thread only)
+        bool pts_mapped_ = false;
+        uint64_t newest_pts_ = 0;       ///< Highest PTS since the last rebase (frames may arrive reordered)
+        uint32_t newest_timestamp_ = 0; ///< Canonical timestamp of newest_pts_
+        int pts_restarts_ = 0;          ///< camera_.restart_count() at the last frame
+        uint32_t pts_offset_ = 0; ///< Added to PTS ticks to get the canonical timestamp
+
+        LatencyHistogram dispatch_latency_;
+        LatencyHistogram packetize_latency_;
+        std::shared_ptr<TrafficCounters> traffic_ = std::make_shared<TrafficCounters>();
+
+        // Camera callback registration (never taken on the frame path, so
+        // it may be held while calling into CameraPipeline)
+        std::mutex reg_mutex_;
+        CallbackId camera_cb_id_ = 0; ///< Camera callback, 0 when not registered
+
+        CowRegistry<Subscriber> subscribers_; ///< Read lock-free on the frame path
+        static constexpr int64_t kMinReprimeIntervalMs = 1000; ///< Per-subscriber cache replay limit
+        static constexpr std::chrono::seconds kSenderReportInterval{1};
+    };
+
+} // namespace ist
@@ -0,0 +1,394 @@
+/**
+ * @file    rtp_packetizer.cpp
+ * @brief   H.264/H.265/AV1 RTP packetization implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "rtp_packetizer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ist
+{
+
+    static constexpr uint8_t kNalTypeFuA = 28;
+    static constexpr uint8_t kH265NalTypeFu = 49;
+    static constexpr size_t kMaxFuHeaderSize = 3; ///< H.265 payload header + FU header
+
+    // AV1 OBU types (AV1 spec §6.2.2) and the aggregation header bits (RTP spec §4.4)
+    static constexpr uint8_t kObuSequenceHeader = 1;
+    static constexpr uint8_t kObuTemporalDelimiter = 2;
+    static constexpr uint8_t kObuTileList = 8;
+    static constexpr uint8_t kObuPadding = 15;
+    static constexpr uint8_t kAv1Z = 0x80; ///< First element continues the previous packet's OBU
+    static constexpr uint8_t kAv1Y = 0x40; ///< Last element continues in the next packet
+    static constexpr uint8_t kAv1N = 0x08; ///< First packet of a coded video sequence
+
+    /// Bytes of the LEB128 encoding of @p value
+    static size_t leb128_size(size_t value)
+    {
+        size_t bytes = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            bytes++;
+        }
+        return bytes;
+    }
+
+    VideoPacketizer::VideoPacketizer(uint32_t ssrc, uint8_t payload_type, std::shared_ptr<BufferPool> pool,
+                                     size_t max_payload, VideoCodec codec)
+        : ssrc_(ssrc), payload_type_(payload_type), pool_(std::move(pool)),
+          max_payload_(std::max(max_payload, kMaxFuHeaderSize + 1)), codec_(codec)
+    {
+    }
+
+    void VideoPacketizer::scan(const std::byte *data, size_t size)
+    {
+        auto u8 = [data](size_t i)
+        { return std::to_integer<uint8_t>(data[i]); };
+
+        nals_.clear();
+        size_t nal_start = size; // first byte after the current start code
+        size_t i = 0;
+        while (i + 2 < size)
+        {
+            if (u8(i) == 0 && u8(i + 1) == 0 && u8(i + 2) == 1)
+            {
+                // A 4-byte start code's leading zero belongs to the delimiter
+                size_t end = (i > 0 && u8(i - 1) == 0) ? i - 1 : i;
+                if (nal_start < end)
+                    nals_.push_back({data + nal_start, end - nal_start});
+                nal_start = i + 3;
+                i += 3;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        if (nal_start < size)
+            nals_.push_back({data + nal_start, size - nal_start});
+    }
+
+    bool VideoPacketizer::aggregate_av1(const std::byte *data, size_t size)
+    {
+        auto u8 = [data](size_t i)
+        { return std::to_integer<uint8_t>(data[i]); };
+
+        // OBUs as RTP elements: size field dropped, obu_has_size_field cleared
+        obus_.clear();
+        obus_.reserve(size);
+        obu_sizes_.clear();
+        bool sequence_header = false;
+        for (size_t pos = 0; pos < size;)
+        {
+            const uint8_t header = u8(pos);
+            const uint8_t type = (header >> 3) & 0x0F;
+            const size_t header_size = (header & 0x04) ? 2 : 1;
+            if (pos + header_size > size)
+                break;
+
+            size_t payload_start = pos + header_size;
+            size_t payload_size = size - payload_start;
+            if (header & 0x02)
+            {
+                // leb128 obu_size
+                uint64_t value = 0;
+                size_t i = 0;
+                for (; i < 8 && payload_start + i < size; i++)
+                {
+                    value |= uint64_t(u8(payload_start + i) & 0x7F) << (7 * i);
+                    if (!(u8(payload_start + i) & 0x80))
+                        break;
+                }
+                payload_start += i + 1;
+                if (payload_start > size || value > size - payload_start)
+                    break; // truncated temporal unit: send what parsed
+                payload_size = static_cast<size_t>(value);
+            }
+
+            if (type != kObuTemporalDelimiter && type != kObuTileList && type != kObuPadding)
+            {
+                sequence_header |= type == kObuSequenceHeader;
+                obus_.push_back(std::byte(header & ~0x02));
+                if (header_size == 2)
+                    obus_.push_back(data[pos + 1]);
+                obus_.insert(obus_.end(), data + payload_start, data + payload_start + payload_size);
+                obu_sizes_.push_back(header_size + payload_size);
+            }
+            pos = payload_start + payload_size;
+        }
+        if (obu_sizes_.empty())
+            return false;
+
+        // Greedy fill: every element length-prefixed, the last one of a
+        // packet may continue in the next
+        av1_payloads_.clear();
+        const std::byte *obu = obus_.data();
+        size_t packet_start = 0;
+        size_t room = 0;
+        bool continues = false; // next packet starts inside an OBU
+        auto open_packet = [&]()
+        {
+            packet_start = av1_payloads_.size();
+            uint8_t aggregation = continues ? kAv1Z : 0;
+            if (payloads_.empty() && sequence_header)
+                aggregation |= kAv1N;
+            av1_payloads_.push_back(std::byte{aggregation});
+            room = max_payload_ - 1;
+        };
+        auto close_packet = [&]()
+        {
+            payloads_.push_back(av1_payloads_.size() - packet_start);
+        };
+
+        open_packet();
+        for (size_t k = 0; k < obu_sizes_.size(); k++)
+        {
+            size_t remaining = obu_sizes_[k];
+            while (remaining > 0)
+            {
+                if (room < 2)
+                {
+                    av1_payloads_[packet_start] |= std::byte{continues ? kAv1Y : uint8_t(0)};
+                    close_packet();
+                    open_packet();
+                }
+                size_t chunk = std::min(remaining, room - leb128_size(std::min(remaining, room)));
+                for (size_t value = chunk;; value >>= 7)
+                {
+                    const uint8_t byte = value & 0x7F;
+                    av1_payloads_.push_back(std::byte(value >= 0x80 ? byte | 0x80 : byte));
+                    if (value < 0x80)
+                        break;
+                }
+                av1_payloads_.insert(av1_payloads_.end(), obu, obu + chunk);
+                room -= leb128_size(chunk) + chunk;
+                obu += chunk;
+                remaining -= chunk;
+                continues = remaining > 0;
+            }
+        }
+        close_packet();
+        return true;
+    }
+
+    void VideoPacketizer::enable_fec(uint8_t payload_type, size_t group)
+    {
+        fec_payload_type_ = payload_type;
+        fec_group_ = std::min(group, kMaxFecGroup);
+    }
+
+    std::shared_ptr<RtpPacketBatch> VideoPacketizer::packetize(const std::byte *data, size_t size,
+                                                               uint32_t timestamp)
+    {
+        // H.265 NAL headers are two bytes; an FU repeats them as payload header plus one FU header
+        const size_t nal_header = codec_ == VideoCodec::H265 ? 2 : 1;
+        const size_t fu_header = nal_header + 1;
+        const size_t fragment = max_payload_ - fu_header;
+
+        // Media payload sizes first, so the batch takes a single exact block
+        payloads_.clear();
+        if (codec_ == VideoCodec::AV1)
+        {
+            if (!aggregate_av1(data, size))
+                return nullptr;
+        }
+        else
+        {
+            scan(data, size);
+            nals_.erase(std::remove_if(nals_.begin(), nals_.end(),
+                                       [nal_header](const Nal &nal)
+                                       { return nal.size < nal_header; }),
+                        nals_.end());
+            if (nals_.empty())
+                return nullptr;
+
+            for (const auto &nal : nals_)
+            {
+                if (nal.size <= max_payload_)
+                {
+                    payloads_.push_back(nal.size);
+                    continue;
+                }
+                for (size_t remaining = nal.size - nal_header; remaining > 0;)
+                {
+                    size_t chunk = std::min(remaining, fragment);
+                    payloads_.push_back(fu_header + chunk);
+                    remaining -= chunk;
+                }
+            }
+        }
+
+        const size_t media_count = payloads_.size();
+        size_t total = media_count * kRtpHeaderSize;
+        for (size_t payload : payloads_)
+            total += payload;
+
+        // One FEC packet per group; its payload is as long as the longest protected one
+        size_t fec_count = 0;
+        if (fec_group_ > 0)
+        {
+            for (size_t first = 0; first < media_count; first += fec_group_)
+            {
+                size_t last = std::min(first + fec_group_, media_count);
+                size_t protection = *std::max_element(payloads_.begin() + first, payloads_.begin() + last);
+                total += kRtpHeaderSize + kFecHeaderSize + kFecLevelHeaderSize + protection;
+                fec_count++;
+            }
+        }
+
+        auto batch = std::make_shared<RtpPacketBatch>();
+        batch->storage = pool_ ? pool_->acquire(total) : PooledBuffer::unpooled(total);
+        batch->packets.reserve(media_count + fec_count);
+        batch->timestamp = timestamp;
+        batch->bytes = total;
+
+        std::byte *base = batch->storage.data();
+        size_t offset = 0;
+
+        // Writes the fixed header (no marker) and returns the payload start
+        auto begin_packet = [&](uint8_t payload_type, size_t payload_size, bool fec) -> std::byte *
+        {
+            std::byte *p = base + offset;
+            const uint16_t seq = sequence_number_++;
+            p[0] = std::byte{0x80}; // V=2, no padding/extension/CSRC
+            p[1] = std::byte(payload_type & 0x7F);
+            p[2] = std::byte(seq >> 8);
+            p[3] = std::byte(seq & 0xFF);
+            p[4] = std::byte(timestamp >> 24);
+            p[5] = std::byte((timestamp >> 16) & 0xFF);
+            p[6] = std::byte((timestamp >> 8) & 0xFF);
+            p[7] = std::byte(timestamp & 0xFF);
+            p[8] = std::byte(ssrc_ >> 24);
+            p[9] = std::byte((ssrc_ >> 16) & 0xFF);
+            p[10] = std::byte((ssrc_ >> 8) & 0xFF);
+            p[11] = std::byte(ssrc_ & 0xFF);
+
+            const size_t packet_size = kRtpHeaderSize + payload_size;
+            batch->packets.push_back({static_cast<uint32_t>(offset), static_cast<uint32_t>(packet_size), fec});
+            offset += packet_size;
+            return p + kRtpHeaderSize;
+        };
+
+        if (codec_ == VideoCodec::AV1)
+        {
+            // Payloads were assembled by aggregate_av1()
+            const std::byte *payload = av1_payloads_.data();
+            for (size_t k = 0; k < media_count; k++)
+            {
+                std::memcpy(begin_packet(payload_type_, payloads_[k], false), payload, payloads_[k]);
+                payload += payloads_[k];
+            }
+        }
+        else
+        {
+            for (const auto &nal : nals_)
+            {
+                if (nal.size <= max_payload_)
+                {
+                    // Single NAL unit packet
+                    std::memcpy(begin_packet(payload_type_, nal.size, false), nal.data, nal.size);
+                    continue;
+                }
+
+                // H.264 FU-A: the NAL header is split into indicator (F, NRI) and FU header (type).
+                // H.265 FU: payload header is the NAL header with type 49, FU header carries the type
+                const uint8_t header = std::to_integer<uint8_t>(nal.data[0]);
+                const std::byte *payload = nal.data + nal_header;
+                size_t remaining = nal.size - nal_header;
+                bool first = true;
+                while (remaining > 0)
+                {
+                    const size_t chunk = std::min(remaining, fragment);
+                    uint8_t fu = codec_ == VideoCodec::H265 ? (header >> 1) & 0x3F : header & 0x1F;
+                    if (first)
+                        fu |= 0x80; // S
+                    if (chunk == remaining)
+                        fu |= 0x40; // E
+
+                    std::byte *p = begin_packet(payload_type_, fu_header + chunk, false);
+                    if (codec_ == VideoCodec::H265)
+                    {
+                        p[0] = std::byte{static_cast<uint8_t>((header & 0x81) | (kH265NalTypeFu << 1))};
+                        p[1] = nal.data[1]; // layer id low bits, TID
+                        p[2] = std::byte{fu};
+                    }
+                    else
+                    {
+                        p[0] = std::byte{static_cast<uint8_t>((header & 0xE0) | kNalTypeFuA)};
+                        p[1] = std::byte{fu};
+                    }
+                    std::memcpy(p + fu_header, payload, chunk);
+
+                    payload += chunk;
+                    remaining -= chunk;
+                    first = false;
+                }
+            }
+        }
+
+        // Marker on the last media packet of the access unit
+        base[batch->packets.back().offset + 1] |= std::byte{0x80};
+
+        // FEC packets follow the media packets, so a peer that skips them
+        // still sees contiguous sequence numbers
+        for (size_t first = 0; fec_group_ > 0 && first < media_count; first += fec_group_)
+        {
+            size_t count = std::min(fec_group_, media_count - first);
+            size_t protection = *std::max_element(payloads_.begin() + first, payloads_.begin() + first + count);
+            std::byte *p = begin_packet(fec_payload_type_, kFecHeaderSize + kFecLevelHeaderSize + protection, true);
+            write_fec(p, *batch, first, count, protection);
+        }
+        return batch;
+    }
+
+    void VideoPacketizer::write_fec(std::byte *out, const RtpPacketBatch &batch, size_t first, size_t count,
+                                    size_t protection_length)
+    {
+        // XOR of the protected packets' header fields and payloads (RFC 5109 §7.3-7.4)
+        uint8_t bits = 0;     // P, X, CC
+        uint8_t mpt = 0;      // M, PT
+        uint32_t ts = 0;
+        uint16_t length = 0;  // payload + CSRC + extension + padding
+        std::byte *xor_out = out + kFecHeaderSize + kFecLevelHeaderSize;
+        std::memset(xor_out, 0, protection_length);
+        for (size_t k = first; k < first + count; k++)
+        {
+            const auto &packet = batch.packets[k];
+            const std::byte *p = batch.data(packet);
+            bits ^= std::to_integer<uint8_t>(p[0]) & 0x3F;
+            mpt ^= std::to_integer<uint8_t>(p[1]);
+            ts ^= uint32_t(std::to_integer<uint8_t>(p[4])) << 24 | uint32_t(std::to_integer<uint8_t>(p[5])) << 16 |
+                  uint32_t(std::to_integer<uint8_t>(p[6])) << 8 | std::to_integer<uint8_t>(p[7]);
+            const size_t payload = packet.size - kRtpHeaderSize;
+            length ^= static_cast<uint16_t>(payload);
+            for (size_t i = 0; i < payload; i++)
+                xor_out[i] ^= p[kRtpHeaderSize + i];
+        }
+
+        const std::byte *first_packet = batch.data(batch.packets[first]);
+        const uint16_t mask = static_cast<uint16_t>(0xFFFF << (16 - count));
+
+        out[0] = std::byte(bits); // E=0, L=0 (16-bit mask)
+        out[1] = std::byte(mpt);
+        out[2] = first_packet[2]; // SN base = first protected sequence number
+        out[3] = first_packet[3];
+        out[4] = std::byte(ts >> 24);
+        out[5] = std::byte((ts >> 16) & 0xFF);
+        out[6] = std::byte((ts >> 8) & 0xFF);
+        out[7] = std::byte(ts & 0xFF);
+        out[8] = std::byte(length >> 8);
+        out[9] = std::byte(length & 0xFF);
+        out[10] = std::byte(protection_length >> 8);
+        out[11] = std::byte(protection_length & 0xFF);
+        out[12] = std::byte(mask >> 8);
+        out[13] = std::byte(mask & 0xFF);
+    }
+
+} // namespace ist
@@ -0,0 +1,142 @@
+/**
+ * @file    rtp_packetizer.h
+ * @brief   H.264/H.265/AV1 RTP packetization into pooled packet batches
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * RFC 6184 packetization (single NAL unit packets and FU-A fragments, as
+ * rtc::H264RtpPacketizer produces them) that writes all RTP packets of an
+ * access unit back to back into one block from the camera's BufferPool.
+ * H.265 follows RFC 7798 the same way (single NAL unit packets and FUs);
+ * AV1 follows the AOM RTP payload format: OBUs without size fields,
+ * length-prefixed (W=0) and fragmented across packets with the Z/Y bits.
+ * The libdatachannel packetizer allocates one message per packet on the
+ * streaming thread; with the pool a frame costs one recycled block and the
+ * batch bookkeeping, and the block returns to the pool when the last peer
+ * send worker drops the batch.
+ *
+ * Optionally appends ULPFEC packets (RFC 5109, one level, 16-bit mask)
+ * computed over groups of the frame's media packets. They are generated
+ * once per camera without the RED header; peers that negotiated RED wrap
+ * them (and the media packets) while rewriting, peers that did not skip them.
+ */
+
+#pragma once
+
+#include "buffer_pool.h"
+#include "config.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief RTP packets for one access unit, shared read-only across peers
+     *
+     * Packets carry the canonical camera SSRC, shared sequence numbers and
+     * the canonical RTP timestamp; subscribers rewrite them per peer.
+     */
+    struct RtpPacketBatch
+    {
+        /// Location of one complete RTP packet (header + payload) in storage
+        struct Packet
+        {
+            uint32_t offset;
+            uint32_t size;
+            bool fec = false; ///< ULPFEC packet (after all media packets)
+        };
+
+        PooledBuffer storage;        ///< All packets back to back
+        std::vector<Packet> packets; ///< In sending order
+        uint32_t timestamp = 0;      ///< Canonical RTP timestamp (90 kHz)
+        size_t bytes = 0;            ///< Total size of all packets (media + FEC)
+        bool is_keyframe = false;    ///< True if the access unit is an IDR
+        std::chrono::steady_clock::time_point capture_time; ///< Estimated capture instant (latency origin)
+
+        const std::byte *data(const Packet &packet) const { return storage.data() + packet.offset; }
+    };
+
+    /**
+     * @brief Canonical packetizer of one camera layer
+     *
+     * Thread Safety:
+     *   - Not thread-safe; owns the canonical sequence number and is only
+     *     used from the camera's streaming thread
+     *   - Returned batches are immutable and may be released on any thread
+     */
+    class VideoPacketizer
+    {
+    public:
+        static constexpr size_t kRtpHeaderSize = 12;
+        static constexpr size_t kDefaultMaxPayload = 1200; ///< Same as rtc::RtpPacketizer::DefaultMaxFragmentSize
+        static constexpr size_t kFecHeaderSize = 10;       ///< ULPFEC header (RFC 5109 §7.3)
+        static constexpr size_t kFecLevelHeaderSize = 4;   ///< Level 0 header with 16-bit mask
+        static constexpr size_t kMaxFecGroup = 16;         ///< Media packets covered by one 16-bit mask
+
+        /**
+         * @param ssrc          Canonical SSRC written into every packet
+         * @param payload_type  RTP payload type
+         * @param pool          Storage for the batches (nullptr = plain heap)
+         * @param max_payload   Largest RTP payload; bigger NAL units (OBUs) are fragmented
+         * @param codec         Payload format of the access units
+         */
+        VideoPacketizer(uint32_t ssrc, uint8_t payload_type, std::shared_ptr<BufferPool> pool,
+                        size_t max_payload = kDefaultMaxPayload, VideoCodec codec = VideoCodec::H264);
+
+        /**
+         * @brief Append ULPFEC packets to every batch
+         * @param payload_type  ULPFEC payload type written into the RTP header
+         * @param group         Media packets protected by one FEC packet (1-16, 0 = off)
+         */
+        void enable_fec(uint8_t payload_type, size_t group);
+
+        /**
+         * @brief  Packetize one access unit
+         * @param  data       Access unit (Annex B NAL units; AV1: a temporal unit of sized OBUs)
+         * @param  size       Access unit size in bytes
+         * @param  timestamp  RTP timestamp for all its packets
+         * @return Batch with the marker bit on the last packet, or nullptr
+         *         if the access unit contains no NAL unit (OBU)
+         */
+        std::shared_ptr<RtpPacketBatch> packetize(const std::byte *data, size_t size, uint32_t timestamp);
+
+    private:
+        struct Nal
+        {
+            const std::byte *data; ///< NAL header byte (start code stripped)
+            size_t size;
+        };
+
+        /// Split an Annex B access unit into nals_
+        void scan(const std::byte *data, size_t size);
+
+        /// Build the AV1 packet payloads into av1_payloads_ / payloads_; false if no OBU is sent
+        bool aggregate_av1(const std::byte *data, size_t size);
+
+        /// Write the FEC packet protecting media packets [first, first + count)
+        static void write_fec(std::byte *out, const RtpPacketBatch &batch, size_t first, size_t count,
+                              size_t protection_length);
+
+        uint32_t ssrc_;
+        uint8_t payload_type_;
+        std::shared_ptr<BufferPool> pool_;
+        size_t max_payload_;
+        VideoCodec codec_;
+        uint16_t sequence_number_ = 0;
+        uint8_t fec_payload_type_ = 0;
+        size_t fec_group_ = 0;        ///< 0 = no FEC
+        std::vector<Nal> nals_;       ///< Scratch list, reused across frames
+        std::vector<size_t> payloads_; ///< Scratch media payload sizes, reused across frames
+        std::vector<std::byte> obus_;         ///< Scratch AV1 OBUs without size fields (AV1)
+        std::vector<size_t> obu_sizes_;       ///< Size of each OBU in obus_ (AV1)
+        std::vector<std::byte> av1_payloads_; ///< Scratch AV1 packet payloads, back to back (AV1)
+    };
+
+} // namespace ist
@@ -0,0 +1,299 @@
+/**
+ * @file    send_queue.cpp
+ * @brief   Bounded per-peer asynchronous RTP send queue implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "send_queue.h"
+#include "thread_placement.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <tuple>
+
+namespace ist
+{
+
+    PeerSendQueue::PeerSendQueue(std::string client_id, size_t max_frames,
+                                 bool pacing, double spread, int max_kbps,
+                                 ThreadPolicy placement)
+        : client_id_(std::move(client_id)), max_frames_(std::max<size_t>(1, max_frames)),
+          pacer_(pacing, spread, max_kbps), placement_(std::move(placement))
+    {
+        worker_ = std::thread(&PeerSendQueue::worker_thread, this);
+    }
+
+    PeerSendQueue::~PeerSendQueue()
+    {
+        stop();
+    }
+
+    size_t PeerSendQueue::add_lane(const std::string &camera_id, SendFn fn,
+                                   std::chrono::microseconds frame_interval)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane lane;
+        lane.camera_id = camera_id;
+        lane.fn = std::make_shared<const SendFn>(std::move(fn));
+        lane.frame_interval = frame_interval;
+
+        // Reuse a removed slot so subscribe/unsubscribe cycles stay bounded
+        for (size_t i = 0; i < lanes_.size(); i++)
+        {
+            if (lanes_[i].closed)
+            {
+                lanes_[i] = std::move(lane);
+                return i;
+            }
+        }
+        lanes_.push_back(std::move(lane));
+        return lanes_.size() - 1;
+    }
+
+    void PeerSendQueue::remove_lane(size_t lane_idx)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (lane_idx >= lanes_.size())
+            return;
+
+        auto &lane = lanes_[lane_idx];
+        lane.queue.clear();
+        lane.replay_queued = 0;
+        lane.current.reset();
+        lane.fn.reset();
+        lane.closed = true;
+    }
+
+    void PeerSendQueue::push(size_t lane_idx, std::shared_ptr<const RtpPacketBatch> batch)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || lane_idx >= lanes_.size() || lanes_[lane_idx].closed)
+                return;
+
+            auto &lane = lanes_[lane_idx];
+            lane.enqueued++;
+
+            if (lane.waiting_for_keyframe)
+            {
+                if (!batch->is_keyframe)
+                {
+                    lane.dropped++;
+                    return;
+                }
+                lane.waiting_for_keyframe = false;
+            }
+
+            if (lane.queue.size() - lane.replay_queued >= max_frames_)
+            {
+                // Stale backlog is worthless for live video — flush it and
+                // resume at the next keyframe (or right now, if this is one)
+                lane.dropped += lane.queue.size();
+                lane.queue.clear();
+                lane.replay_queued = 0;
+                if (!batch->is_keyframe)
+                {
+                    lane.dropped++;
+                    lane.waiting_for_keyframe = true;
+                    spdlog::debug("[{}] Send queue overflow on '{}', waiting for keyframe",
+                                  client_id_, lane.camera_id);
+                    return;
+                }
+            }
+
+            lane.queue.emplace_back(std::move(batch), false);
+        }
+        cv_.notify_one();
+    }
+
+    void PeerSendQueue::push_replay(size_t lane_idx, std::vector<std::shared_ptr<const RtpPacketBatch>> batches)
+    {
+        if (batches.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || lane_idx >= lanes_.size() || lanes_[lane_idx].closed)
+                return;
+
+            auto &lane = lanes_[lane_idx];
+            for (auto &batch : batches)
+            {
+                lane.enqueued++;
+                lane.queue.emplace_back(std::move(batch), true);
+                lane.replay_queued++;
+            }
+            // A replay starts at an IDR, so any keyframe wait is satisfied
+            lane.waiting_for_keyframe = false;
+        }
+        cv_.notify_one();
+    }
+
+    void PeerSendQueue::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+
+        if (worker_.joinable())
+            worker_.join();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &lane : lanes_)
+        {
+            lane.queue.clear();
+            lane.current.reset();
+        }
+    }
+
+    size_t PeerSendQueue::depth() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t total = 0;
+        for (const auto &lane : lanes_)
+            total += lane.queue.size();
+        return total;
+    }
+
+    uint64_t PeerSendQueue::dropped() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint64_t total = 0;
+        for (const auto &lane : lanes_)
+            total += lane.dropped;
+        return total;
+    }
+
+    std::vector<PeerSendQueue::LaneStats> PeerSendQueue::stats() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<LaneStats> out;
+        out.reserve(lanes_.size());
+        for (const auto &lane : lanes_)
+        {
+            if (!lane.closed)
+                out.push_back({lane.camera_id, lane.queue.size(), lane.enqueued, lane.dropped});
+        }
+        return out;
+    }
+
+    bool PeerSendQueue::has_work() const
+    {
+        for (const auto &lane : lanes_)
+            if (!lane.closed && (lane.current || !lane.queue.empty()))
+                return true;
+        return false;
+    }
+
+    void PeerSendQueue::worker_thread()
+    {
+        spdlog::debug("[{}] Send worker started", client_id_);
+
+        // Workers are created on whichever thread accepted the client; all
+        // of them share one report entry
+        if (thread_placement_active())
+            apply_thread_policy(placement_, "send");
+
+        size_t next_lane = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            cv_.wait(lock, [this]
+                     { return stopping_ || has_work(); });
+            if (stopping_)
+                break;
+
+            // Pick the lane whose next packet is due first, round-robin
+            // among equals so one camera's large IDR cannot starve the others
+            auto now = RtpPacer::Clock::now();
+            size_t idx = lanes_.size();
+            RtpPacer::Clock::time_point due{};
+            for (size_t n = 0; n < lanes_.size(); n++)
+            {
+                size_t i = (next_lane + n) % lanes_.size();
+                auto &lane = lanes_[i];
+                if (lane.closed)
+                    continue;
+                if (!lane.current)
+                {
+                    if (lane.queue.empty())
+                        continue;
+                    std::tie(lane.current, lane.current_replay) = std::move(lane.queue.front());
+                    lane.queue.pop_front();
+                    if (lane.current_replay)
+                        lane.replay_queued--;
+                    lane.next_packet = 0;
+                    lane.current_bytes = 0;
+                    pacer_.begin_frame(lane.pacing, lane.current->packets.size(), lane.frame_interval,
+                                       lane.current_replay, now);
+                }
+                auto lane_due = pacer_.due(lane.pacing);
+                if (idx == lanes_.size() || lane_due < due)
+                {
+                    idx = i;
+                    due = lane_due;
+                }
+            }
+
+            // Nothing due yet: sleep until it is, unless a new frame comes in
+            if (due > now)
+            {
+                cv_.wait_until(lock, due);
+                pacer_.add_waited(RtpPacer::Clock::now() - now);
+                continue;
+            }
+
+            auto &lane = lanes_[idx];
+            next_lane = idx + 1;
+            auto batch = lane.current;
+            const bool is_replay = lane.current_replay;
+            const size_t total = batch->packets.size();
+            const size_t begin = lane.next_packet;
+            const size_t end = begin + pacer_.burst(lane.pacing, total - begin);
+            const size_t frame_bytes = lane.current_bytes;
+            lane.next_packet = end;
+            if (end == total)
+                lane.current.reset();
+
+            // Invoke the send function without the lock so push() from
+            // the streaming thread never waits on a slow track->send()
+            auto fn = lane.fn;
+            lock.unlock();
+            size_t sent = 0;
+            try
+            {
+                sent = (*fn)(batch, begin, end);
+                bytes_sent_.fetch_add(sent, std::memory_order_relaxed);
+                if (end == total)
+                {
+                    if (frame_bytes + sent > 0 &&
+                        frames_sent_.fetch_add(1, std::memory_order_relaxed) == 0 && on_first_frame_)
+                        on_first_frame_();
+                    if (!is_replay)
+                        send_latency_.record_since(batch->capture_time);
+                }
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::warn("[{}] Send worker error: {}", client_id_, e.what());
+            }
+            lock.lock();
+
+            // The lane may have been removed (or its slot reused) meanwhile
+            if (idx < lanes_.size() && lanes_[idx].fn == fn)
+            {
+                lanes_[idx].current_bytes += sent;
+                pacer_.sent(lanes_[idx].pacing, end - begin, sent, now);
+            }
+        }
+
+        spdlog::debug("[{}] Send worker exiting", client_id_);
+    }
+
+} // namespace ist
@@ -0,0 +1,190 @@
+/**
+ * @file    send_queue.h
+ * @brief   Bounded per-peer asynchronous RTP send queue
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Decouples the GStreamer streaming threads from track->send(). Each peer
+ * owns one queue with a bounded lane per track and a worker thread that
+ * drains the lanes, so a single viewer on a bad link can no longer back
+ * up the appsink for everyone else. On overflow a lane drops to the next
+ * keyframe instead of sending stale delta frames. The worker paces each
+ * lane's frame through the peer's RtpPacer and interleaves the lanes
+ * packet by packet, always sending the packet that is due first.
+ */
+
+#pragma once
+
+#include "rtp_fanout.h"
+#include "latency_histogram.h"
+#include "pacer.h"
+#include "config.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Per-peer bounded send queue drained by a dedicated worker thread
+     *
+     * Thread Safety:
+     *   - All public methods are thread-safe
+     *   - Send functions are invoked only on the worker thread
+     */
+    class PeerSendQueue
+    {
+    public:
+        /**
+         * Sends packets [begin, end) of a batch to a track and returns the
+         * bytes sent (worker thread). A batch arrives in order over one or
+         * more calls; begin == 0 starts it, end == packets.size() ends it.
+         */
+        using SendFn = std::function<size_t(const std::shared_ptr<const RtpPacketBatch> &, size_t begin, size_t end)>;
+
+        /// Called once, on the worker thread, after the first frame reaches a track
+        using FirstFrameFn = std::function<void()>;
+
+        /// Snapshot of a single lane's counters
+        struct LaneStats
+        {
+            std::string camera_id; ///< Camera feeding this lane
+            size_t depth;          ///< Frames currently queued
+            uint64_t enqueued;     ///< Frames offered to the lane
+            uint64_t dropped;      ///< Frames discarded by the overflow policy
+        };
+
+        /**
+         * @param client_id   Owning client (for logging)
+         * @param max_frames  Lane capacity in frames before dropping to the next keyframe
+         * @param pacing      Spread each frame's packets (see RtpPacer)
+         * @param spread      Fraction of the frame interval a frame is spread over
+         * @param max_kbps    Per-peer send-rate cap (0 = none)
+         * @param placement   CPU affinity / scheduling class of the worker thread
+         */
+        PeerSendQueue(std::string client_id, size_t max_frames,
+                      bool pacing = false, double spread = 0.5, int max_kbps = 0,
+                      ThreadPolicy placement = {});
+        ~PeerSendQueue();
+
+        // Non-copyable, non-movable
+        PeerSendQueue(const PeerSendQueue &) = delete;
+        PeerSendQueue &operator=(const PeerSendQueue &) = delete;
+
+        /**
+         * @brief  Add a lane for one track
+         * @param  camera_id       Camera feeding the lane (for stats)
+         * @param  fn              Function that sends a batch on the track
+         * @param  frame_interval  Nominal frame spacing of the camera (pacing window)
+         * @return Lane index (used with push); slots of removed lanes are reused
+         */
+        size_t add_lane(const std::string &camera_id, SendFn fn,
+                        std::chrono::microseconds frame_interval = std::chrono::microseconds(33333));
+
+        /** @brief Set the first-frame callback (before the first add_lane()) */
+        void on_first_frame(FirstFrameFn fn) { on_first_frame_ = std::move(fn); }
+
+        /**
+         * @brief Close a lane and discard its backlog
+         *
+         * Later pushes to the index are ignored until add_lane() reuses it.
+         * A call already in the send function completes; the rest of its
+         * batch is discarded.
+         */
+        void remove_lane(size_t lane);
+
+        /**
+         * @brief Queue a batch on a lane without blocking the caller
+         *
+         * If the lane is full its backlog is discarded; delta frames are then
+         * dropped until the next keyframe arrives so the decoder never sees a
+         * reference gap.
+         */
+        void push(size_t lane, std::shared_ptr<const RtpPacketBatch> batch);
+
+        /**
+         * @brief Queue a join-priming burst (cached IDR/GOP) on a lane
+         *
+         * Replayed frames do not count against the lane capacity, so priming
+         * a new viewer cannot trigger the overflow policy by itself.
+         */
+        void push_replay(size_t lane, std::vector<std::shared_ptr<const RtpPacketBatch>> batches);
+
+        /** @brief Stop the worker thread and discard queued batches */
+        void stop();
+
+        /** @brief Total frames currently queued across all lanes */
+        size_t depth() const;
+
+        /** @brief Total frames dropped across all lanes */
+        uint64_t dropped() const;
+
+        /** @brief Per-lane counters */
+        std::vector<LaneStats> stats() const;
+
+        /** @brief Capture → track->send() completion latency for live frames */
+        LatencyHistogram &send_latency() { return send_latency_; }
+
+        /** @brief Frames actually handed to a track (lock-free) */
+        uint64_t frames_sent() const { return frames_sent_.load(std::memory_order_relaxed); }
+
+        /** @brief RTP bytes actually handed to a track (lock-free) */
+        uint64_t bytes_sent() const { return bytes_sent_.load(std::memory_order_relaxed); }
+
+        /** @brief Packet pacing of this peer (for its counters) */
+        const RtpPacer &pacer() const { return pacer_; }
+
+    private:
+        struct Lane
+        {
+            std::string camera_id;
+            std::shared_ptr<const SendFn> fn;
+            std::chrono::microseconds frame_interval{33333};
+            std::deque<std::pair<std::shared_ptr<const RtpPacketBatch>, bool>> queue; ///< (batch, is_replay)
+            size_t replay_queued = 0;          ///< Replay entries still in queue
+            std::shared_ptr<const RtpPacketBatch> current; ///< Batch being sent, off the queue
+            bool current_replay = false;
+            size_t next_packet = 0;            ///< First unsent packet of current
+            size_t current_bytes = 0;          ///< Bytes of current sent so far
+            RtpPacer::Frame pacing;            ///< Pacing position within current
+            bool waiting_for_keyframe = false; ///< Overflow recovery in progress
+            bool closed = false;               ///< Removed; slot free for add_lane()
+            uint64_t enqueued = 0;
+            uint64_t dropped = 0;
+        };
+
+        /// Worker thread entry point — sends the lane whose next packet is due first
+        void worker_thread();
+
+        /// True if some open lane has a batch in progress or queued (mutex_ held)
+        bool has_work() const;
+
+        std::string client_id_;
+        size_t max_frames_;
+        RtpPacer pacer_; ///< Guarded by mutex_ (besides waited_seconds())
+        ThreadPolicy placement_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<Lane> lanes_;
+        bool stopping_ = false;
+        std::thread worker_;
+        FirstFrameFn on_first_frame_;
+
+        LatencyHistogram send_latency_; ///< Replayed (cached) frames excluded
+        std::atomic<uint64_t> frames_sent_{0};
+        std::atomic<uint64_t> bytes_sent_{0};
+    };
+
+} // namespace ist
@@ -91,9 +91,25 @@ namespace ist
                 cam_info["width"] = cam.width;
                 cam_info["height"] = cam.height;
                 cam_info["fps"] = cam.fps;
+                cam_info["codec"] = video_codec_name(cam.codec);
+
+                // Selectable layers, full quality first (pin via request_stream "layers")
+                cam_info["layers"] = json::array();
+                cam_info["layers"].push_back({{"name", "full"}, {"width", cam.width}, {"height", cam.height}, {"bitrate", cam.bitrate}});
+                for (const auto& layer : cam.simulcast) {
+                    cam_info["layers"].push_back({{"name", layer.name},
+                                                  {"width", (cam.width / layer.scale) & ~1},
+                                                  {"height", (cam.height / layer.scale) & ~1},
+                                                  {"bitrate", layer.bitrate}});
+                }
                 msg["cameras"].push_back(cam_info);
             }
             send_to_client(client_id, msg);
+
+            // Fast connect: the peer manager may offer right behind the list
+            if (on_open_) {
+                on_open_(client_id);
+            }
         });
 
         ws->onMessage([this, client_id](auto data) {
@@ -155,13 +171,13 @@ namespace ist
                 // Forward SDP answer to peer manager via on_connect callback
                 // The peer manager handles this directly via the WebSocket
             }
-            else if (type == "candidate")
+            else if (type == "candidate" || type == "candidates")
             {
-                // ICE candidate also handled directly
+                // ICE candidates (single or batched) also handled directly
             }
             else if (type == "request_stream")
             {
-                // Client is requesting video streams - handled in on_connect
+                // Camera subscription set - handled by PeerManager (renegotiates)
                 spdlog::info("[{}] Stream requested", client_id);
             }
             else
@@ -33,6 +33,10 @@ namespace ist
     using ClientConnectCallback = std::function<void(const std::string &client_id,
                                                      std::shared_ptr<rtc::WebSocket> ws)>;
 
+    /// Callback invoked once the client's WebSocket handshake completed and
+    /// `version` / `camera_list` were sent
+    using ClientOpenCallback = std::function<void(const std::string &client_id)>;
+
     /// Callback invoked when a client disconnects (clean close or error)
     using ClientDisconnectCallback = std::function<void(const std::string &client_id)>;
 
@@ -69,6 +73,9 @@ namespace ist
         /** @brief Register callback for new client connections */
         void on_client_connect(ClientConnectCallback cb) { on_connect_ = std::move(cb); }
 
+        /** @brief Register callback for opened client connections */
+        void on_client_open(ClientOpenCallback cb) { on_open_ = std::move(cb); }
+
         /** @brief Register callback for client disconnections */
         void on_client_disconnect(ClientDisconnectCallback cb) { on_disconnect_ = std::move(cb); }
 
@@ -93,6 +100,7 @@ namespace ist
         std::unordered_map<std::string, std::shared_ptr<rtc::WebSocket>> clients_;
 
         ClientConnectCallback on_connect_;
+        ClientOpenCallback on_open_;
         ClientDisconnectCallback on_disconnect_;
 
         int client_counter_ = 0; ///< Monotonic counter for unique client IDs
@@ -0,0 +1,119 @@
+/**
+ * @file    signaling_workers.cpp
+ * @brief   Per-client serialized signaling worker pool implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "signaling_workers.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+namespace ist
+{
+
+    SignalingWorkers::SignalingWorkers(size_t threads)
+    {
+        threads = std::max<size_t>(1, threads);
+        for (size_t i = 0; i < threads; i++)
+            threads_.emplace_back(&SignalingWorkers::worker_thread, this);
+        spdlog::debug("Signaling workers started ({} threads)", threads);
+    }
+
+    SignalingWorkers::~SignalingWorkers()
+    {
+        stop();
+    }
+
+    bool SignalingWorkers::post(const std::string &key, Task task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return false;
+
+            auto &strand = strands_[key];
+            strand.tasks.push_back(std::move(task));
+            pending_++;
+            if (strand.scheduled)
+                return true; // runs after the key's current task
+            strand.scheduled = true;
+            ready_.push_back(key);
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    void SignalingWorkers::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+        }
+        cv_.notify_all();
+
+        for (auto &thread : threads_)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+    }
+
+    size_t SignalingWorkers::pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+    void SignalingWorkers::worker_thread()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true)
+        {
+            // Drain everything queued before exiting on stop()
+            cv_.wait(lock, [this]
+                     { return !ready_.empty() || (stopping_ && pending_ == 0); });
+            if (ready_.empty())
+                break;
+
+            std::string key = std::move(ready_.front());
+            ready_.pop_front();
+            auto &strand = strands_[key];
+            Task task = std::move(strand.tasks.front());
+            strand.tasks.pop_front();
+
+            lock.unlock();
+            try
+            {
+                task();
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::error("[{}] Signaling task failed: {}", key, e.what());
+            }
+            lock.lock();
+
+            pending_--;
+            auto it = strands_.find(key);
+            if (!it->second.tasks.empty())
+            {
+                // Back of the line, so one chatty client cannot starve the others
+                ready_.push_back(key);
+                cv_.notify_one();
+            }
+            else
+            {
+                strands_.erase(it);
+            }
+
+            if (stopping_ && pending_ == 0)
+                cv_.notify_all();
+        }
+    }
+
+} // namespace ist
@@ -0,0 +1,86 @@
+/**
+ * @file    signaling_workers.h
+ * @brief   Small thread pool that runs signaling work serialized per client
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * SDP and ICE handling (setRemoteDescription, addRemoteCandidate, track
+ * setup and offer generation) can take milliseconds per call. Running it
+ * on libdatachannel's WebSocket thread serializes every client behind the
+ * slowest one, which hurts most when all control room clients reconnect
+ * at once after a network blip. Tasks posted with the same key (client
+ * ID) run one at a time in posting order; different keys run in parallel.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Fixed-size worker pool with per-key ordering
+     *
+     * Thread Safety:
+     *   - post() may be called from any thread, including a worker
+     *   - stop() must not be called from a worker
+     */
+    class SignalingWorkers
+    {
+    public:
+        /// Unit of signaling work
+        using Task = std::function<void()>;
+
+        /** @param threads  Worker count (at least 1) */
+        explicit SignalingWorkers(size_t threads);
+
+        /** @brief Equivalent to stop() */
+        ~SignalingWorkers();
+
+        // Non-copyable, non-movable
+        SignalingWorkers(const SignalingWorkers &) = delete;
+        SignalingWorkers &operator=(const SignalingWorkers &) = delete;
+
+        /**
+         * @brief  Queue @p task behind every earlier task with the same @p key
+         * @return false once stop() has begun (the task is not run)
+         */
+        bool post(const std::string &key, Task task);
+
+        /** @brief Run every task already queued, then join the workers */
+        void stop();
+
+        /** @brief Tasks queued or running */
+        size_t pending() const;
+
+    private:
+        /// Tasks of one key; scheduled while queued in ready_ or running
+        struct Strand
+        {
+            std::deque<Task> tasks;
+            bool scheduled = false;
+        };
+
+        void worker_thread();
+
+        mutable std::mutex mutex_;
+        std::condition_variable cv_;
+        std::unordered_map<std::string, Strand> strands_;
+        std::deque<std::string> ready_; ///< Keys with work and no running task, FIFO
+        size_t pending_ = 0;
+        bool stopping_ = false;
+        std::vector<std::thread> threads_;
+    };
+
+} // namespace ist
@@ -0,0 +1,220 @@
+/**
+ * @file    thread_placement.cpp
+ * @brief   CPU affinity and scheduling class for server threads implementation
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ */
+
+#include "thread_placement.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace ist
+{
+
+    /// One placed thread as shown in the startup report
+    struct PlacedThread
+    {
+        std::string label;
+        long tid = 0;
+        std::string cpus;  ///< Effective mask after applying
+        std::string sched; ///< Effective class and priority
+    };
+
+    static std::mutex g_placement_mutex;
+    static std::vector<PlacedThread> g_placed; ///< By label; restarted threads replace their entry
+    static cpu_set_t g_process_mask;
+    static cpu_set_t g_default_mask; ///< Process mask minus the control CPUs, for policies without CPUs
+    static bool g_have_process_mask = false;
+    static std::atomic<bool> g_placement_active{false};
+
+    static std::vector<int> mask_cpus(const cpu_set_t &mask)
+    {
+        std::vector<int> cpus;
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if (CPU_ISSET(cpu, &mask))
+                cpus.push_back(cpu);
+        return cpus;
+    }
+
+    static std::string describe_sched(int policy, int priority)
+    {
+        switch (policy)
+        {
+        case SCHED_FIFO:
+            return "SCHED_FIFO " + std::to_string(priority);
+        case SCHED_RR:
+            return "SCHED_RR " + std::to_string(priority);
+        case SCHED_OTHER:
+            return "SCHED_OTHER";
+        default:
+            return "policy " + std::to_string(policy);
+        }
+    }
+
+    std::string format_cpu_list(const std::vector<int> &cpus)
+    {
+        if (cpus.empty())
+            return "all";
+
+        // Collapse runs: 0,1,2,5 → "0-2,5"
+        std::string out;
+        for (size_t i = 0; i < cpus.size();)
+        {
+            size_t j = i;
+            while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+                j++;
+            out += (out.empty() ? "" : ",") + std::to_string(cpus[i]);
+            if (j > i)
+                out += "-" + std::to_string(cpus[j]);
+            i = j + 1;
+        }
+        return out;
+    }
+
+    void init_thread_placement(const AppConfig &config)
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_placement_mutex);
+            CPU_ZERO(&g_process_mask);
+            g_have_process_mask = sched_getaffinity(0, sizeof(g_process_mask), &g_process_mask) == 0;
+
+            // Unpinned streaming and send threads keep off the control
+            // CPUs, unless that would leave them nothing to run on
+            g_default_mask = g_process_mask;
+            for (int cpu : config.threads.control.cpus)
+                if (cpu >= 0 && cpu < CPU_SETSIZE)
+                    CPU_CLR(cpu, &g_default_mask);
+            if (CPU_COUNT(&g_default_mask) == 0)
+                g_default_mask = g_process_mask;
+        }
+
+        bool active = config.threads.control.configured() || config.threads.send.configured() ||
+                      std::any_of(config.cameras.begin(), config.cameras.end(),
+                                  [](const CameraConfig &cam)
+                                  { return cam.threads.configured(); });
+        g_placement_active.store(active);
+
+        // Threads created from here on inherit the control placement
+        if (config.threads.control.configured())
+            apply_thread_policy(config.threads.control, "main");
+    }
+
+    bool thread_placement_active()
+    {
+        return g_placement_active.load();
+    }
+
+    bool apply_thread_policy(const ThreadPolicy &policy, const std::string &label, bool report)
+    {
+        bool ok = true;
+
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        bool set_mask = true;
+        if (policy.cpus.empty())
+        {
+            std::lock_guard<std::mutex> lock(g_placement_mutex);
+            set_mask = g_have_process_mask;
+            mask = g_default_mask;
+        }
+        else
+        {
+            for (int cpu : policy.cpus)
+                CPU_SET(cpu, &mask);
+        }
+        if (set_mask)
+        {
+            int rc = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+            if (rc != 0)
+            {
+                spdlog::warn("[{}] Cannot pin thread to CPUs {}: {}", label,
+                             format_cpu_list(policy.cpus), std::strerror(rc));
+                ok = false;
+            }
+        }
+
+        if (policy.policy != SchedPolicy::INHERIT)
+        {
+            int sched = policy.policy == SchedPolicy::FIFO ? SCHED_FIFO
+                        : policy.policy == SchedPolicy::RR ? SCHED_RR
+                                                           : SCHED_OTHER;
+            sched_param param{};
+            param.sched_priority = sched == SCHED_OTHER ? 0 : policy.priority;
+            int rc = pthread_setschedparam(pthread_self(), sched, &param);
+            if (rc != 0)
+            {
+                spdlog::warn("[{}] Cannot set {}: {}{}", label, describe_sched(sched, param.sched_priority),
+                             std::strerror(rc),
+                             rc == EPERM ? " (needs CAP_SYS_NICE or an rtprio limit)" : "");
+                ok = false;
+            }
+        }
+
+        if (report)
+        {
+            // Report what the kernel actually applied, not what was asked for
+            PlacedThread entry;
+            entry.label = label;
+            entry.tid = static_cast<long>(syscall(SYS_gettid));
+            cpu_set_t effective;
+            CPU_ZERO(&effective);
+            entry.cpus = pthread_getaffinity_np(pthread_self(), sizeof(effective), &effective) == 0
+                             ? format_cpu_list(mask_cpus(effective))
+                             : "?";
+            int sched = SCHED_OTHER;
+            sched_param param{};
+            entry.sched = pthread_getschedparam(pthread_self(), &sched, &param) == 0
+                              ? describe_sched(sched, param.sched_priority)
+                              : "?";
+
+            std::lock_guard<std::mutex> lock(g_placement_mutex);
+            auto it = std::find_if(g_placed.begin(), g_placed.end(),
+                                   [&label](const PlacedThread &placed)
+                                   { return placed.label == label; });
+            if (it != g_placed.end())
+                *it = std::move(entry);
+            else
+                g_placed.push_back(std::move(entry));
+        }
+        return ok;
+    }
+
+    unsigned thread_policy_cpu_count(const ThreadPolicy &policy)
+    {
+        if (!policy.cpus.empty())
+            return static_cast<unsigned>(policy.cpus.size());
+
+        {
+            std::lock_guard<std::mutex> lock(g_placement_mutex);
+            if (g_have_process_mask)
+                return static_cast<unsigned>(std::max(1, CPU_COUNT(&g_default_mask)));
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    void log_thread_report()
+    {
+        if (!thread_placement_active())
+            return;
+
+        std::lock_guard<std::mutex> lock(g_placement_mutex);
+        spdlog::info("Thread placement (process CPUs {}):",
+                     g_have_process_mask ? format_cpu_list(mask_cpus(g_process_mask)) : "?");
+        for (const auto &placed : g_placed)
+            spdlog::info("  {:<24} tid {:<7} CPUs {:<8} {}", placed.label, placed.tid, placed.cpus, placed.sched);
+    }
+
+} // namespace ist
@@ -0,0 +1,62 @@
+/**
+ * @file    thread_placement.h
+ * @brief   CPU affinity and scheduling class for server threads
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Threads are placed from the inside: each thread applies its ThreadPolicy
+ * to itself when it starts (GStreamer streaming threads on STREAM_STATUS
+ * ENTER, send workers at the top of their loop). Linux threads inherit
+ * the CPU mask and scheduling class of the thread that creates them, so
+ * encoder worker pools (x264 threads) follow their streaming thread, and
+ * everything the main thread spawns — reactor, signaling, metrics and the
+ * libdatachannel transport threads — follows threads.control. A policy
+ * without CPUs gets the process mask minus the threads.control CPUs.
+ *
+ * Every application is recorded under a label for the startup report.
+ */
+
+#pragma once
+
+#include "config.h"
+#include <string>
+#include <vector>
+
+namespace ist
+{
+
+    /**
+     * @brief Capture the process CPU mask and apply @p control to the calling thread
+     *
+     * Call once from the main thread before any other thread is created.
+     * Enables placement for streaming and send threads when anything in
+     * @p config asks for it.
+     */
+    void init_thread_placement(const AppConfig &config);
+
+    /** @brief True when some policy in the configuration pins or reschedules threads */
+    bool thread_placement_active();
+
+    /**
+     * @brief  Apply @p policy to the calling thread
+     * @param  policy  Placement; an empty CPU list means the process mask
+     *                 without the threads.control CPUs
+     * @param  label   Thread name in logs and the report (e.g., "cam_front/src")
+     * @param  report  Record the thread for log_thread_report()
+     * @return false if the affinity or scheduling class could not be set
+     */
+    bool apply_thread_policy(const ThreadPolicy &policy, const std::string &label, bool report = true);
+
+    /** @brief Number of CPUs a thread placed with @p policy may run on */
+    unsigned thread_policy_cpu_count(const ThreadPolicy &policy);
+
+    /** @brief "0-1,4" style list of @p cpus ("all" when empty) */
+    std::string format_cpu_list(const std::vector<int> &cpus);
+
+    /** @brief Log every recorded thread with its CPUs and scheduling class */
+    void log_thread_report();
+
+} // namespace ist
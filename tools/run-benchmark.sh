@@ -0,0 +1,36 @@
+#!/usr/bin/env bash
+# IST WebRTC Camera Server - end-to-end benchmark
+#
+# Menjalankan server dengan tools/bench-config.yaml, membuka N viewer via
+# webrtc-loadgen, menyimpan report JSON + scrape /metrics, lalu mematikan
+# server. Exit code mengikuti loadgen (non-zero = regresi / viewer gagal).
+#
+# Usage: tools/run-benchmark.sh [build-dir] [peers] [loadgen options...]
+#   contoh: tools/run-benchmark.sh build 12 --min-fps 28 --max-loss 0.5
+
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "$0")/.." && pwd)"
+BUILD="${1:-$ROOT/build}"
+PEERS="${2:-8}"
+shift $(( $# > 2 ? 2 : $# ))
+
+OUT="$BUILD/bench-$(date +%Y%m%d-%H%M%S)"
+mkdir -p "$OUT"
+
+"$BUILD/webrtc-server" -c "$ROOT/tools/bench-config.yaml" -l "$OUT" &
+SERVER=$!
+trap 'kill -TERM $SERVER 2>/dev/null; wait $SERVER 2>/dev/null || true' EXIT
+
+# Tunggu signaling port terbuka (maks 10 s)
+for _ in $(seq 100); do
+    (echo > /dev/tcp/127.0.0.1/8554) 2>/dev/null && break
+    sleep 0.1
+done
+
+STATUS=0
+"$BUILD/webrtc-loadgen" -u ws://127.0.0.1:8554 -n "$PEERS" -j "$OUT/report.json" "$@" || STATUS=$?
+curl -s http://127.0.0.1:9100/metrics > "$OUT/metrics.txt" || true
+
+echo "Report: $OUT/report.json"
+exit $STATUS
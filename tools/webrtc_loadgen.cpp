@@ -0,0 +1,702 @@
+/**
+ * @file    webrtc_loadgen.cpp
+ * @brief   Headless viewer load generator for the WebRTC camera server
+ * @author  Yuke Brilliant Hestiavin <yukebrilliant@gmail.com>
+ * @date    2026
+ *
+ * @copyright Copyright (c) 2026 PT Indonesia Smelting Technology (IST)
+ *            All rights reserved. Internal use only.
+ *
+ * Opens N concurrent receive-only viewers against a running server using
+ * the dashboard's signaling protocol (version, camera_list, request_stream,
+ * offer/answer, candidate/candidates). Video is not decoded: each track's
+ * RTP headers are parsed to count frames (marker bit), payload bytes,
+ * sequence gaps and inter-frame arrival jitter against the RTP clock.
+ *
+ * Statistics cover the window after --warmup, so runs with the same server
+ * config (see tools/bench-config.yaml) and duration are comparable. The
+ * exit status is non-zero when a viewer fails to connect or a threshold
+ * (--min-fps, --max-loss) is missed, which lets CI catch regressions.
+ */
+
+#include "latency_histogram.h"
+
+#include <rtc/rtc.hpp>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+
+namespace ist
+{
+
+    using json = nlohmann::json;
+    using Clock = std::chrono::steady_clock;
+
+    /// Command line options
+    struct LoadgenOptions
+    {
+        std::string url = "ws://127.0.0.1:8554";
+        int peers = 1;                    ///< Concurrent viewers
+        std::vector<std::string> cameras; ///< Empty = every camera in camera_list
+        int duration_s = 30;              ///< Measurement window
+        int warmup_s = 5;                 ///< Excluded from statistics
+        int ramp_ms = 100;                ///< Delay between viewer starts
+        bool fast_connect = true;         ///< Name the cameras in the WebSocket URL
+        double min_fps = 0;               ///< Fail below this per-track fps (0 = off)
+        double max_loss = -1;             ///< Fail above this per-track loss % (negative = off)
+        std::string json_path;            ///< Write the report here as JSON
+    };
+
+    /// Milliseconds from @p from to @p to
+    static double ms_between(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    /**
+     * @brief Receive statistics of one video track
+     *
+     * Updated from libdatachannel's transport thread; the measurement
+     * window is opened and read from the main thread.
+     */
+    class TrackStats
+    {
+    public:
+        /// Counters over the measurement window
+        struct Window
+        {
+            double seconds = 0;
+            uint64_t frames = 0;
+            uint64_t packets = 0;
+            uint64_t bytes = 0;     ///< RTP payload bytes
+            uint64_t expected = 0;  ///< From the sequence number range
+            double jitter_ms = 0;   ///< Smoothed inter-frame jitter (RFC 3550 style)
+            double max_gap_ms = 0;  ///< Longest gap between completed frames
+
+            double fps() const { return seconds > 0 ? frames / seconds : 0; }
+            double kbps() const { return seconds > 0 ? bytes * 8.0 / seconds / 1000.0 : 0; }
+            double loss_percent() const
+            {
+                return expected > packets ? 100.0 * double(expected - packets) / double(expected) : 0;
+            }
+        };
+
+        /** @brief Account one RTP packet (RTCP is ignored) */
+        void on_packet(const std::byte *data, size_t size)
+        {
+            auto now = Clock::now();
+            const auto *b = reinterpret_cast<const uint8_t *>(data);
+            if (size < 12 || (b[0] >> 6) != 2 || (b[1] >= 200 && b[1] <= 206))
+                return;
+
+            size_t header = 12 + size_t(b[0] & 0x0F) * 4;
+            if ((b[0] & 0x10) && size >= header + 4)
+                header += 4 + size_t((b[header + 2] << 8) | b[header + 3]) * 4;
+            size_t padding = (b[0] & 0x20) ? b[size - 1] : 0;
+            if (header + padding > size)
+                return;
+
+            const bool marker = b[1] & 0x80;
+            const uint16_t seq = uint16_t((b[2] << 8) | b[3]);
+            const uint32_t ts = uint32_t(b[4]) << 24 | uint32_t(b[5]) << 16 | uint32_t(b[6]) << 8 | b[7];
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!first_packet_)
+                first_packet_ = now;
+
+            // Extended sequence number, tolerating reordering across a wrap
+            if (!have_seq_)
+            {
+                ext_seq_ = base_seq_ = seq;
+                have_seq_ = true;
+            }
+            else
+            {
+                int16_t delta = int16_t(seq - uint16_t(ext_seq_));
+                if (delta > 0)
+                    ext_seq_ += delta;
+            }
+
+            packets_++;
+            bytes_ += size - header - padding;
+            if (!marker)
+                return;
+
+            frames_++;
+            if (have_frame_)
+            {
+                double arrival_ms = ms_between(last_frame_arrival_, now);
+                double media_ms = int32_t(ts - last_frame_ts_) / 90.0;
+                jitter_ms_ += (std::abs(arrival_ms - media_ms) - jitter_ms_) / 16.0;
+                max_gap_ms_ = std::max(max_gap_ms_, arrival_ms);
+            }
+            have_frame_ = true;
+            last_frame_arrival_ = now;
+            last_frame_ts_ = ts;
+        }
+
+        /** @brief Start the measurement window */
+        void open_window()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            window_start_ = Clock::now();
+            start_frames_ = frames_;
+            start_packets_ = packets_;
+            start_bytes_ = bytes_;
+            start_expected_ = expected();
+            jitter_ms_ = 0;
+            max_gap_ms_ = 0;
+        }
+
+        /** @brief Counters since open_window() */
+        Window window() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Window w;
+            w.seconds = ms_between(window_start_, Clock::now()) / 1000.0;
+            w.frames = frames_ - start_frames_;
+            w.packets = packets_ - start_packets_;
+            w.bytes = bytes_ - start_bytes_;
+            w.expected = expected() - start_expected_;
+            w.jitter_ms = jitter_ms_;
+            w.max_gap_ms = max_gap_ms_;
+            return w;
+        }
+
+        /** @brief Arrival time of the first packet, if any */
+        std::optional<Clock::time_point> first_packet() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return first_packet_;
+        }
+
+    private:
+        /// Packets the sequence range accounts for so far (mutex_ held)
+        uint64_t expected() const { return have_seq_ ? uint64_t(ext_seq_ - base_seq_ + 1) : 0; }
+
+        mutable std::mutex mutex_;
+        std::optional<Clock::time_point> first_packet_;
+        bool have_seq_ = false;
+        int64_t ext_seq_ = 0;  ///< Highest extended sequence number
+        int64_t base_seq_ = 0; ///< First sequence number received
+        uint64_t frames_ = 0, packets_ = 0, bytes_ = 0;
+        bool have_frame_ = false;
+        Clock::time_point last_frame_arrival_;
+        uint32_t last_frame_ts_ = 0;
+        double jitter_ms_ = 0;
+        double max_gap_ms_ = 0;
+
+        Clock::time_point window_start_ = Clock::now();
+        uint64_t start_frames_ = 0, start_packets_ = 0, start_bytes_ = 0;
+        uint64_t start_expected_ = 0;
+    };
+
+    /**
+     * @brief One receive-only viewer: signaling WebSocket + PeerConnection
+     *
+     * Thread Safety:
+     *   - start(), stop() and the accessors are called from the main thread
+     *   - Callbacks run on libdatachannel threads and hold only a weak
+     *     reference, so a viewer may be destroyed while they are pending
+     */
+    class LoadPeer : public std::enable_shared_from_this<LoadPeer>
+    {
+    public:
+        LoadPeer(int index, const LoadgenOptions &options)
+            : name_(fmt::format("viewer_{}", index)), options_(options)
+        {
+        }
+
+        const std::string &name() const { return name_; }
+
+        /** @brief Connect the signaling WebSocket (negotiation follows from its messages) */
+        void start()
+        {
+            start_time_ = Clock::now();
+            ws_ = std::make_shared<rtc::WebSocket>();
+            std::weak_ptr<LoadPeer> weak = weak_from_this();
+
+            ws_->onOpen([weak]()
+                        {
+                if (auto self = weak.lock())
+                    spdlog::debug("[{}] WebSocket open", self->name_); });
+            ws_->onError([weak](std::string error)
+                         {
+                if (auto self = weak.lock())
+                    spdlog::error("[{}] WebSocket error: {}", self->name_, error); });
+            ws_->onMessage([weak](rtc::message_variant data)
+                           {
+                auto self = weak.lock();
+                auto *text = std::get_if<std::string>(&data);
+                if (!self || !text)
+                    return;
+                try {
+                    self->handle_message(json::parse(*text));
+                } catch (const std::exception &e) {
+                    spdlog::error("[{}] Bad signaling message: {}", self->name_, e.what());
+                } });
+
+            std::string url = options_.url;
+            if (options_.fast_connect)
+            {
+                std::string list = "*";
+                if (!options_.cameras.empty())
+                {
+                    list.clear();
+                    for (const auto &id : options_.cameras)
+                        list += (list.empty() ? "" : ",") + id;
+                }
+                url += (url.find('?') == std::string::npos ? "/?cameras=" : "&cameras=") + list;
+            }
+            ws_->open(url);
+        }
+
+        /** @brief Close the connection */
+        void stop()
+        {
+            std::shared_ptr<rtc::PeerConnection> pc;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pc = pc_;
+            }
+            if (pc)
+                pc->close();
+            if (ws_)
+                ws_->close();
+        }
+
+        /** @brief Open every track's measurement window */
+        void open_window()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto &[mid, stats] : tracks_)
+                stats->open_window();
+        }
+
+        /** @brief WebSocket open → PeerConnection connected, negative = never */
+        double connect_ms() const { return connect_ms_.load(); }
+
+        /** @brief Tracks by camera id */
+        std::map<std::string, std::shared_ptr<TrackStats>> tracks() const
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return tracks_;
+        }
+
+        /** @brief WebSocket open → first RTP packet on any track, negative = none */
+        double first_frame_ms() const
+        {
+            std::optional<Clock::time_point> first;
+            for (const auto &[mid, stats] : tracks())
+            {
+                auto t = stats->first_packet();
+                if (t && (!first || *t < *first))
+                    first = t;
+            }
+            return first ? ms_between(start_time_, *first) : -1;
+        }
+
+    private:
+        void send(const json &msg)
+        {
+            try
+            {
+                if (ws_ && ws_->isOpen())
+                    ws_->send(msg.dump());
+            }
+            catch (const std::exception &e)
+            {
+                spdlog::error("[{}] Send failed: {}", name_, e.what());
+            }
+        }
+
+        void handle_message(const json &msg)
+        {
+            std::string type = msg.value("type", "");
+            if (type == "version")
+            {
+                spdlog::debug("[{}] Server version {}", name_, msg.value("version", ""));
+            }
+            else if (type == "camera_list")
+            {
+                // Same request the dashboard sends; a no-op when the URL
+                // already named the set
+                json request;
+                request["type"] = "request_stream";
+                if (!options_.cameras.empty())
+                    request["cameras"] = options_.cameras;
+                send(request);
+            }
+            else if (type == "offer")
+            {
+                // Renegotiation offers reuse the connection. libdatachannel
+                // may call back (onTrack) from inside, so mutex_ is not held
+                std::shared_ptr<rtc::PeerConnection> pc;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!pc_)
+                        create_peer_connection();
+                    pc = pc_;
+                }
+                pc->setRemoteDescription(rtc::Description(msg.value("sdp", ""), rtc::Description::Type::Offer));
+            }
+            else if (type == "candidate" || type == "candidates")
+            {
+                std::shared_ptr<rtc::PeerConnection> pc;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    pc = pc_;
+                }
+                auto add = [&pc](const json &entry)
+                {
+                    if (pc && entry.contains("candidate") && entry["candidate"].is_string())
+                        pc->addRemoteCandidate(rtc::Candidate(entry["candidate"].get<std::string>(),
+                                                              entry.value("sdpMid", "")));
+                };
+                if (type == "candidate")
+                    add(msg);
+                else
+                    for (const auto &entry : msg.value("candidates", json::array()))
+                        add(entry);
+            }
+            else if (type == "error")
+            {
+                spdlog::error("[{}] Server error: {}", name_, msg.value("message", ""));
+            }
+        }
+
+        /// PeerConnection answering the server's offers (mutex_ held)
+        void create_peer_connection()
+        {
+            std::weak_ptr<LoadPeer> weak = weak_from_this();
+            pc_ = std::make_shared<rtc::PeerConnection>(rtc::Configuration{});
+
+            pc_->onLocalDescription([weak](rtc::Description desc)
+                                    {
+                if (auto self = weak.lock())
+                    self->send({{"type", desc.typeString()}, {"sdp", std::string(desc)}}); });
+            pc_->onLocalCandidate([weak](rtc::Candidate candidate)
+                                  {
+                if (auto self = weak.lock())
+                    self->send({{"type", "candidate"}, {"candidate", std::string(candidate)}, {"sdpMid", candidate.mid()}}); });
+            pc_->onStateChange([weak](rtc::PeerConnection::State state)
+                               {
+                auto self = weak.lock();
+                if (!self)
+                    return;
+                if (state == rtc::PeerConnection::State::Connected && self->connect_ms_.load() < 0)
+                {
+                    self->connect_ms_.store(ms_between(self->start_time_, Clock::now()));
+                    spdlog::info("[{}] Connected in {:.0f} ms", self->name_, self->connect_ms_.load());
+                }
+                else if (state == rtc::PeerConnection::State::Failed)
+                {
+                    spdlog::error("[{}] PeerConnection failed", self->name_);
+                } });
+            pc_->onTrack([weak](std::shared_ptr<rtc::Track> track)
+                         {
+                auto self = weak.lock();
+                if (!self)
+                    return;
+                auto stats = std::make_shared<TrackStats>();
+                {
+                    std::lock_guard<std::mutex> lock(self->mutex_);
+                    self->tracks_[track->mid()] = stats;
+                    self->track_refs_.push_back(track);
+                }
+
+                // Receiver reports keep the server's RTCP/bandwidth paths realistic
+                track->setMediaHandler(std::make_shared<rtc::RtcpReceivingSession>());
+                track->onMessage([stats](rtc::message_variant data)
+                                 {
+                    if (auto *packet = std::get_if<rtc::binary>(&data))
+                        stats->on_packet(packet->data(), packet->size()); });
+                spdlog::debug("[{}] Track {}", self->name_, track->mid()); });
+        }
+
+        std::string name_;
+        const LoadgenOptions &options_;
+        Clock::time_point start_time_;
+        std::atomic<double> connect_ms_{-1};
+
+        mutable std::mutex mutex_;
+        std::shared_ptr<rtc::WebSocket> ws_;
+        std::shared_ptr<rtc::PeerConnection> pc_;
+        std::vector<std::shared_ptr<rtc::Track>> track_refs_;
+        std::map<std::string, std::shared_ptr<TrackStats>> tracks_; ///< camera id → stats
+    };
+
+} // namespace ist
+
+static std::atomic<bool> g_running{true};
+
+static void signal_handler(int)
+{
+    g_running.store(false);
+}
+
+static std::vector<std::string> split_list(const std::string &list)
+{
+    std::vector<std::string> items;
+    for (size_t start = 0; start <= list.size();)
+    {
+        size_t comma = std::min(list.find(',', start), list.size());
+        if (comma > start)
+            items.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return items;
+}
+
+/// Sleep up to @p ms, returning early (false) on SIGINT/SIGTERM
+static bool sleep_while_running(int64_t ms)
+{
+    auto until = ist::Clock::now() + std::chrono::milliseconds(ms);
+    while (g_running.load() && ist::Clock::now() < until)
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    return g_running.load();
+}
+
+static void print_usage(const char *program)
+{
+    std::cerr << "IST WebRTC Load Generator\n"
+              << "Headless receive-only viewers for capacity and regression runs\n\n"
+              << "Usage: " << program << " [options]\n\n"
+              << "Options:\n"
+              << "  -u, --url <ws-url>        Signaling server (default: ws://127.0.0.1:8554)\n"
+              << "  -n, --peers <count>       Concurrent viewers (default: 1)\n"
+              << "  -c, --cameras <a,b,...>   Cameras to request (default: all)\n"
+              << "  -d, --duration <s>        Measurement window (default: 30)\n"
+              << "  -w, --warmup <s>          Excluded from statistics (default: 5)\n"
+              << "  -r, --ramp <ms>           Delay between viewer starts (default: 100)\n"
+              << "  -F, --no-fast-connect     Wait for camera_list before requesting streams\n"
+              << "  -f, --min-fps <fps>       Fail if any track receives fewer fps\n"
+              << "  -l, --max-loss <percent>  Fail if any track loses more packets\n"
+              << "  -j, --json <path>         Write the report as JSON\n"
+              << "  -v, --verbose             Enable verbose logging\n"
+              << "  -h, --help                Show this help\n"
+              << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    using ist::json;
+
+    ist::LoadgenOptions options;
+    bool verbose = false;
+
+    static struct option long_options[] = {
+        {"url", required_argument, nullptr, 'u'},
+        {"peers", required_argument, nullptr, 'n'},
+        {"cameras", required_argument, nullptr, 'c'},
+        {"duration", required_argument, nullptr, 'd'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"ramp", required_argument, nullptr, 'r'},
+        {"no-fast-connect", no_argument, nullptr, 'F'},
+        {"min-fps", required_argument, nullptr, 'f'},
+        {"max-loss", required_argument, nullptr, 'l'},
+        {"json", required_argument, nullptr, 'j'},
+        {"verbose", no_argument, nullptr, 'v'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}};
+
+    int opt;
+    try
+    {
+        while ((opt = getopt_long(argc, argv, "u:n:c:d:w:r:Ff:l:j:vh", long_options, nullptr)) != -1)
+        {
+            switch (opt)
+            {
+            case 'u':
+                options.url = optarg;
+                break;
+            case 'n':
+                options.peers = std::max(1, std::stoi(optarg));
+                break;
+            case 'c':
+                options.cameras = split_list(optarg);
+                break;
+            case 'd':
+                options.duration_s = std::max(1, std::stoi(optarg));
+                break;
+            case 'w':
+                options.warmup_s = std::max(0, std::stoi(optarg));
+                break;
+            case 'r':
+                options.ramp_ms = std::max(0, std::stoi(optarg));
+                break;
+            case 'F':
+                options.fast_connect = false;
+                break;
+            case 'f':
+                options.min_fps = std::stod(optarg);
+                break;
+            case 'l':
+                options.max_loss = std::stod(optarg);
+                break;
+            case 'j':
+                options.json_path = optarg;
+                break;
+            case 'v':
+                verbose = true;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    spdlog::set_level(verbose ? spdlog::level::debug : spdlog::level::info);
+    spdlog::set_pattern("[%H:%M:%S.%e] [%^%l%$] %v");
+    rtc::InitLogger(verbose ? rtc::LogLevel::Info : rtc::LogLevel::Warning);
+
+    std::signal(SIGINT, signal_handler);
+    std::signal(SIGTERM, signal_handler);
+
+    spdlog::info("Load test: {} viewers → {} (warmup {}s, window {}s)",
+                 options.peers, options.url, options.warmup_s, options.duration_s);
+
+    std::vector<std::shared_ptr<ist::LoadPeer>> peers;
+    for (int i = 0; i < options.peers && g_running.load(); i++)
+    {
+        peers.push_back(std::make_shared<ist::LoadPeer>(i, options));
+        peers.back()->start();
+        if (options.ramp_ms > 0)
+            sleep_while_running(options.ramp_ms);
+    }
+
+    // Warm up (connects, GOP priming, encoder ramp), then measure
+    sleep_while_running(int64_t(options.warmup_s) * 1000);
+    for (auto &peer : peers)
+        peer->open_window();
+
+    const int64_t window_ms = int64_t(options.duration_s) * 1000;
+    for (int64_t elapsed = 0; elapsed < window_ms && g_running.load(); elapsed += 5000)
+    {
+        if (!sleep_while_running(std::min<int64_t>(5000, window_ms - elapsed)))
+            break;
+
+        double fps = 0, kbps = 0;
+        size_t connected = 0;
+        for (const auto &peer : peers)
+        {
+            connected += peer->connect_ms() >= 0;
+            for (const auto &[camera, stats] : peer->tracks())
+            {
+                auto w = stats->window();
+                fps += w.fps();
+                kbps += w.kbps();
+            }
+        }
+        spdlog::info("Progress: {}/{} connected, {:.1f} fps, {:.0f} kbps total", connected, peers.size(), fps, kbps);
+    }
+
+    // ---- Report ----
+    ist::LatencyHistogram connect_times;
+    json report;
+    report["url"] = options.url;
+    report["peers"] = json::array();
+    bool pass = true;
+
+    std::cout << "\n"
+              << fmt::format("{:<12} {:<14} {:>8} {:>9} {:>7} {:>10} {:>10} {:>10} {:>11}\n",
+                             "viewer", "camera", "fps", "kbps", "loss%", "jitter_ms", "maxgap_ms",
+                             "connect_ms", "1stframe_ms");
+    for (const auto &peer : peers)
+    {
+        const double connect = peer->connect_ms();
+        const double first = peer->first_frame_ms();
+        if (connect >= 0)
+            connect_times.record(static_cast<int64_t>(connect * 1000));
+        else
+        {
+            pass = false;
+            spdlog::error("[{}] Never connected", peer->name());
+        }
+
+        json peer_json;
+        peer_json["name"] = peer->name();
+        peer_json["connect_ms"] = connect;
+        peer_json["first_frame_ms"] = first;
+        peer_json["tracks"] = json::array();
+
+        auto tracks = peer->tracks();
+        if (tracks.empty())
+            std::cout << fmt::format("{:<12} {:<14} {:>8} {:>9} {:>7} {:>10} {:>10} {:>10.0f} {:>11.0f}\n",
+                                     peer->name(), "-", "-", "-", "-", "-", "-", connect, first);
+        for (const auto &[camera, stats] : tracks)
+        {
+            auto w = stats->window();
+            std::cout << fmt::format("{:<12} {:<14} {:>8.1f} {:>9.0f} {:>7.2f} {:>10.2f} {:>10.1f} {:>10.0f} {:>11.0f}\n",
+                                     peer->name(), camera, w.fps(), w.kbps(), w.loss_percent(),
+                                     w.jitter_ms, w.max_gap_ms, connect, first);
+            peer_json["tracks"].push_back({{"camera", camera},
+                                           {"fps", w.fps()},
+                                           {"kbps", w.kbps()},
+                                           {"loss_percent", w.loss_percent()},
+                                           {"jitter_ms", w.jitter_ms},
+                                           {"max_gap_ms", w.max_gap_ms},
+                                           {"frames", w.frames},
+                                           {"packets", w.packets}});
+
+            if (options.min_fps > 0 && w.fps() < options.min_fps)
+            {
+                pass = false;
+                spdlog::error("[{}] {}: {:.1f} fps < {:.1f}", peer->name(), camera, w.fps(), options.min_fps);
+            }
+            if (options.max_loss >= 0 && w.loss_percent() > options.max_loss)
+            {
+                pass = false;
+                spdlog::error("[{}] {}: {:.2f}% loss > {:.2f}%", peer->name(), camera, w.loss_percent(), options.max_loss);
+            }
+        }
+        report["peers"].push_back(std::move(peer_json));
+    }
+
+    auto connect = connect_times.summary();
+    std::cout << fmt::format("\nConnected {}/{}; connect p50={:.0f}ms p95={:.0f}ms max={:.0f}ms\n",
+                             connect.count, peers.size(), connect.p50_ms, connect.p95_ms, connect.max_ms);
+    report["connected"] = connect.count;
+    report["connect_p50_ms"] = connect.p50_ms;
+    report["connect_p95_ms"] = connect.p95_ms;
+    report["pass"] = pass;
+
+    if (!options.json_path.empty())
+    {
+        std::ofstream out(options.json_path);
+        out << report.dump(2) << "\n";
+        if (!out)
+            spdlog::error("Cannot write report to {}", options.json_path);
+    }
+
+    for (auto &peer : peers)
+        peer->stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let close frames go out
+
+    std::cout << (pass ? "PASS" : "FAIL") << std::endl;
+    return pass ? 0 : 1;
+}